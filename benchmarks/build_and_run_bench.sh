@@ -2,3 +2,13 @@
 
 g++ -std=c++11 -O2 -Wall -pedantic -I.. enaml_like_benchmark.cpp -o run_bench
 ./run_bench
+g++ -std=c++11 -O2 -Wall -pedantic -I.. row_benchmark.cpp -o run_row_bench
+./run_row_bench
+g++ -std=c++11 -O2 -Wall -pedantic -I.. degenerate_benchmark.cpp -o run_degenerate_bench
+./run_degenerate_bench
+g++ -std=c++11 -O2 -Wall -pedantic -pthread -I.. parallel_benchmark.cpp -o run_parallel_bench
+./run_parallel_bench
+g++ -std=c++11 -O2 -Wall -pedantic -I.. resize_benchmark.cpp -o run_resize_bench
+./run_resize_bench
+g++ -std=c++11 -O2 -Wall -pedantic -I.. clone_benchmark.cpp -o run_clone_bench
+./run_clone_bench
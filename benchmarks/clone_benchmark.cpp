@@ -0,0 +1,259 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2020, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+
+// Time trying a change on a copy of a layout made with Solver::clone, which
+// shares the rows of the tableau until they change but copies the maps
+// indexing them, against rebuilding the layout from scratch, undoing a change with Solver::rollback against
+// removing the constraints it added, and trying constraints which may not
+// fit with Solver::tryAddConstraint against catching the exceptions of
+// Solver::addConstraint within a checkpoint. It also times removing the
+// constraints of a window by constraint against removing them by handle, and
+// tearing a window down by its constraints against Solver::removeVariables.
+
+#include <string>
+#include <vector>
+#include <kiwi/kiwi.h>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+
+using namespace kiwi;
+
+// Add a window laying out n items in a row across its width. Each item has a
+// minimum width and prefers a width of its own. The constraints added are
+// appended to the given list.
+void add_window(Solver& solver, Variable& width, int n, std::vector<Constraint>& added)
+{
+    solver.addEditVariable(width, strength::strong);
+    std::vector<Variable> left(n), iwidth(n);
+    auto add = [&](const Constraint& constraint) {
+        solver.addConstraint(constraint);
+        added.push_back(constraint);
+    };
+    add(left[0] == 8);
+    for (int i = 0; i < n; ++i)
+    {
+        add(iwidth[i] >= 20 + 5 * (i % 4));
+        add((iwidth[i] == 60 + 10 * (i % 5)) | strength::weak);
+        if (i > 0)
+        {
+            add(left[i] >= left[i - 1] + iwidth[i - 1] + 4);
+            add((left[i] == left[i - 1] + iwidth[i - 1] + 4) | strength::medium);
+        }
+    }
+    add(left[n - 1] + iwidth[n - 1] + 8 <= width);
+    add((left[n - 1] + iwidth[n - 1] + 8 == width) | strength::weak);
+}
+
+// Time building a layout of many windows, cloning it, and trying a smaller
+// width for one of its windows on a clone. Cloning grows with the number of
+// windows, as the maps of the tableau are copied, but stays well below
+// building the layout.
+void bench_what_if(int windows)
+{
+    std::string suffix = " (" + std::to_string(windows) + " windows of 16 items)";
+    std::vector<Variable> widths(windows);
+    std::vector<Constraint> added;
+    ankerl::nanobench::Bench().minEpochIterations(2).run("building the layout" + suffix, [&] {
+        Solver solver;
+        for (auto& width : widths)
+            add_window(solver, width, 16, added);
+        ankerl::nanobench::doNotOptimizeAway(solver.componentCount());
+    });
+
+    Solver solver;
+    for (auto& width : widths)
+        add_window(solver, width, 16, added);
+    solver.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("cloning the layout" + suffix, [&] {
+        Solver copy(solver.clone());
+        ankerl::nanobench::doNotOptimizeAway(copy.componentCount());
+    });
+    ankerl::nanobench::Bench().minEpochIterations(10).run("trying a width on a clone" + suffix, [&] {
+        Solver copy(solver.clone());
+        copy.suggestValue(widths[0], 600.0);
+        ankerl::nanobench::doNotOptimizeAway(copy.pivotCount());
+    });
+}
+
+// Time trying a new window tied to the width of the first one in a layout of
+// many windows, and undoing it by removing its constraints one by one or by
+// rolling back to a checkpoint. Each way starts from a new layout.
+void bench_undo(int windows)
+{
+    std::string suffix = " (" + std::to_string(windows) + " windows of 16 items)";
+    std::vector<Variable> widths(windows);
+    std::vector<Constraint> added;
+    Variable extra;
+    Constraint tie((extra == widths[0] * 0.5) | strength::medium);
+    std::vector<Constraint> tried;
+
+    Solver removing;
+    for (auto& width : widths)
+        add_window(removing, width, 16, added);
+    removing.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("trying a window and removing it" + suffix, [&] {
+        tried.clear();
+        add_window(removing, extra, 16, tried);
+        removing.addConstraint(tie);
+        removing.removeConstraint(tie);
+        removing.removeConstraints(tried.begin(), tried.end());
+        removing.removeEditVariable(extra);
+    });
+
+    Solver rolling;
+    for (auto& width : widths)
+        add_window(rolling, width, 16, added);
+    rolling.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("trying a window and rolling it back" + suffix, [&] {
+        std::size_t token = rolling.checkpoint();
+        tried.clear();
+        add_window(rolling, extra, 16, tried);
+        rolling.addConstraint(tie);
+        rolling.rollback(token);
+    });
+}
+
+// Time trying required maximum widths for the first window of a layout of
+// many windows, from too narrow to fit its items to wide enough, and removing
+// the ones which could be added. An unsatisfiable constraint may leave the
+// tableau changed when addConstraint throws, so that way rolls back to a
+// checkpoint taken before each constraint.
+void bench_try(int windows)
+{
+    std::string suffix = " (" + std::to_string(windows) + " windows of 16 items)";
+    std::vector<Variable> widths(windows);
+    std::vector<Constraint> added;
+    std::vector<Constraint> candidates;
+    for (int width = 100; width <= 1000; width += 50)
+        candidates.push_back(widths[0] <= width);
+
+    Solver catching;
+    for (auto& width : widths)
+        add_window(catching, width, 16, added);
+    catching.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("trying widths and rolling back failures" + suffix, [&] {
+        for (const auto& candidate : candidates)
+        {
+            std::size_t token = catching.checkpoint();
+            try
+            {
+                catching.addConstraint(candidate);
+                catching.removeConstraint(candidate);
+                catching.commit(token);
+            }
+            catch (const UnsatisfiableConstraint&)
+            {
+                catching.rollback(token);
+            }
+        }
+    });
+
+    Solver trying;
+    for (auto& width : widths)
+        add_window(trying, width, 16, added);
+    trying.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("trying widths with tryAddConstraint" + suffix, [&] {
+        for (const auto& candidate : candidates)
+        {
+            if (trying.tryAddConstraint(candidate) == STATUS_OK)
+                trying.removeConstraint(candidate);
+        }
+    });
+}
+
+// Time removing the constraints of the first window of a layout of many
+// windows and adding them back, removing them by constraint, which looks them
+// up in the map of the solver, or by the handles addConstraint returned.
+void bench_remove(int windows)
+{
+    std::string suffix = " (" + std::to_string(windows) + " windows of 16 items)";
+    std::vector<Variable> widths(windows);
+    std::vector<Constraint> first;
+    std::vector<Constraint> added;
+
+    Solver by_constraint;
+    add_window(by_constraint, widths[0], 16, first);
+    for (int i = 1; i < windows; ++i)
+        add_window(by_constraint, widths[i], 16, added);
+    by_constraint.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("removing a window by constraint" + suffix, [&] {
+        by_constraint.removeConstraints(first.begin(), first.end());
+        for (const auto& constraint : first)
+            by_constraint.addConstraint(constraint);
+    });
+
+    Solver by_handle;
+    std::vector<ConstraintHandle> handles;
+    by_handle.addEditVariable(widths[0], strength::strong);
+    for (const auto& constraint : first)
+        handles.push_back(by_handle.addConstraint(constraint));
+    for (int i = 1; i < windows; ++i)
+        add_window(by_handle, widths[i], 16, added);
+    by_handle.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("removing a window by handle" + suffix, [&] {
+        by_handle.removeConstraints(handles.begin(), handles.end());
+        for (std::size_t i = 0; i < first.size(); ++i)
+            handles[i] = by_handle.addConstraint(first[i]);
+    });
+}
+
+// Time adding a window of new variables to a layout of many windows and
+// tearing it down, by removing its constraints and edit variable or by
+// removing its variables, which finds their constraints from the references
+// the solver keeps to each variable.
+void bench_teardown(int windows)
+{
+    std::string suffix = " (" + std::to_string(windows) + " windows of 16 items)";
+    std::vector<Variable> widths(windows);
+    std::vector<Constraint> added;
+    std::vector<Constraint> tried;
+
+    Solver by_constraint;
+    for (auto& width : widths)
+        add_window(by_constraint, width, 16, added);
+    by_constraint.suggestValue(widths[0], 1400.0);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("tearing a window down by constraint" + suffix, [&] {
+        Variable width;
+        tried.clear();
+        add_window(by_constraint, width, 16, tried);
+        by_constraint.removeConstraints(tried.begin(), tried.end());
+        by_constraint.removeEditVariable(width);
+    });
+
+    Solver by_variable;
+    for (auto& width : widths)
+        add_window(by_variable, width, 16, added);
+    by_variable.suggestValue(widths[0], 1400.0);
+    std::vector<Variable> variables;
+    ankerl::nanobench::Bench().minEpochIterations(10).run("tearing a window down by variable" + suffix, [&] {
+        Variable width;
+        tried.clear();
+        add_window(by_variable, width, 16, tried);
+        variables.clear();
+        for (const auto& constraint : tried)
+        {
+            for (const auto& term : constraint.expression().terms())
+                variables.push_back(term.variable());
+        }
+        by_variable.removeVariables(variables.begin(), variables.end());
+    });
+}
+
+int main()
+{
+    for (int windows : {1, 16, 256})
+        bench_what_if(windows);
+    for (int windows : {1, 16, 256})
+        bench_undo(windows);
+    for (int windows : {1, 16, 256})
+        bench_try(windows);
+    for (int windows : {1, 16, 640})
+        bench_remove(windows);
+    for (int windows : {1, 16, 256})
+        bench_teardown(windows);
+}
@@ -0,0 +1,103 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2020, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+
+// Time building and resizing grid layouts whose tableau is highly degenerate.
+
+#include <cstdio>
+#include <vector>
+#include <kiwi/kiwi.h>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+
+using namespace kiwi;
+
+// Build a grid of n x n cells packed from the top left corner of a window.
+// Every cell is ordered after its neighbours by a required inequality, and
+// asks to touch them with a medium equality. All the constants are zero, so
+// until the window is resized every row of the tableau has a zero constant
+// and every pivot of the simplex method is degenerate.
+template <typename SolverType>
+void build_grid(SolverType& solver, Variable& width, Variable& height, int n)
+{
+    solver.addEditVariable(width, strength::strong);
+    solver.addEditVariable(height, strength::strong);
+
+    std::vector<Variable> left(n * n), top(n * n), cwidth(n * n), cheight(n * n);
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            int k = i * n + j;
+            solver.addConstraint(left[k] >= 0);
+            solver.addConstraint(top[k] >= 0);
+            solver.addConstraint(cwidth[k] >= 0);
+            solver.addConstraint(cheight[k] >= 0);
+            solver.addConstraint((cwidth[k] == cheight[k]) | strength::weak);
+            if (j > 0)
+            {
+                solver.addConstraint(left[k] >= left[k - 1] + cwidth[k - 1]);
+                solver.addConstraint((left[k] == left[k - 1] + cwidth[k - 1]) | strength::medium);
+                solver.addConstraint((cwidth[k] == cwidth[k - 1]) | strength::weak);
+            }
+            if (i > 0)
+            {
+                solver.addConstraint(top[k] >= top[k - n] + cheight[k - n]);
+                solver.addConstraint((top[k] == top[k - n] + cheight[k - n]) | strength::medium);
+                solver.addConstraint((left[k] == left[k - n]) | strength::medium);
+                solver.addConstraint((cheight[k] == cheight[k - n]) | strength::weak);
+            }
+            if (j == n - 1)
+                solver.addConstraint(left[k] + cwidth[k] <= width);
+            if (i == n - 1)
+                solver.addConstraint(top[k] + cheight[k] <= height);
+        }
+    }
+}
+
+// Time building and resizing grids with a pivot rule, and report the number
+// of pivots each step needs.
+template <typename PivotRule>
+void bench_grid(const std::string& name)
+{
+    for (int n : { 4, 6, 8 })
+    {
+        std::string suffix = " " + std::to_string(n) + "x" + std::to_string(n) + " (" + name + ")";
+
+        ankerl::nanobench::Bench().epochs(1).run("building degenerate grid" + suffix, [&] {
+            BasicSolver<DefaultMapPolicy, PivotRule> solver;
+            Variable width("width");
+            Variable height("height");
+            build_grid(solver, width, height, n);
+            ankerl::nanobench::doNotOptimizeAway(solver);
+        });
+
+        BasicSolver<DefaultMapPolicy, PivotRule> solver;
+        Variable width("width");
+        Variable height("height");
+        build_grid(solver, width, height, n);
+        std::size_t building = solver.pivotCount();
+
+        int step = 0;
+        ankerl::nanobench::Bench().epochs(1).epochIterations(20).run("resizing degenerate grid" + suffix, [&] {
+            solver.suggestValue(width, 400 + 37 * (step % 20));
+            solver.suggestValue(height, 300 + 53 * (step % 7));
+            solver.updateVariables();
+            ++step;
+        });
+
+        std::printf("pivots%s: %zu building, %.2f per resize\n", suffix.c_str(), building,
+                    static_cast<double>(solver.pivotCount() - building) / step);
+    }
+}
+
+int main()
+{
+    bench_grid<BlandPivotRule>("bland");
+    bench_grid<DantzigPivotRule>("dantzig");
+    bench_grid<SteepestEdgePivotRule>("steepest edge");
+}
@@ -8,13 +8,19 @@
 
 // Time updating an EditVariable in a set of constraints typical of enaml use.
 
+#include <cstdio>
+#include <limits>
+#include <vector>
 #include <kiwi/kiwi.h>
 #define ANKERL_NANOBENCH_IMPLEMENT
 #include "nanobench.h"
 
 using namespace kiwi;
 
-void build_solver(Solver& solver, Variable& width, Variable& height)
+// Add the constraints of one enaml-like panel sized by width and height,
+// either one at a time or in a single batch.
+template <typename SolverType>
+void add_panel(SolverType& solver, Variable& width, Variable& height, bool batch)
 {
     // Create custom strength
     double mmedium = strength::create(0.0, 1.0, 0.0, 1.25);
@@ -57,10 +63,6 @@ void build_solver(Solver& solver, Variable& width, Variable& height)
     Variable fl3top("fl3top");
     Variable fl3width("fl3width");
 
-    // Add the edit variables
-    solver.addEditVariable(width, strength::strong);
-    solver.addEditVariable(height, strength::strong);
-
     // Add the constraints
     Constraint constraints[] = {
         (left + -0 >= 0) | strength::required,
@@ -176,8 +178,200 @@ void build_solver(Solver& solver, Variable& width, Variable& height)
         (fl1width + -125 >= 0) | strength::strong,
     };
 
-    for (const auto& constraint : constraints)
-        solver.addConstraint(constraint);
+    if (batch)
+        solver.addConstraints(constraints);
+    else
+    {
+        for (const auto& constraint : constraints)
+            solver.addConstraint(constraint);
+    }
+}
+
+// Build a window containing the given number of panels.
+template <typename SolverType>
+void build_solver(SolverType& solver, Variable& width, Variable& height, int panels = 1, bool batch = false)
+{
+    // Add the edit variables
+    solver.addEditVariable(width, strength::strong);
+    solver.addEditVariable(height, strength::strong);
+
+    for (int i = 0; i < panels; ++i)
+        add_panel(solver, width, height, batch);
+}
+
+// Time building and resizing windows of several sizes with a map policy.
+template <typename MapPolicy>
+void bench_map_policy(const std::string& name)
+{
+    for (int panels : { 1, 4, 8 })
+    {
+        std::string suffix = " " + std::to_string(panels) + " panels (" + name + ")";
+
+        ankerl::nanobench::Bench().epochs(3).run("building solver" + suffix, [&] {
+            BasicSolver<MapPolicy> solver;
+            Variable width("width");
+            Variable height("height");
+            build_solver(solver, width, height, panels);
+            ankerl::nanobench::doNotOptimizeAway(solver);
+        });
+
+        ankerl::nanobench::Bench().epochs(3).run("building solver in batch" + suffix, [&] {
+            BasicSolver<MapPolicy> solver;
+            Variable width("width");
+            Variable height("height");
+            build_solver(solver, width, height, panels, true);
+            ankerl::nanobench::doNotOptimizeAway(solver);
+        });
+
+        BasicSolver<MapPolicy> solver;
+        Variable width("width");
+        Variable height("height");
+        build_solver(solver, width, height, panels);
+
+        double value = 400;
+        ankerl::nanobench::Bench().minEpochIterations(10).run("suggest value" + suffix, [&] {
+            value = value == 400 ? 800 : 400;
+            solver.suggestValue(width, value);
+            solver.suggestValue(height, value);
+            solver.updateVariables();
+        });
+    }
+}
+
+// Time building and resizing windows of several sizes with a pivot rule,
+// and report the number of pivots each step needs.
+template <typename PivotRule>
+void bench_pivot_rule(const std::string& name)
+{
+    for (int panels : { 1, 4, 8 })
+    {
+        std::string suffix = " " + std::to_string(panels) + " panels (" + name + ")";
+
+        ankerl::nanobench::Bench().epochs(3).run("building solver" + suffix, [&] {
+            BasicSolver<DefaultMapPolicy, PivotRule> solver;
+            Variable width("width");
+            Variable height("height");
+            build_solver(solver, width, height, panels);
+            ankerl::nanobench::doNotOptimizeAway(solver);
+        });
+
+        BasicSolver<DefaultMapPolicy, PivotRule> solver;
+        Variable width("width");
+        Variable height("height");
+        build_solver(solver, width, height, panels);
+        std::size_t building = solver.pivotCount();
+
+        double value = 400;
+        std::size_t suggestions = 0;
+        ankerl::nanobench::Bench().minEpochIterations(10).run("suggest value" + suffix, [&] {
+            value = value == 400 ? 800 : 400;
+            solver.suggestValue(width, value);
+            solver.suggestValue(height, value);
+            solver.updateVariables();
+            ++suggestions;
+        });
+
+        std::printf("pivots%s: %zu building, %.2f per suggestion\n", suffix.c_str(), building,
+                    static_cast<double>(solver.pivotCount() - building) / suggestions);
+    }
+}
+
+// Time resizing one window of an application made of many independent
+// windows, which share no variable, and adding a minimum size to it.
+template <typename MapPolicy>
+void bench_independent_windows(const std::string& name)
+{
+    for (int windows : { 1, 8, 32, 128 })
+    {
+        std::string suffix = " in 1 of " + std::to_string(windows) + " windows (" + name + ")";
+
+        BasicSolver<MapPolicy> solver;
+        std::vector<Variable> widths(windows), heights(windows);
+        for (int i = 0; i < windows; ++i)
+            build_solver(solver, widths[i], heights[i]);
+
+        double value = 400;
+        ankerl::nanobench::Bench().minEpochIterations(10).run("suggest value" + suffix, [&] {
+            value = value == 400 ? 800 : 400;
+            solver.suggestValues({ { widths[0], value }, { heights[0], value } });
+        });
+
+        solver.suggestValue(widths[0], 400);
+        ankerl::nanobench::Bench().minEpochIterations(10).run("add and remove a minimum width" + suffix, [&] {
+            Constraint constraint = widths[0] >= 600;
+            solver.addConstraint(constraint);
+            solver.removeConstraint(constraint);
+        });
+
+        std::printf("components%s: %zu\n", suffix.c_str(), solver.componentCount());
+    }
+}
+
+// A resource counting the bytes it holds, drawn from operator new.
+class CountingResource : public MemoryResource
+{
+public:
+    std::size_t used() const
+    {
+        return m_used;
+    }
+
+protected:
+    void* doAllocate(std::size_t bytes, std::size_t alignment) override
+    {
+        m_used += bytes;
+        return newDeleteResource()->allocate(bytes, alignment);
+    }
+
+    void doDeallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        m_used -= bytes;
+        newDeleteResource()->deallocate(p, bytes, alignment);
+    }
+
+private:
+    std::size_t m_used = 0;
+};
+
+// Time adding and removing the constraints of a widget over many cycles,
+// either with new variables each time, as widgets come and go in a
+// long-running application, or with the same variables, as a widget is
+// hidden and shown again. Every round runs as many cycles, so neither the
+// time of a cycle nor the memory held by the solver should grow from one
+// round to the next.
+template <typename MapPolicy>
+void bench_widget_churn(const std::string& name, bool fresh)
+{
+    CountingResource resource;
+    BasicSolver<MapPolicy> solver(&resource);
+    Variable width("width");
+    Variable height("height");
+    build_solver(solver, width, height);
+
+    Variable left("left");
+    Variable right("right");
+    for (int round = 1; round <= 4; ++round)
+    {
+        std::string suffix = std::string(fresh ? " with new variables" : " with the same variables") + " (" + name +
+                             ", round " + std::to_string(round) + ")";
+        ankerl::nanobench::Bench().epochs(1).epochIterations(20000).run("add and remove a widget" + suffix, [&] {
+            if (fresh)
+            {
+                left = Variable("left");
+                right = Variable("right");
+            }
+            Constraint constraints[] = {
+                left >= 10,
+                right == left + 100,
+                (right <= width) | strength::weak,
+            };
+            for (const auto& constraint : constraints)
+                solver.addConstraint(constraint);
+            for (const auto& constraint : constraints)
+                solver.removeConstraint(constraint);
+        });
+        std::printf("bytes held%s: %zu\n", suffix.c_str(), resource.used());
+    }
 }
 
 int main()
@@ -190,6 +384,31 @@ int main()
         ankerl::nanobench::doNotOptimizeAway(solver); //< prevent the compiler to optimize away the solver
     });
 
+    ankerl::nanobench::Bench().run("building solver (batch)", [&] {
+        Solver solver;
+        Variable width("width");
+        Variable height("height");
+        build_solver(solver, width, height, 1, true);
+        ankerl::nanobench::doNotOptimizeAway(solver);
+    });
+
+    ankerl::nanobench::Bench().run("building solver (monotonic resource)", [&] {
+        MonotonicResource resource;
+        Solver solver(&resource);
+        Variable width("width");
+        Variable height("height");
+        build_solver(solver, width, height);
+        ankerl::nanobench::doNotOptimizeAway(solver);
+    });
+    ankerl::nanobench::Bench().run("building solver (pool resource)", [&] {
+        PoolResource resource;
+        Solver solver(&resource);
+        Variable width("width");
+        Variable height("height");
+        build_solver(solver, width, height);
+        ankerl::nanobench::doNotOptimizeAway(solver);
+    });
+
     struct Size
     {
         int width;
@@ -220,5 +439,72 @@ int main()
             solver.suggestValue(heightVar, height);
             solver.updateVariables();
         });
+
+        ankerl::nanobench::Bench().minEpochIterations(10).run("suggest values " + std::to_string(size.width) + "x" + std::to_string(size.height), [&] {
+            solver.suggestValues({ { widthVar, width }, { heightVar, height } });
+            solver.updateVariables();
+        });
+    }
+
+    double value = 400;
+    ankerl::nanobench::Bench().minEpochIterations(10).run("suggest value and update changed variables", [&] {
+        value = value == 400 ? 800 : 400;
+        solver.suggestValues({ { widthVar, value }, { heightVar, value } });
+        ankerl::nanobench::doNotOptimizeAway(solver.updateChangedVariables());
+    });
+
+    std::vector<double> coordinates;
+    ankerl::nanobench::Bench().minEpochIterations(100).run("read values one variable at a time", [&] {
+        coordinates.clear();
+        for (const auto& var : solver.variables())
+            coordinates.push_back(var.value());
+        ankerl::nanobench::doNotOptimizeAway(coordinates.data());
+    });
+
+    ankerl::nanobench::Bench().minEpochIterations(100).run("read values as one array", [&] {
+        auto values = solver.values();
+        coordinates.assign(values.begin(), values.end());
+        ankerl::nanobench::doNotOptimizeAway(coordinates.data());
+    });
+
+    // Move the minimum width of the window, either as the native bound of
+    // a variable or by replacing a required constraint.
+    Variable minWidth("min_width");
+    solver.setBounds(minWidth, 300, std::numeric_limits<double>::infinity());
+    solver.addConstraint(widthVar >= minWidth);
+    double minimum = 300;
+    ankerl::nanobench::Bench().minEpochIterations(10).run("move a minimum size with setBounds", [&] {
+        minimum = minimum == 300 ? 700 : 300;
+        solver.setBounds(minWidth, minimum, std::numeric_limits<double>::infinity());
+        solver.updateVariables();
+    });
+
+    Solver rowSolver;
+    build_solver(rowSolver, widthVar, heightVar);
+    Constraint minConstraint = widthVar >= 300;
+    rowSolver.addConstraint(minConstraint);
+    ankerl::nanobench::Bench().minEpochIterations(10).run("move a minimum size with constraints", [&] {
+        minimum = minimum == 300 ? 700 : 300;
+        rowSolver.removeConstraint(minConstraint);
+        minConstraint = widthVar >= minimum;
+        rowSolver.addConstraint(minConstraint);
+        rowSolver.updateVariables();
+    });
+
+    bench_independent_windows<AssocVectorMapPolicy>("assoc vector");
+    bench_independent_windows<FlatHashMapPolicy>("flat hash map");
+
+    for (bool fresh : { true, false })
+    {
+        bench_widget_churn<AssocVectorMapPolicy>("assoc vector", fresh);
+        bench_widget_churn<FlatHashMapPolicy>("flat hash map", fresh);
     }
+
+    bench_map_policy<AssocVectorMapPolicy>("assoc vector");
+    bench_map_policy<FlatHashMapPolicy>("flat hash map");
+    bench_map_policy<BTreeMapPolicy>("b-tree");
+
+    bench_pivot_rule<BlandPivotRule>("bland");
+    bench_pivot_rule<DantzigPivotRule>("dantzig");
+    bench_pivot_rule<SteepestEdgePivotRule>("steepest edge");
 }
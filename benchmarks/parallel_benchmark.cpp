@@ -0,0 +1,184 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2020, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+
+// Time resizing many independent sub-layouts at once with a thread pool, a
+// single very large layout whose pivots are shared between the threads, and
+// precomputing the layouts of many window sizes on copies of the solver.
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include <kiwi/kiwi.h>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+
+using namespace kiwi;
+
+// Add a panel laying out n items in a row across its width. Each item has a
+// minimum width and prefers a width of its own, so shrinking the panel moves
+// the items and then shrinks them down to their minimums one after the
+// other, which takes pivots of the dual simplex method.
+void add_panel(Solver& solver, Variable& width, std::vector<Constraint>& minimums, int n)
+{
+    solver.addEditVariable(width, strength::strong);
+    std::vector<Variable> left(n), iwidth(n);
+    solver.addConstraint(left[0] == 8);
+    for (int i = 0; i < n; ++i)
+    {
+        minimums.push_back(iwidth[i] >= 20 + 5 * (i % 4));
+        solver.addConstraint(minimums.back());
+        solver.addConstraint((iwidth[i] == 60 + 10 * (i % 5)) | strength::weak);
+        if (i > 0)
+        {
+            solver.addConstraint(left[i] >= left[i - 1] + iwidth[i - 1] + 4);
+            solver.addConstraint((left[i] == left[i - 1] + iwidth[i - 1] + 4) | strength::medium);
+        }
+    }
+    solver.addConstraint(left[n - 1] + iwidth[n - 1] + 8 <= width);
+    solver.addConstraint((left[n - 1] + iwidth[n - 1] + 8 == width) | strength::weak);
+}
+
+// Time resizing all the panels of a window at once, and removing then adding
+// back a minimum width in every panel, with 1 to N threads.
+void bench_panels(int panels, int items)
+{
+    std::vector<std::size_t> threads;
+    std::size_t hardware = ThreadPool::defaultThreadCount();
+    for (std::size_t count = 1; count < hardware; count *= 2)
+        threads.push_back(count);
+    threads.push_back(hardware);
+
+    for (std::size_t count : threads)
+    {
+        std::string suffix = " (" + std::to_string(panels) + " panels of " + std::to_string(items) +
+                             " items, " + std::to_string(count) + " threads)";
+        ThreadPool pool(count);
+        Solver solver;
+        solver.setThreadPool(&pool);
+        std::vector<Variable> widths(panels);
+        std::vector<Constraint> minimums;
+        for (auto& width : widths)
+            add_panel(solver, width, minimums, items);
+
+        std::vector<std::pair<Variable, double>> suggestions;
+        for (auto& width : widths)
+            suggestions.push_back(std::make_pair(width, 0.0));
+        int step = 0;
+        std::size_t pivots = solver.pivotCount();
+        ankerl::nanobench::Bench().minEpochIterations(20).run("resizing" + suffix, [&] {
+            // Sweep back and forth between the preferred size and the minimums.
+            double width = items * (30 + 40 * ((step % 16 < 8 ? step % 8 : 7 - step % 8) / 7.0));
+            for (auto& suggestion : suggestions)
+                suggestion.second = width;
+            solver.suggestValues(suggestions.begin(), suggestions.end());
+            ++step;
+        });
+        std::printf("pivots%s: %.1f per resize\n", suffix.c_str(),
+                    static_cast<double>(solver.pivotCount() - pivots) / step);
+
+        std::vector<Constraint> removed;
+        for (std::size_t i = 0; i < minimums.size(); i += items)
+            removed.push_back(minimums[i]);
+        ankerl::nanobench::Bench().minEpochIterations(10).run("removing and adding a minimum per panel" + suffix, [&] {
+            solver.removeConstraints(removed.begin(), removed.end());
+            solver.addConstraints(removed.begin(), removed.end());
+        });
+    }
+}
+
+// Time resizing a single very wide panel, whose pivots substitute into
+// hundreds of rows, with 1 to N threads sharing each substitution.
+void bench_wide_panel(int items, std::size_t threshold)
+{
+    std::vector<std::size_t> threads;
+    std::size_t hardware = ThreadPool::defaultThreadCount();
+    for (std::size_t count = 1; count < hardware; count *= 2)
+        threads.push_back(count);
+    threads.push_back(hardware);
+
+    for (std::size_t count : threads)
+    {
+        std::string suffix = " (1 panel of " + std::to_string(items) + " items, " + std::to_string(count) +
+                             " threads, threshold " + std::to_string(threshold) + ")";
+        ThreadPool pool(count);
+        Solver solver;
+        solver.setThreadPool(&pool);
+        solver.setSubstituteThreshold(threshold);
+        Variable width;
+        std::vector<Constraint> minimums;
+        add_panel(solver, width, minimums, items);
+
+        int step = 0;
+        std::size_t pivots = solver.pivotCount();
+        ankerl::nanobench::Bench().minEpochIterations(4).run("resizing" + suffix, [&] {
+            double value = items * (30 + 40 * ((step % 16 < 8 ? step % 8 : 7 - step % 8) / 7.0));
+            solver.suggestValue(width, value);
+            ++step;
+        });
+        std::printf("pivots%s: %.1f per resize\n", suffix.c_str(),
+                    static_cast<double>(solver.pivotCount() - pivots) / step);
+    }
+}
+
+// Time precomputing the layouts of a window for many sizes, suggesting them
+// one after the other on the solver, and sweeping them with 1 to N threads.
+void bench_sweep(int panels, int items, int scenarios)
+{
+    std::vector<std::size_t> threads;
+    std::size_t hardware = ThreadPool::defaultThreadCount();
+    for (std::size_t count = 1; count < hardware; count *= 2)
+        threads.push_back(count);
+    threads.push_back(hardware);
+
+    Solver solver;
+    std::vector<Variable> widths(panels);
+    std::vector<Constraint> minimums;
+    for (auto& width : widths)
+        add_panel(solver, width, minimums, items);
+    std::vector<double> values;
+    for (int i = 0; i < scenarios; ++i)
+    {
+        for (int j = 0; j < panels; ++j)
+            values.push_back(items * (30 + 40 * ((i * 7 + j) % scenarios) / double(scenarios)));
+    }
+
+    std::string suffix = " (" + std::to_string(scenarios) + " sizes of " + std::to_string(panels) + " panels of " +
+                         std::to_string(items) + " items";
+    std::vector<double> results;
+    ankerl::nanobench::Bench().epochs(3).run("suggesting each size" + suffix + ")", [&] {
+        results.clear();
+        std::vector<std::pair<Variable, double>> suggestions;
+        for (int i = 0; i < scenarios; ++i)
+        {
+            suggestions.clear();
+            for (int j = 0; j < panels; ++j)
+                suggestions.push_back(std::make_pair(widths[j], values[i * panels + j]));
+            solver.suggestValues(suggestions.begin(), suggestions.end());
+            solver.updateVariables();
+            results.insert(results.end(), solver.values().begin(), solver.values().end());
+        }
+    });
+
+    for (std::size_t count : threads)
+    {
+        ThreadPool pool(count);
+        solver.setThreadPool(&pool);
+        ankerl::nanobench::Bench().epochs(3).run(
+            "sweeping the sizes" + suffix + ", " + std::to_string(count) + " threads)",
+            [&] { results = solver.sweep(widths, values.data(), scenarios); });
+        solver.setThreadPool(nullptr);
+    }
+}
+
+int main()
+{
+    bench_panels(64, 16);
+    bench_panels(256, 16);
+    bench_wide_panel(256, 64);
+    bench_sweep(4, 16, 256);
+}
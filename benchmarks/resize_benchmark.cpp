@@ -0,0 +1,82 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2020, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+
+// Time dragging the edge of a window pixel by pixel, with and without
+// answering the suggestions from the sensitivity of the basis, and from a
+// cache of the bases met while dragging back and forth.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <kiwi/kiwi.h>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+
+using namespace kiwi;
+
+// Add a window laying out n items in a row across its width. Each item has a
+// minimum width and prefers a width of its own, so the basis changes each time
+// the items stop moving or start shrinking, every few dozen pixels.
+void add_window(Solver& solver, Variable& width, int n)
+{
+    solver.addEditVariable(width, strength::strong);
+    std::vector<Variable> left(n), iwidth(n);
+    solver.addConstraint(left[0] == 8);
+    for (int i = 0; i < n; ++i)
+    {
+        solver.addConstraint(iwidth[i] >= 20 + 5 * (i % 4));
+        solver.addConstraint((iwidth[i] == 60 + 10 * (i % 5)) | strength::weak);
+        if (i > 0)
+        {
+            solver.addConstraint(left[i] >= left[i - 1] + iwidth[i - 1] + 4);
+            solver.addConstraint((left[i] == left[i - 1] + iwidth[i - 1] + 4) | strength::medium);
+        }
+    }
+    solver.addConstraint(left[n - 1] + iwidth[n - 1] + 8 <= width);
+    solver.addConstraint((left[n - 1] + iwidth[n - 1] + 8 == width) | strength::weak);
+}
+
+// Drag the width of a window of 16 items back and forth over 400 pixels, next
+// to other windows of the same solver, updating the variables which moved at
+// each frame.
+void bench_drag(int others, bool affine, std::size_t cache = 0)
+{
+    Solver solver;
+    std::vector<Variable> widths(others + 1);
+    for (auto& width : widths)
+        add_window(solver, width, 16);
+    if (affine)
+        solver.setAffineEdits({widths[0]});
+    solver.setBasisCacheSize(cache);
+
+    std::string name = std::string("dragging a window edge (") + std::to_string(others) + " other windows, " +
+                       (cache ? "basis cache)" : affine ? "affine edits)" : "dual simplex)");
+    int step = 0;
+    ankerl::nanobench::Bench().minEpochIterations(2000).run(name, [&] {
+        int offset = step % 800 < 400 ? step % 400 : 399 - step % 400;
+        solver.suggestValue(widths[0], 700.0 + offset);
+        ankerl::nanobench::doNotOptimizeAway(solver.updateChangedVariables());
+        ++step;
+    });
+    if (cache)
+    {
+        BasisCacheStats stats = solver.basisCacheStats();
+        std::printf("basis cache (%d other windows): %.1f%% hits, %zu bases, %zu bytes\n", others,
+                    100.0 * stats.hits / (stats.hits + stats.misses), stats.entries, stats.memory);
+    }
+}
+
+int main()
+{
+    for (int others : {0, 64, 1024})
+    {
+        bench_drag(others, false);
+        bench_drag(others, true);
+        bench_drag(others, true, 32);
+    }
+}
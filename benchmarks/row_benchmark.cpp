@@ -0,0 +1,69 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2020, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+
+// Time merging one tableau row into another as a function of row length.
+
+#include <kiwi/kiwi.h>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+
+using namespace kiwi::impl;
+
+// Build a row whose symbols are `first`, `first + stride`, ... so that two
+// rows built with the same stride and different offsets interleave.
+Row make_row(std::size_t length, Symbol::Id first, Symbol::Id stride)
+{
+    Row row(1.0);
+    for (std::size_t i = 0; i < length; ++i)
+        row.insert(Symbol(Symbol::Slack, first + i * stride), 1.0 + i);
+    return row;
+}
+
+// Reference implementation inserting the cells one at a time, which is
+// what Row::insert(const Row&, double) used to do.
+void insert_cell_by_cell(Row& row, const Row& other, double coefficient)
+{
+    row.add(other.constant() * coefficient);
+    for (const auto& cellPair : other.cells())
+        row.insert(cellPair.first, cellPair.second * coefficient);
+}
+
+int main()
+{
+    std::size_t lengths[] = { 8, 32, 128, 512, 2048 };
+
+    for (std::size_t length : lengths)
+    {
+        // Half of the symbols of `other` are new to `row`.
+        const Row row = make_row(length, 2, 2);
+        const Row other = make_row(length, length + 1, 1);
+        const std::string suffix = " " + std::to_string(length);
+
+        ankerl::nanobench::Bench().minEpochIterations(10).run("row merge" + suffix, [&] {
+            Row target(row);
+            target.insert(other, 2.0);
+            ankerl::nanobench::doNotOptimizeAway(target);
+        });
+
+        ankerl::nanobench::Bench().minEpochIterations(10).run("cell by cell insert" + suffix, [&] {
+            Row target(row);
+            insert_cell_by_cell(target, other, 2.0);
+            ankerl::nanobench::doNotOptimizeAway(target);
+        });
+
+        // Substituting a symbol which is present in the row.
+        const Symbol symbol(Symbol::Slack, 2 + 2 * (length / 2));
+        ankerl::nanobench::Bench().minEpochIterations(10).run("row substitute" + suffix, [&] {
+            Row target(row);
+            target.substitute(symbol, other);
+            ankerl::nanobench::doNotOptimizeAway(target);
+        });
+    }
+
+    return 0;
+}
@@ -130,6 +130,10 @@ namespace Loki
         : Base(alloc), MyCompare(comp)
         {}
 
+        explicit AssocVector(const A& alloc)
+        : Base(alloc), MyCompare(key_compare())
+        {}
+
         template <class InputIterator>
         AssocVector(InputIterator first, InputIterator last,
             const key_compare& comp = key_compare(),
@@ -140,12 +144,21 @@ namespace Loki
             std::sort(begin(), end(), me);
         }
 
+        AssocVector(const AssocVector&) = default;
+
+        // Declared explicitly since the user-declared copy assignment
+        // suppresses the implicit move operations, which turned every
+        // relocation of a vector of maps into deep copies.
+        AssocVector(AssocVector&&) = default;
+
         AssocVector& operator=(const AssocVector& rhs)
         {
             AssocVector(rhs).swap(*this);
             return *this;
         }
 
+        AssocVector& operator=(AssocVector&&) = default;
+
         // iterators:
         // The following are here because MWCW gets 'using' wrong
         iterator begin() { return Base::begin(); }
@@ -0,0 +1,70 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <cstddef>
+
+namespace kiwi
+{
+
+/* A read-only view over a contiguous array owned by someone else.
+
+This is the subset of std::span which is needed to expose the internal
+arrays of a solver, std::span not being available in c++11. The view is
+invalidated when the owner of the array modifies its size.
+
+*/
+template <typename T>
+class ArrayView
+{
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = const T *;
+    using const_iterator = const T *;
+
+    ArrayView() : m_data(nullptr), m_size(0) {}
+
+    ArrayView(const T *data, size_type size) : m_data(data), m_size(size) {}
+
+    const T *data() const
+    {
+        return m_data;
+    }
+
+    size_type size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    const T &operator[](size_type index) const
+    {
+        return m_data[index];
+    }
+
+    const_iterator begin() const
+    {
+        return m_data;
+    }
+
+    const_iterator end() const
+    {
+        return m_data + m_size;
+    }
+
+private:
+    const T *m_data;
+    size_type m_size;
+};
+
+} // namespace kiwi
@@ -0,0 +1,542 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2019, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace kiwi
+{
+
+namespace impl
+{
+
+/* A sorted map stored as a two-level B+-tree.
+
+The values are kept sorted in fixed size leaves, and a sorted vector of
+leaf pointers forms the root of the tree. Lookups binary search the root
+on the last key of each leaf, then the leaf itself. Insertions and
+erasures only move the values of a single leaf, plus the root when a leaf
+is split or merged, instead of the whole map as AssocVector does.
+
+The map follows the subset of the std::map interface used by the solver.
+Like AssocVector, its value_type is std::pair<K, V> and all iterators are
+invalidated by insertions and erasures. Iteration follows the key order.
+
+*/
+template <
+    typename K,
+    typename V,
+    typename C = std::less<K>,
+    typename A = std::allocator<std::pair<K, V>>>
+class BTreeMap
+{
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = C;
+    using allocator_type = A;
+
+private:
+    static const size_type leafSize = sizeof(value_type) >= 64 ? 8 : 512 / sizeof(value_type);
+
+    struct Leaf
+    {
+        value_type *values()
+        {
+            return reinterpret_cast<value_type *>(&storage);
+        }
+
+        size_type count;
+        typename std::aligned_storage<sizeof(value_type) * leafSize, alignof(value_type)>::type storage;
+    };
+
+    using Traits = std::allocator_traits<A>;
+    using LeafAllocator = typename Traits::template rebind_alloc<Leaf>;
+    using LeafVector = std::vector<Leaf *, typename Traits::template rebind_alloc<Leaf *>>;
+
+public:
+    template <typename Value>
+    class Iterator
+    {
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename BTreeMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value *;
+        using reference = Value &;
+
+        Iterator() : m_leaves(nullptr), m_leaf(0), m_pos(0) {}
+
+        Iterator(Leaf *const *leaves, size_type leaf, size_type pos) : m_leaves(leaves),
+                                                                       m_leaf(leaf),
+                                                                       m_pos(pos) {}
+
+        template <typename Other>
+        Iterator(const Iterator<Other> &other) : m_leaves(other.m_leaves),
+                                                 m_leaf(other.m_leaf),
+                                                 m_pos(other.m_pos) {}
+
+        reference operator*() const
+        {
+            return m_leaves[m_leaf]->values()[m_pos];
+        }
+
+        pointer operator->() const
+        {
+            return m_leaves[m_leaf]->values() + m_pos;
+        }
+
+        Iterator &operator++()
+        {
+            if (++m_pos == m_leaves[m_leaf]->count)
+            {
+                ++m_leaf;
+                m_pos = 0;
+            }
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator old(*this);
+            ++*this;
+            return old;
+        }
+
+        template <typename Other>
+        bool operator==(const Iterator<Other> &other) const
+        {
+            return m_leaf == other.m_leaf && m_pos == other.m_pos;
+        }
+
+        template <typename Other>
+        bool operator!=(const Iterator<Other> &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        template <typename Other>
+        friend class Iterator;
+
+        friend class BTreeMap;
+
+        Leaf *const *m_leaves;
+        size_type m_leaf;
+        size_type m_pos;
+    };
+
+    using iterator = Iterator<value_type>;
+    using const_iterator = Iterator<const value_type>;
+
+    explicit BTreeMap(const key_compare &comp = key_compare(), const A &alloc = A()) : m_leaves(alloc),
+                                                                                         m_size(0),
+                                                                                         m_alloc(alloc),
+                                                                                         m_comp(comp) {}
+
+    explicit BTreeMap(const A &alloc) : BTreeMap(key_compare(), alloc) {}
+
+    BTreeMap(const BTreeMap &other) : BTreeMap(other, Traits::select_on_container_copy_construction(other.m_alloc)) {}
+
+    BTreeMap(const BTreeMap &other, const A &alloc) : BTreeMap(other.m_comp, alloc)
+    {
+        m_leaves.reserve(other.m_leaves.size());
+        for (Leaf *leaf : other.m_leaves)
+        {
+            Leaf *copy = newLeaf();
+            m_leaves.push_back(copy);
+            for (size_type i = 0; i < leaf->count; ++i)
+            {
+                new (copy->values() + i) value_type(leaf->values()[i]);
+                ++copy->count;
+                ++m_size;
+            }
+        }
+    }
+
+    BTreeMap(BTreeMap &&other) noexcept : BTreeMap(other.m_comp, other.m_alloc)
+    {
+        swapLeaves(other);
+    }
+
+    ~BTreeMap()
+    {
+        clear();
+    }
+
+    BTreeMap &operator=(const BTreeMap &other)
+    {
+        if (this != &other)
+        {
+            BTreeMap copy(other, m_alloc);
+            swapLeaves(copy);
+        }
+        return *this;
+    }
+
+    /* The map keeps its allocator. The leaves of the other map are taken
+    only if it allocates from the same resource, otherwise its values are
+    moved one by one.
+
+    */
+    BTreeMap &operator=(BTreeMap &&other)
+    {
+        if (this != &other)
+        {
+            clear();
+            if (m_alloc == other.m_alloc)
+                swapLeaves(other);
+            else
+            {
+                m_comp = other.m_comp;
+                for (auto &value : other)
+                    insert(std::move(value));
+                other.clear();
+            }
+        }
+        return *this;
+    }
+
+    allocator_type get_allocator() const
+    {
+        return m_alloc;
+    }
+
+    key_compare key_comp() const
+    {
+        return m_comp;
+    }
+
+    iterator begin()
+    {
+        return iterator(m_leaves.data(), 0, 0);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(m_leaves.data(), 0, 0);
+    }
+
+    iterator end()
+    {
+        return iterator(m_leaves.data(), m_leaves.size(), 0);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(m_leaves.data(), m_leaves.size(), 0);
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    size_type size() const
+    {
+        return m_size;
+    }
+
+    iterator find(const key_type &key)
+    {
+        size_type leaf;
+        size_type pos;
+        if (!locate(key, leaf, pos))
+            return end();
+        return iterator(m_leaves.data(), leaf, pos);
+    }
+
+    const_iterator find(const key_type &key) const
+    {
+        size_type leaf;
+        size_type pos;
+        if (!locate(key, leaf, pos))
+            return end();
+        return const_iterator(m_leaves.data(), leaf, pos);
+    }
+
+    size_type count(const key_type &key) const
+    {
+        return find(key) != end();
+    }
+
+    mapped_type &operator[](const key_type &key)
+    {
+        return emplaceKey(key).first->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value)
+    {
+        return emplaceKey(value.first, value);
+    }
+
+    std::pair<iterator, bool> insert(value_type &&value)
+    {
+        return emplaceKey(value.first, std::move(value));
+    }
+
+    void erase(iterator pos)
+    {
+        eraseAt(pos.m_leaf, pos.m_pos);
+    }
+
+    size_type erase(const key_type &key)
+    {
+        size_type leaf;
+        size_type pos;
+        if (!locate(key, leaf, pos))
+            return 0;
+        eraseAt(leaf, pos);
+        return 1;
+    }
+
+    void clear()
+    {
+        for (Leaf *leaf : m_leaves)
+            deleteLeaf(leaf);
+        m_leaves.clear();
+        m_size = 0;
+    }
+
+    /* Swap the contents of the maps, which must allocate from the same
+    resource. The allocators are not swapped.
+
+    */
+    void swap(BTreeMap &other) noexcept
+    {
+        assert(m_alloc == other.m_alloc);
+        swapLeaves(other);
+    }
+
+private:
+    void swapLeaves(BTreeMap &other) noexcept
+    {
+        m_leaves.swap(other.m_leaves);
+        std::swap(m_size, other.m_size);
+        std::swap(m_comp, other.m_comp);
+    }
+
+    const key_type &lastKey(const Leaf *leaf) const
+    {
+        return const_cast<Leaf *>(leaf)->values()[leaf->count - 1].first;
+    }
+
+    /* Get the index of the first leaf which may contain the key.
+
+    This is the number of leaves if the key is past the last one.
+
+    */
+    size_type leafFor(const key_type &key) const
+    {
+        size_type first = 0;
+        size_type count = m_leaves.size();
+        while (count > 0)
+        {
+            size_type step = count / 2;
+            if (m_comp(lastKey(m_leaves[first + step]), key))
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+                count = step;
+        }
+        return first;
+    }
+
+    size_type lowerBound(Leaf *leaf, const key_type &key) const
+    {
+        value_type *values = leaf->values();
+        size_type first = 0;
+        size_type count = leaf->count;
+        while (count > 0)
+        {
+            size_type step = count / 2;
+            if (m_comp(values[first + step].first, key))
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+                count = step;
+        }
+        return first;
+    }
+
+    bool locate(const key_type &key, size_type &leaf, size_type &pos) const
+    {
+        leaf = leafFor(key);
+        if (leaf == m_leaves.size())
+            return false;
+        pos = lowerBound(m_leaves[leaf], key);
+        return !m_comp(key, m_leaves[leaf]->values()[pos].first);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplaceKey(const key_type &key, Args &&... args)
+    {
+        if (m_leaves.empty())
+            m_leaves.push_back(newLeaf());
+        size_type index = m_leaves[0]->count ? leafFor(key) : 0;
+        if (index == m_leaves.size())
+            --index;
+        Leaf *leaf = m_leaves[index];
+        size_type pos = lowerBound(leaf, key);
+        if (pos < leaf->count && !m_comp(key, leaf->values()[pos].first))
+            return std::make_pair(iterator(m_leaves.data(), index, pos), false);
+        if (leaf->count == leafSize)
+        {
+            splitLeaf(index);
+            if (pos > leaf->count)
+            {
+                pos -= leaf->count;
+                leaf = m_leaves[++index];
+            }
+        }
+        insertAt(leaf, pos, key, std::forward<Args>(args)...);
+        ++m_size;
+        return std::make_pair(iterator(m_leaves.data(), index, pos), true);
+    }
+
+    void insertAt(Leaf *leaf, size_type pos, const key_type &key)
+    {
+        insertAt(leaf, pos, key, value_type(key, mapped_type()));
+    }
+
+    template <typename Value>
+    void insertAt(Leaf *leaf, size_type pos, const key_type &, Value &&value)
+    {
+        value_type *values = leaf->values();
+        size_type count = leaf->count;
+        if (pos == count)
+            new (values + count) value_type(std::forward<Value>(value));
+        else
+        {
+            new (values + count) value_type(std::move(values[count - 1]));
+            std::move_backward(values + pos, values + count - 1, values + count);
+            values[pos] = std::forward<Value>(value);
+        }
+        ++leaf->count;
+    }
+
+    /* Move the upper half of a full leaf into a new leaf following it.
+
+    */
+    void splitLeaf(size_type index)
+    {
+        Leaf *leaf = m_leaves[index];
+        Leaf *next = newLeaf();
+        m_leaves.insert(m_leaves.begin() + index + 1, next);
+        size_type half = leaf->count / 2;
+        moveValues(leaf, half, leaf->count, next);
+    }
+
+    /* Erase a value, merging its leaf with a neighbour once it becomes
+    sparse so that leaves stay at least a quarter full on average.
+
+    */
+    void eraseAt(size_type index, size_type pos)
+    {
+        Leaf *leaf = m_leaves[index];
+        value_type *values = leaf->values();
+        std::move(values + pos + 1, values + leaf->count, values + pos);
+        values[--leaf->count].~value_type();
+        --m_size;
+        if (leaf->count == 0)
+        {
+            deleteLeaf(leaf);
+            m_leaves.erase(m_leaves.begin() + index);
+        }
+        else if (leaf->count < leafSize / 4)
+        {
+            if (index + 1 < m_leaves.size() && mergeable(leaf, m_leaves[index + 1]))
+                mergeLeaves(index);
+            else if (index > 0 && mergeable(m_leaves[index - 1], leaf))
+                mergeLeaves(index - 1);
+        }
+    }
+
+    static bool mergeable(const Leaf *first, const Leaf *second)
+    {
+        return first->count + second->count <= leafSize * 3 / 4;
+    }
+
+    /* Move the values of the leaf following the given one into it.
+
+    */
+    void mergeLeaves(size_type index)
+    {
+        Leaf *next = m_leaves[index + 1];
+        moveValues(next, 0, next->count, m_leaves[index]);
+        deleteLeaf(next);
+        m_leaves.erase(m_leaves.begin() + index + 1);
+    }
+
+    /* Move the values [first, last) of a leaf to the end of another one.
+
+    The moved values must be at the end of the source leaf.
+
+    */
+    static void moveValues(Leaf *source, size_type first, size_type last, Leaf *target)
+    {
+        value_type *from = source->values();
+        value_type *to = target->values() + target->count;
+        for (size_type i = first; i < last; ++i, ++to)
+        {
+            new (to) value_type(std::move(from[i]));
+            from[i].~value_type();
+        }
+        target->count += last - first;
+        source->count = first;
+    }
+
+    Leaf *newLeaf()
+    {
+        LeafAllocator allocator(m_alloc);
+        Leaf *leaf = allocator.allocate(1);
+        leaf->count = 0;
+        return leaf;
+    }
+
+    void deleteLeaf(Leaf *leaf)
+    {
+        value_type *values = leaf->values();
+        for (size_type i = 0; i < leaf->count; ++i)
+            values[i].~value_type();
+        LeafAllocator allocator(m_alloc);
+        allocator.deallocate(leaf, 1);
+    }
+
+    LeafVector m_leaves;
+    size_type m_size;
+    A m_alloc;
+    C m_comp;
+};
+
+template <typename K, typename V, typename C, typename A>
+void swap(BTreeMap<K, V, C, A> &lhs, BTreeMap<K, V, C, A> &rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace impl
+
+} // namespace kiwi
@@ -6,6 +6,8 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <cstddef>
+#include <functional>
 #include <map>
 #include <vector>
 #include "expression.h"
@@ -107,6 +109,8 @@ private:
 
     SharedDataPtr<ConstraintData> m_data;
 
+    friend struct std::hash<Constraint>;
+
     friend bool operator<(const Constraint &lhs, const Constraint &rhs)
     {
         return lhs.m_data < rhs.m_data;
@@ -123,4 +127,60 @@ private:
     }
 };
 
+// Refers to a constraint added to a solver, so that the solver can remove it
+// or test for it without looking the constraint up. A handle is valid for the
+// solver which returned it, and for the clones of that solver, until the
+// constraint is removed. The default handle refers to no constraint.
+class ConstraintHandle
+{
+
+public:
+    ConstraintHandle() = default;
+
+    ConstraintHandle(std::size_t slot, std::size_t generation) : m_slot(slot), m_generation(generation) {}
+
+    std::size_t slot() const
+    {
+        return m_slot;
+    }
+
+    std::size_t generation() const
+    {
+        return m_generation;
+    }
+
+    bool operator!() const
+    {
+        return m_generation == 0;
+    }
+
+private:
+    std::size_t m_slot = 0;
+    std::size_t m_generation = 0;
+
+    friend bool operator==(const ConstraintHandle &lhs, const ConstraintHandle &rhs)
+    {
+        return lhs.m_slot == rhs.m_slot && lhs.m_generation == rhs.m_generation;
+    }
+
+    friend bool operator!=(const ConstraintHandle &lhs, const ConstraintHandle &rhs)
+    {
+        return !(lhs == rhs);
+    }
+};
+
 } // namespace kiwi
+
+namespace std
+{
+
+template <>
+struct hash<kiwi::Constraint>
+{
+    size_t operator()(const kiwi::Constraint &constraint) const noexcept
+    {
+        return hash<const void *>()(constraint.m_data.data());
+    }
+};
+
+} // namespace std
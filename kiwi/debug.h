@@ -23,36 +23,45 @@ class DebugHelper
 {
 
 public:
-    static void dump(const SolverImpl &solver, std::ostream &out)
+    template <typename MapPolicy, typename PivotRule>
+    static void dump(const SolverImpl<MapPolicy, PivotRule> &solver, std::ostream &out)
     {
         out << "Objective" << std::endl;
         out << "---------" << std::endl;
-        dump(*solver.m_objective, out);
+        Row objective;
+        for (const auto &component : solver.m_components)
+        {
+            if (component.objective)
+                objective.insert(*component.objective);
+        }
+        dump(objective, out);
         out << std::endl;
         out << "Tableau" << std::endl;
         out << "-------" << std::endl;
-        dump(solver.m_rows, out);
+        for (const auto &component : solver.m_components)
+            dumpRows(component.rows, out);
         out << std::endl;
         out << "Infeasible" << std::endl;
         out << "----------" << std::endl;
-        dump(solver.m_infeasible_rows, out);
+        dumpSymbols(solver.m_pass.infeasible, out);
         out << std::endl;
         out << "Variables" << std::endl;
         out << "---------" << std::endl;
-        dump(solver.m_vars, out);
+        dumpVars(solver.m_vars, out);
         out << std::endl;
         out << "Edit Variables" << std::endl;
         out << "--------------" << std::endl;
-        dump(solver.m_edits, out);
+        dumpEdits(solver.m_edits, out);
         out << std::endl;
         out << "Constraints" << std::endl;
         out << "-----------" << std::endl;
-        dump(solver.m_cns, out);
+        dumpConstraints(solver.m_cns, solver.m_cn_slots, out);
         out << std::endl;
         out << std::endl;
     }
 
-    static void dump(const SolverImpl::RowMap &rows, std::ostream &out)
+    template <typename RowMap>
+    static void dumpRows(const RowMap &rows, std::ostream &out)
     {
         for (const auto &rowPair : rows)
         {
@@ -62,7 +71,8 @@ public:
         }
     }
 
-    static void dump(const std::vector<Symbol> &symbols, std::ostream &out)
+    template <typename SymbolList>
+    static void dumpSymbols(const SymbolList &symbols, std::ostream &out)
     {
         for (const auto &symbol : symbols)
         {
@@ -71,7 +81,8 @@ public:
         }
     }
 
-    static void dump(const SolverImpl::VarMap &vars, std::ostream &out)
+    template <typename VarMap>
+    static void dumpVars(const VarMap &vars, std::ostream &out)
     {
         for (const auto &varPair : vars)
         {
@@ -81,13 +92,19 @@ public:
         }
     }
 
-    static void dump(const SolverImpl::CnMap &cns, std::ostream &out)
+    template <typename CnMap, typename CnSlotList>
+    static void dumpConstraints(const CnMap &cns, const CnSlotList &slots, std::ostream &out)
     {
+        // The entries of removed constraints are left in the map.
         for (const auto &cnPair : cns)
-            dump(cnPair.first, out);
+        {
+            if (cnPair.second < slots.size() && slots[cnPair.second].constraint == cnPair.first)
+                dump(cnPair.first, out);
+        }
     }
 
-    static void dump(const SolverImpl::EditMap &edits, std::ostream &out)
+    template <typename EditMap>
+    static void dumpEdits(const EditMap &edits, std::ostream &out)
     {
         for (const auto &editPair : edits)
             out << editPair.first.name() << std::endl;
@@ -122,6 +139,9 @@ public:
         case Symbol::Dummy:
             out << "d";
             break;
+        case Symbol::Bound:
+            out << "b";
+            break;
         default:
             break;
         }
@@ -6,6 +6,7 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <cstddef>
 #include <exception>
 #include <string>
 #include "constraint.h"
@@ -14,6 +15,17 @@
 namespace kiwi
 {
 
+// The outcome of the try methods of the solver. Each failure stands for
+// the exception thrown by the method of the same name without the prefix.
+enum Status
+{
+    STATUS_OK,
+    STATUS_DUPLICATE_CONSTRAINT,
+    STATUS_UNSATISFIABLE_CONSTRAINT,
+    STATUS_UNKNOWN_CONSTRAINT,
+    STATUS_UNKNOWN_EDIT_VARIABLE
+};
+
 class UnsatisfiableConstraint : public std::exception
 {
 
@@ -58,6 +70,28 @@ private:
     Constraint m_constraint;
 };
 
+class UnknownConstraintHandle : public std::exception
+{
+
+public:
+    UnknownConstraintHandle(ConstraintHandle handle) : m_handle(handle) {}
+
+    ~UnknownConstraintHandle() noexcept {}
+
+    const char *what() const noexcept
+    {
+        return "The handle does not refer to a constraint of the solver.";
+    }
+
+    ConstraintHandle handle() const
+    {
+        return m_handle;
+    }
+
+private:
+    ConstraintHandle m_handle;
+};
+
 class DuplicateConstraint : public std::exception
 {
 
@@ -138,6 +172,28 @@ public:
     }
 };
 
+class UnknownCheckpoint : public std::exception
+{
+
+public:
+    UnknownCheckpoint(std::size_t token) : m_token(token) {}
+
+    ~UnknownCheckpoint() noexcept {}
+
+    const char *what() const noexcept
+    {
+        return "The checkpoint is not held by the solver.";
+    }
+
+    std::size_t token() const
+    {
+        return m_token;
+    }
+
+private:
+    std::size_t m_token;
+};
+
 class InternalSolverError : public std::exception
 {
 
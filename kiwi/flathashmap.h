@@ -0,0 +1,490 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2019, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace kiwi
+{
+
+namespace impl
+{
+
+/* Key equality derived from a strict weak ordering.
+
+Variable overloads operator== to build constraints, so the hashed maps
+compare keys through operator< instead.
+
+*/
+template <typename K, typename C = std::less<K>>
+struct KeyEquivalent
+{
+    bool operator()(const K &lhs, const K &rhs) const
+    {
+        return !C()(lhs, rhs) && !C()(rhs, lhs);
+    }
+};
+
+/* An open-addressing hash map with linear probing.
+
+The values are stored inline in a single array whose size is a power of
+two, next to an array of occupancy flags. Lookups hash the key once and
+then scan consecutive slots, so a hit usually costs a single cache miss.
+Erasing uses backward-shift deletion, which keeps probe sequences short
+without tombstones.
+
+The map follows the subset of the std::map interface used by the solver.
+Like AssocVector, its value_type is std::pair<K, V> and all iterators are
+invalidated by insertions and erasures. Iteration follows the slot order,
+not the key order.
+
+*/
+template <
+    typename K,
+    typename V,
+    typename H = std::hash<K>,
+    typename E = KeyEquivalent<K>,
+    typename A = std::allocator<std::pair<K, V>>>
+class FlatHashMap
+{
+
+    using Traits = std::allocator_traits<A>;
+    using FlagAllocator = typename Traits::template rebind_alloc<unsigned char>;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = H;
+    using key_equal = E;
+    using allocator_type = A;
+
+    template <typename Value>
+    class Iterator
+    {
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value *;
+        using reference = Value &;
+
+        Iterator() : m_slots(nullptr), m_used(nullptr), m_index(0), m_capacity(0) {}
+
+        Iterator(Value *slots, const unsigned char *used, size_type index, size_type capacity) : m_slots(slots),
+                                                                                               m_used(used),
+                                                                                               m_index(index),
+                                                                                               m_capacity(capacity)
+        {
+            skip();
+        }
+
+        template <typename Other>
+        Iterator(const Iterator<Other> &other) : m_slots(other.m_slots),
+                                                 m_used(other.m_used),
+                                                 m_index(other.m_index),
+                                                 m_capacity(other.m_capacity) {}
+
+        reference operator*() const
+        {
+            return m_slots[m_index];
+        }
+
+        pointer operator->() const
+        {
+            return m_slots + m_index;
+        }
+
+        Iterator &operator++()
+        {
+            ++m_index;
+            skip();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator old(*this);
+            ++*this;
+            return old;
+        }
+
+        template <typename Other>
+        bool operator==(const Iterator<Other> &other) const
+        {
+            return m_index == other.m_index;
+        }
+
+        template <typename Other>
+        bool operator!=(const Iterator<Other> &other) const
+        {
+            return m_index != other.m_index;
+        }
+
+    private:
+        template <typename Other>
+        friend class Iterator;
+
+        friend class FlatHashMap;
+
+        void skip()
+        {
+            while (m_index < m_capacity && !m_used[m_index])
+                ++m_index;
+        }
+
+        Value *m_slots;
+        const unsigned char *m_used;
+        size_type m_index;
+        size_type m_capacity;
+    };
+
+    using iterator = Iterator<value_type>;
+    using const_iterator = Iterator<const value_type>;
+
+    explicit FlatHashMap(const A &alloc = A()) : m_alloc(alloc),
+                                                 m_slots(nullptr),
+                                                 m_used(nullptr),
+                                                 m_capacity(0),
+                                                 m_size(0),
+                                                 m_shift(8 * sizeof(unsigned long long)) {}
+
+    FlatHashMap(const FlatHashMap &other) : FlatHashMap(other, Traits::select_on_container_copy_construction(other.m_alloc)) {}
+
+    FlatHashMap(const FlatHashMap &other, const A &alloc) : FlatHashMap(alloc)
+    {
+        if (other.m_size)
+        {
+            allocateSlots(other.m_capacity);
+            for (size_type i = 0; i < m_capacity; ++i)
+            {
+                if (other.m_used[i])
+                {
+                    new (m_slots + i) value_type(other.m_slots[i]);
+                    m_used[i] = 1;
+                    ++m_size;
+                }
+            }
+        }
+    }
+
+    FlatHashMap(FlatHashMap &&other) noexcept : FlatHashMap(other.m_alloc)
+    {
+        swapSlots(other);
+    }
+
+    ~FlatHashMap()
+    {
+        clear();
+        deallocateSlots();
+    }
+
+    FlatHashMap &operator=(const FlatHashMap &other)
+    {
+        if (this != &other)
+        {
+            FlatHashMap copy(other, m_alloc);
+            swapSlots(copy);
+        }
+        return *this;
+    }
+
+    /* The map keeps its allocator. The slots of the other map are taken
+    only if it allocates from the same resource, otherwise its values are
+    moved one by one.
+
+    */
+    FlatHashMap &operator=(FlatHashMap &&other)
+    {
+        if (this != &other)
+        {
+            clear();
+            if (m_alloc == other.m_alloc)
+                swapSlots(other);
+            else
+            {
+                for (auto &value : other)
+                    insert(std::move(value));
+                other.clear();
+            }
+        }
+        return *this;
+    }
+
+    allocator_type get_allocator() const
+    {
+        return m_alloc;
+    }
+
+    iterator begin()
+    {
+        return iterator(m_slots, m_used, 0, m_capacity);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(m_slots, m_used, 0, m_capacity);
+    }
+
+    iterator end()
+    {
+        return iterator(m_slots, m_used, m_capacity, m_capacity);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(m_slots, m_used, m_capacity, m_capacity);
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    size_type size() const
+    {
+        return m_size;
+    }
+
+    iterator find(const key_type &key)
+    {
+        return iterator(m_slots, m_used, lookup(key), m_capacity);
+    }
+
+    const_iterator find(const key_type &key) const
+    {
+        return const_iterator(m_slots, m_used, lookup(key), m_capacity);
+    }
+
+    size_type count(const key_type &key) const
+    {
+        return lookup(key) != m_capacity;
+    }
+
+    mapped_type &operator[](const key_type &key)
+    {
+        return emplaceKey(key).first->second;
+    }
+
+    std::pair<iterator, bool> insert(const value_type &value)
+    {
+        return emplaceKey(value.first, value);
+    }
+
+    std::pair<iterator, bool> insert(value_type &&value)
+    {
+        return emplaceKey(value.first, std::move(value));
+    }
+
+    void erase(iterator pos)
+    {
+        eraseAt(pos.m_index);
+    }
+
+    size_type erase(const key_type &key)
+    {
+        size_type index = lookup(key);
+        if (index == m_capacity)
+            return 0;
+        eraseAt(index);
+        return 1;
+    }
+
+    void clear()
+    {
+        for (size_type i = 0; m_size && i < m_capacity; ++i)
+        {
+            if (m_used[i])
+            {
+                m_slots[i].~value_type();
+                m_used[i] = 0;
+                --m_size;
+            }
+        }
+    }
+
+    /* Swap the contents of the maps, which must allocate from the same
+    resource. The allocators are not swapped.
+
+    */
+    void swap(FlatHashMap &other) noexcept
+    {
+        assert(m_alloc == other.m_alloc);
+        swapSlots(other);
+    }
+
+private:
+    static const size_type minCapacity = 8;
+
+    void swapSlots(FlatHashMap &other) noexcept
+    {
+        std::swap(m_slots, other.m_slots);
+        std::swap(m_used, other.m_used);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_size, other.m_size);
+        std::swap(m_shift, other.m_shift);
+    }
+
+    /* Map a hash to its home slot with Fibonacci hashing.
+
+    Pointer and sequential id hashes have poor low bits, the multiplication
+    spreads every input bit over the high bits kept by the shift.
+
+    */
+    size_type home(const key_type &key) const
+    {
+        unsigned long long h = static_cast<unsigned long long>(H()(key));
+        return static_cast<size_type>((h * 0x9E3779B97F4A7C15ULL) >> m_shift);
+    }
+
+    size_type lookup(const key_type &key) const
+    {
+        if (m_size == 0)
+            return m_capacity;
+        size_type mask = m_capacity - 1;
+        for (size_type i = home(key);; i = (i + 1) & mask)
+        {
+            if (!m_used[i])
+                return m_capacity;
+            if (E()(m_slots[i].first, key))
+                return i;
+        }
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplaceKey(const key_type &key, Args &&... args)
+    {
+        size_type index = lookup(key);
+        if (index != m_capacity)
+            return std::make_pair(iterator(m_slots, m_used, index, m_capacity), false);
+        if ((m_size + 1) * 4 > m_capacity * 3)
+            rehash(m_capacity ? m_capacity * 2 : minCapacity);
+        size_type mask = m_capacity - 1;
+        index = home(key);
+        while (m_used[index])
+            index = (index + 1) & mask;
+        constructAt(index, key, std::forward<Args>(args)...);
+        m_used[index] = 1;
+        ++m_size;
+        return std::make_pair(iterator(m_slots, m_used, index, m_capacity), true);
+    }
+
+    void constructAt(size_type index, const key_type &key)
+    {
+        new (m_slots + index) value_type(key, mapped_type());
+    }
+
+    template <typename Value>
+    void constructAt(size_type index, const key_type &, Value &&value)
+    {
+        new (m_slots + index) value_type(std::forward<Value>(value));
+    }
+
+    /* Erase the slot and shift back the following entries of its cluster.
+
+    An entry is moved into the hole unless its home slot lies cyclically
+    between the hole and its current position.
+
+    */
+    void eraseAt(size_type hole)
+    {
+        size_type mask = m_capacity - 1;
+        m_slots[hole].~value_type();
+        m_used[hole] = 0;
+        --m_size;
+        for (size_type i = (hole + 1) & mask; m_used[i]; i = (i + 1) & mask)
+        {
+            size_type h = home(m_slots[i].first);
+            if (((i - h) & mask) < ((i - hole) & mask))
+                continue;
+            new (m_slots + hole) value_type(std::move(m_slots[i]));
+            m_slots[i].~value_type();
+            m_used[hole] = 1;
+            m_used[i] = 0;
+            hole = i;
+        }
+    }
+
+    void rehash(size_type capacity)
+    {
+        value_type *slots = m_slots;
+        unsigned char *used = m_used;
+        size_type oldCapacity = m_capacity;
+        allocateSlots(capacity);
+        size_type mask = m_capacity - 1;
+        for (size_type i = 0; i < oldCapacity; ++i)
+        {
+            if (used[i])
+            {
+                size_type index = home(slots[i].first);
+                while (m_used[index])
+                    index = (index + 1) & mask;
+                new (m_slots + index) value_type(std::move(slots[i]));
+                m_used[index] = 1;
+                slots[i].~value_type();
+            }
+        }
+        if (slots)
+        {
+            m_alloc.deallocate(slots, oldCapacity);
+            FlagAllocator(m_alloc).deallocate(used, oldCapacity);
+        }
+    }
+
+    void allocateSlots(size_type capacity)
+    {
+        m_slots = m_alloc.allocate(capacity);
+        m_used = FlagAllocator(m_alloc).allocate(capacity);
+        std::fill(m_used, m_used + capacity, static_cast<unsigned char>(0));
+        m_capacity = capacity;
+        m_shift = 8 * sizeof(unsigned long long);
+        while (capacity > 1)
+        {
+            capacity >>= 1;
+            --m_shift;
+        }
+    }
+
+    void deallocateSlots()
+    {
+        if (m_slots)
+        {
+            m_alloc.deallocate(m_slots, m_capacity);
+            FlagAllocator(m_alloc).deallocate(m_used, m_capacity);
+        }
+        m_slots = nullptr;
+        m_used = nullptr;
+        m_capacity = 0;
+    }
+
+    A m_alloc;
+    value_type *m_slots;
+    unsigned char *m_used;
+    size_type m_capacity;
+    size_type m_size;
+    unsigned m_shift;
+};
+
+template <typename K, typename V, typename H, typename E, typename A>
+void swap(FlatHashMap<K, V, H, E, A> &lhs, FlatHashMap<K, V, H, E, A> &rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace impl
+
+} // namespace kiwi
@@ -6,14 +6,19 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include "arrayview.h"
 #include "constraint.h"
 #include "debug.h"
 #include "errors.h"
 #include "expression.h"
+#include "memoryresource.h"
+#include "pivotrule.h"
+#include "sensitivity.h"
 #include "shareddata.h"
 #include "solver.h"
 #include "strength.h"
 #include "symbolics.h"
 #include "term.h"
+#include "threadpool.h"
 #include "variable.h"
 #include "version.h"
@@ -7,30 +7,65 @@
 |----------------------------------------------------------------------------*/
 #pragma once
 #include <functional>
-#include <map>
 #include <memory>
 #include <utility>
 #include "AssocVector.h"
+#include "btreemap.h"
+#include "flathashmap.h"
+#include "memoryresource.h"
 
 namespace kiwi
 {
 
+/* Map policies select the map type used for every map of a solver.
+
+A policy provides a `Map<K, V>` alias template. Every map type must follow
+the subset of the std::map interface used by the solver, including a
+constructor taking an allocator, and draw its memory from a
+ResourceAllocator.
+
+*/
+
+/* Sorted vectors: the fastest iteration, but O(n) insertion and erasure.
+
+*/
+struct AssocVectorMapPolicy
+{
+    template <typename K, typename V>
+    using Map = Loki::AssocVector<K, V, std::less<K>, impl::ResourceAllocator<std::pair<K, V>>>;
+};
+
+/* Open-addressing hash maps: O(1) lookup, insertion and erasure, but the
+iteration order does not follow the symbol ids.
+
+*/
+struct FlatHashMapPolicy
+{
+    template <typename K, typename V>
+    using Map = impl::FlatHashMap<K, V, std::hash<K>, impl::KeyEquivalent<K>, impl::ResourceAllocator<std::pair<K, V>>>;
+};
+
+/* Two-level B+-trees: sorted like AssocVector, with insertions and erasures
+only moving the values of a single leaf.
+
+*/
+struct BTreeMapPolicy
+{
+    template <typename K, typename V>
+    using Map = impl::BTreeMap<K, V, std::less<K>, impl::ResourceAllocator<std::pair<K, V>>>;
+};
+
+#ifdef KIWI_DEFAULT_MAP_POLICY
+using DefaultMapPolicy = KIWI_DEFAULT_MAP_POLICY;
+#else
+using DefaultMapPolicy = AssocVectorMapPolicy;
+#endif
+
 namespace impl
 {
 
-template <
-    typename K,
-    typename V,
-    typename C = std::less<K>,
-    typename A = std::allocator<std::pair<K, V>>>
-using MapType = Loki::AssocVector<K, V, C, A>;
-
-// template<
-// 	typename K,
-// 	typename V,
-// 	typename C = std::less<K>,
-// 	typename A = std::allocator< std::pair<const K, V> > >
-// using MapType = std::map<K, V, C, A>;
+template <typename K, typename V>
+using MapType = DefaultMapPolicy::Map<K, V>;
 
 } // namespace impl
 
@@ -0,0 +1,374 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/*
+Implementation note
+===================
+MemoryResource mirrors the interface of std::pmr::memory_resource, which is
+not available in c++11. All the memory used by a solver (the rows of the
+tableau, the maps and the scratch vectors) is obtained from the resource
+passed to its constructor, so a single arena can back a whole solver and be
+released in one shot once the solver is destroyed.
+*/
+
+namespace kiwi
+{
+
+class MemoryResource
+{
+
+public:
+    MemoryResource() = default;
+
+    virtual ~MemoryResource() {} // LCOV_EXCL_LINE
+
+    void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        return doAllocate(bytes, alignment);
+    }
+
+    void deallocate(void *p, std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        doDeallocate(p, bytes, alignment);
+    }
+
+    bool isEqual(const MemoryResource &other) const noexcept
+    {
+        return this == &other || doIsEqual(other);
+    }
+
+protected:
+    virtual void *doAllocate(std::size_t bytes, std::size_t alignment) = 0;
+
+    virtual void doDeallocate(void *p, std::size_t bytes, std::size_t alignment) = 0;
+
+    virtual bool doIsEqual(const MemoryResource &other) const noexcept
+    {
+        return this == &other;
+    }
+
+private:
+    MemoryResource(const MemoryResource &other);
+
+    MemoryResource &operator=(const MemoryResource &other);
+};
+
+namespace impl
+{
+
+class NewDeleteResource : public MemoryResource
+{
+
+protected:
+    void *doAllocate(std::size_t bytes, std::size_t) override
+    {
+        return ::operator new(bytes);
+    }
+
+    void doDeallocate(void *p, std::size_t, std::size_t) override
+    {
+        ::operator delete(p);
+    }
+};
+
+} // namespace impl
+
+/* Get the resource using the global operator new and operator delete.
+
+This is the resource used by a solver when none is specified.
+
+*/
+inline MemoryResource *newDeleteResource()
+{
+    static impl::NewDeleteResource resource;
+    return &resource;
+}
+
+/* A resource handing out memory from chunks which are only freed at once.
+
+Deallocation is a no-op, the memory is returned to the upstream resource
+when the resource is released or destroyed. The resource is not thread
+safe, and must outlive every solver using it.
+
+*/
+class MonotonicResource : public MemoryResource
+{
+
+public:
+    explicit MonotonicResource(std::size_t initialSize = 4096,
+                               MemoryResource *upstream = newDeleteResource()) : m_upstream(upstream),
+                                                                                 m_chunks(nullptr),
+                                                                                 m_current(nullptr),
+                                                                                 m_left(0),
+                                                                                 m_nextSize(initialSize < 64 ? 64 : initialSize) {}
+
+    ~MonotonicResource()
+    {
+        release();
+    }
+
+    /* Return all the memory obtained from the upstream resource.
+
+	*/
+    void release()
+    {
+        while (m_chunks)
+        {
+            Chunk *next = m_chunks->next;
+            m_upstream->deallocate(m_chunks, m_chunks->size, alignof(Chunk));
+            m_chunks = next;
+        }
+        m_current = nullptr;
+        m_left = 0;
+    }
+
+    MemoryResource *upstream() const
+    {
+        return m_upstream;
+    }
+
+protected:
+    void *doAllocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void *p = alignedTake(bytes, alignment);
+        if (p)
+            return p;
+        std::size_t needed = sizeof(Chunk) + bytes + alignment;
+        while (m_nextSize < needed)
+            m_nextSize *= 2;
+        Chunk *chunk = static_cast<Chunk *>(m_upstream->allocate(m_nextSize, alignof(Chunk)));
+        chunk->next = m_chunks;
+        chunk->size = m_nextSize;
+        m_chunks = chunk;
+        m_current = reinterpret_cast<char *>(chunk + 1);
+        m_left = m_nextSize - sizeof(Chunk);
+        if (m_nextSize < maxChunkSize)
+            m_nextSize *= 2;
+        return alignedTake(bytes, alignment);
+    }
+
+    void doDeallocate(void *, std::size_t, std::size_t) override {}
+
+private:
+    /* Chunks stop growing at this size, so they are served by the upstream
+    heap instead of fresh pages mapped for each chunk. */
+    static const std::size_t maxChunkSize = 64 * 1024;
+
+    struct Chunk
+    {
+        Chunk *next;
+        std::size_t size;
+        std::max_align_t align;
+    };
+
+    void *alignedTake(std::size_t bytes, std::size_t alignment)
+    {
+        if (!m_current)
+            return nullptr;
+        std::size_t misalign = reinterpret_cast<std::size_t>(m_current) % alignment;
+        std::size_t padding = misalign ? alignment - misalign : 0;
+        if (m_left < padding + bytes)
+            return nullptr;
+        void *p = m_current + padding;
+        m_current += padding + bytes;
+        m_left -= padding + bytes;
+        return p;
+    }
+
+    MemoryResource *m_upstream;
+    Chunk *m_chunks;
+    char *m_current;
+    std::size_t m_left;
+    std::size_t m_nextSize;
+};
+
+/* A resource recycling freed blocks through per-size free lists.
+
+Requests are rounded up to a power of two and served from a free list of
+that size, which is refilled from a MonotonicResource. Freed blocks are
+kept for later requests of the same size instead of being returned to the
+upstream resource, so containers which grow and shrink reuse the same
+memory. Everything is returned to the upstream resource at once when the
+resource is released or destroyed. The resource is not thread safe, and
+must outlive every solver using it.
+
+*/
+class PoolResource : public MemoryResource
+{
+
+public:
+    explicit PoolResource(std::size_t initialSize = 4096,
+                          MemoryResource *upstream = newDeleteResource()) : m_arena(initialSize, upstream)
+    {
+        for (std::size_t i = 0; i < classCount; ++i)
+            m_free[i] = nullptr;
+    }
+
+    /* Return all the memory obtained from the upstream resource.
+
+	*/
+    void release()
+    {
+        m_arena.release();
+        for (std::size_t i = 0; i < classCount; ++i)
+            m_free[i] = nullptr;
+    }
+
+    MemoryResource *upstream() const
+    {
+        return m_arena.upstream();
+    }
+
+protected:
+    void *doAllocate(std::size_t bytes, std::size_t alignment) override
+    {
+        std::size_t index = classIndex(bytes, alignment);
+        Block *block = m_free[index];
+        if (block)
+        {
+            m_free[index] = block->next;
+            return block;
+        }
+        std::size_t size = minSize << index;
+        return m_arena.allocate(size, size < alignment ? alignment : alignof(std::max_align_t));
+    }
+
+    void doDeallocate(void *p, std::size_t bytes, std::size_t alignment) override
+    {
+        std::size_t index = classIndex(bytes, alignment);
+        Block *block = static_cast<Block *>(p);
+        block->next = m_free[index];
+        m_free[index] = block;
+    }
+
+private:
+    struct Block
+    {
+        Block *next;
+    };
+
+    static const std::size_t minSize = sizeof(std::max_align_t);
+
+    static const std::size_t classCount = 8 * sizeof(std::size_t) - 4;
+
+    static std::size_t classIndex(std::size_t bytes, std::size_t alignment)
+    {
+        if (bytes < alignment)
+            bytes = alignment;
+        std::size_t index = 0;
+        while ((minSize << index) < bytes)
+            ++index;
+        return index;
+    }
+
+    MonotonicResource m_arena;
+    Block *m_free[classCount];
+};
+
+namespace impl
+{
+
+/* A c++11 allocator drawing its memory from a MemoryResource.
+
+Containers using it are bound to their resource for their whole life: a
+container copied or moved from another one takes its allocator, and
+assignments and swaps never replace it. Containers can only be swapped with
+other containers using the same resource. Assigning from a container using
+another resource copies or moves its values one by one.
+
+*/
+template <typename T>
+class ResourceAllocator
+{
+
+public:
+    using value_type = T;
+    using pointer = T *;
+    using const_pointer = const T *;
+    using reference = T &;
+    using const_reference = const T &;
+
+    template <typename U>
+    struct rebind
+    {
+        using other = ResourceAllocator<U>;
+    };
+
+    ResourceAllocator() noexcept : m_resource(newDeleteResource()) {}
+
+    ResourceAllocator(MemoryResource *resource) noexcept : m_resource(resource) {}
+
+    template <typename U>
+    ResourceAllocator(const ResourceAllocator<U> &other) noexcept : m_resource(other.resource()) {}
+
+    T *allocate(std::size_t n) const
+    {
+        return static_cast<T *>(m_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *p, std::size_t n) const
+    {
+        m_resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    /* Allocate and construct a single object.
+
+	*/
+    template <typename... Args>
+    T *newObject(Args &&... args) const
+    {
+        T *p = allocate(1);
+        try
+        {
+            new (p) T(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            deallocate(p, 1);
+            throw;
+        }
+        return p;
+    }
+
+    /* Destroy and deallocate an object obtained from newObject.
+
+	*/
+    void deleteObject(T *p) const
+    {
+        p->~T();
+        deallocate(p, 1);
+    }
+
+    MemoryResource *resource() const noexcept
+    {
+        return m_resource;
+    }
+
+private:
+    MemoryResource *m_resource;
+};
+
+template <typename T, typename U>
+bool operator==(const ResourceAllocator<T> &lhs, const ResourceAllocator<U> &rhs) noexcept
+{
+    return lhs.resource()->isEqual(*rhs.resource());
+}
+
+template <typename T, typename U>
+bool operator!=(const ResourceAllocator<T> &lhs, const ResourceAllocator<U> &rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+} // namespace impl
+
+} // namespace kiwi
@@ -0,0 +1,110 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <cstddef>
+#include "row.h"
+#include "symbol.h"
+
+namespace kiwi
+{
+
+/* Pivot rules select the symbol entering the basis in a primal pivot.
+
+A rule provides a static `enteringSymbol( objective, columnNorm )` template
+returning a non-dummy symbol with a negative coefficient in the objective,
+or an invalid symbol when the objective is at its minimum. `columnNorm` is
+a callable returning the squared norm of the column of a symbol in the
+tableau, for the rules which need it.
+
+Whatever the rule, the solver falls back to the Bland rule after a run of
+pivots which did not improve the objective, so that it cannot cycle.
+
+*/
+
+/* Bland: the candidate with the smallest symbol id. It never cycles, but
+may need many pivots on large systems.
+
+*/
+struct BlandPivotRule
+{
+    template <typename ColumnNorm>
+    static impl::Symbol enteringSymbol(const impl::Row &objective, const ColumnNorm &)
+    {
+        const impl::Row::SymbolVector &symbols(objective.symbols());
+        const impl::Row::CoefficientVector &coeffs(objective.coefficients());
+        for (std::size_t i = 0, n = symbols.size(); i < n; ++i)
+        {
+            if (symbols[i].type() != impl::Symbol::Dummy && coeffs[i] < 0.0)
+                return symbols[i];
+        }
+        return impl::Symbol();
+    }
+};
+
+/* Dantzig: the candidate with the most negative coefficient.
+
+*/
+struct DantzigPivotRule
+{
+    template <typename ColumnNorm>
+    static impl::Symbol enteringSymbol(const impl::Row &objective, const ColumnNorm &)
+    {
+        const impl::Row::SymbolVector &symbols(objective.symbols());
+        const impl::Row::CoefficientVector &coeffs(objective.coefficients());
+        impl::Symbol entering;
+        double best = 0.0;
+        for (std::size_t i = 0, n = symbols.size(); i < n; ++i)
+        {
+            if (coeffs[i] < best && symbols[i].type() != impl::Symbol::Dummy)
+            {
+                best = coeffs[i];
+                entering = symbols[i];
+            }
+        }
+        return entering;
+    }
+};
+
+/* Steepest edge: the candidate whose coefficient is the most negative
+relative to the norm of its column, i.e. the one improving the objective
+the most per unit of distance travelled. Each candidate costs a walk over
+its column, which pays off when it saves enough pivots.
+
+*/
+struct SteepestEdgePivotRule
+{
+    template <typename ColumnNorm>
+    static impl::Symbol enteringSymbol(const impl::Row &objective, const ColumnNorm &columnNorm)
+    {
+        const impl::Row::SymbolVector &symbols(objective.symbols());
+        const impl::Row::CoefficientVector &coeffs(objective.coefficients());
+        impl::Symbol entering;
+        double best = 0.0;
+        for (std::size_t i = 0, n = symbols.size(); i < n; ++i)
+        {
+            if (coeffs[i] < 0.0 && symbols[i].type() != impl::Symbol::Dummy)
+            {
+                double score = coeffs[i] * coeffs[i] / (1.0 + columnNorm(symbols[i]));
+                if (score > best)
+                {
+                    best = score;
+                    entering = symbols[i];
+                }
+            }
+        }
+        return entering;
+    }
+};
+
+#ifdef KIWI_DEFAULT_PIVOT_RULE
+using DefaultPivotRule = KIWI_DEFAULT_PIVOT_RULE;
+#else
+using DefaultPivotRule = BlandPivotRule;
+#endif
+
+} // namespace kiwi
@@ -6,7 +6,11 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
-#include "maptype.h"
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "memoryresource.h"
 #include "symbol.h"
 #include "util.h"
 
@@ -20,19 +24,117 @@ class Row
 {
 
 public:
-    using CellMap = MapType<Symbol, double>;
+    /* The cells of a row are stored as a structure of arrays: the symbols
+    are kept sorted in one contiguous vector and the coefficients in a
+    parallel vector. Scans which only look at the symbols never touch
+    the coefficients, and the scaling loops stream over plain doubles. */
+    using SymbolVector = std::vector<Symbol, ResourceAllocator<Symbol>>;
+
+    using CoefficientVector = std::vector<double, ResourceAllocator<double>>;
+
+    /* A read-only view of the cells of a row.
+
+	Iterating the view yields (symbol, coefficient) pairs by value, so
+	code written against a map of cells keeps working unchanged.
+
+	*/
+    class CellRange
+    {
+
+    public:
+        class const_iterator
+        {
+
+        public:
+            using value_type = std::pair<Symbol, double>;
+
+            const_iterator(const Symbol *symbol, const double *coefficient) : m_symbol(symbol),
+                                                                               m_coefficient(coefficient) {}
+
+            value_type operator*() const
+            {
+                return value_type(*m_symbol, *m_coefficient);
+            }
+
+            const_iterator &operator++()
+            {
+                ++m_symbol;
+                ++m_coefficient;
+                return *this;
+            }
+
+            bool operator==(const const_iterator &other) const
+            {
+                return m_symbol == other.m_symbol;
+            }
+
+            bool operator!=(const const_iterator &other) const
+            {
+                return m_symbol != other.m_symbol;
+            }
+
+        private:
+            const Symbol *m_symbol;
+            const double *m_coefficient;
+        };
+
+        CellRange(const Row &row) : m_row(row) {}
+
+        const_iterator begin() const
+        {
+            return const_iterator(m_row.m_symbols.data(), m_row.m_coefficients.data());
+        }
+
+        const_iterator end() const
+        {
+            std::size_t n = m_row.m_symbols.size();
+            return const_iterator(m_row.m_symbols.data() + n, m_row.m_coefficients.data() + n);
+        }
+
+        bool empty() const
+        {
+            return m_row.m_symbols.empty();
+        }
+
+        std::size_t size() const
+        {
+            return m_row.m_symbols.size();
+        }
+
+    private:
+        const Row &m_row;
+    };
 
     Row() : Row(0.0) {}
 
-    Row(double constant) : m_constant(constant) {}
+    Row(double constant) : Row(constant, newDeleteResource()) {}
+
+    Row(double constant, MemoryResource *resource) : m_symbols(resource),
+                                                     m_coefficients(resource),
+                                                     m_constant(constant) {}
 
     Row(const Row &other) = default;
 
     ~Row() = default;
 
-    const CellMap &cells() const
+    CellRange cells() const
+    {
+        return CellRange(*this);
+    }
+
+    const SymbolVector &symbols() const
     {
-        return m_cells;
+        return m_symbols;
+    }
+
+    const CoefficientVector &coefficients() const
+    {
+        return m_coefficients;
+    }
+
+    MemoryResource *resource() const
+    {
+        return m_symbols.get_allocator().resource();
     }
 
     double constant() const
@@ -59,8 +161,14 @@ public:
 	*/
     void insert(const Symbol &symbol, double coefficient = 1.0)
     {
-        if (nearZero(m_cells[symbol] += coefficient))
-            m_cells.erase(symbol);
+        std::size_t i = lowerBound(symbol);
+        if (i == m_symbols.size() || !(m_symbols[i] == symbol))
+        {
+            m_symbols.insert(m_symbols.begin() + i, symbol);
+            m_coefficients.insert(m_coefficients.begin() + i, 0.0);
+        }
+        if (nearZero(m_coefficients[i] += coefficient))
+            eraseAt(i);
     }
 
     /* Insert a row into this row with a given coefficient.
@@ -73,13 +181,7 @@ public:
     void insert(const Row &other, double coefficient = 1.0)
     {
         m_constant += other.m_constant * coefficient;
-
-        for (const auto & cellPair : other.m_cells)
-        {
-            double coeff = cellPair.second * coefficient;
-            if (nearZero(m_cells[cellPair.first] += coeff))
-                m_cells.erase(cellPair.first);
-        }
+        merge(other, coefficient, npos);
     }
 
     /* Remove the given symbol from the row.
@@ -87,9 +189,9 @@ public:
 	*/
     void remove(const Symbol &symbol)
     {
-        auto it = m_cells.find(symbol);
-        if (it != m_cells.end())
-            m_cells.erase(it);
+        std::size_t i = find(symbol);
+        if (i != npos)
+            eraseAt(i);
     }
 
     /* Reverse the sign of the constant and all cells in the row.
@@ -98,8 +200,9 @@ public:
     void reverseSign()
     {
         m_constant = -m_constant;
-        for (auto &cellPair : m_cells)
-            cellPair.second = -cellPair.second;
+        double *coeffs = m_coefficients.data();
+        for (std::size_t i = 0, n = m_coefficients.size(); i < n; ++i)
+            coeffs[i] = -coeffs[i];
     }
 
     /* Solve the row for the given symbol.
@@ -115,11 +218,13 @@ public:
 	*/
     void solveFor(const Symbol &symbol)
     {
-        double coeff = -1.0 / m_cells[symbol];
-        m_cells.erase(symbol);
+        std::size_t i = find(symbol);
+        double coeff = -1.0 / m_coefficients[i];
+        eraseAt(i);
         m_constant *= coeff;
-        for (auto &cellPair : m_cells)
-            cellPair.second *= coeff;
+        double *coeffs = m_coefficients.data();
+        for (std::size_t j = 0, n = m_coefficients.size(); j < n; ++j)
+            coeffs[j] *= coeff;
     }
 
     /* Solve the row for the given symbols.
@@ -146,10 +251,10 @@ public:
 	*/
     double coefficientFor(const Symbol &symbol) const
     {
-        CellMap::const_iterator it = m_cells.find(symbol);
-        if (it == m_cells.end())
+        std::size_t i = find(symbol);
+        if (i == npos)
             return 0.0;
-        return it->second;
+        return m_coefficients[i];
     }
 
     /* Substitute a symbol with the data from another row.
@@ -163,17 +268,170 @@ public:
 	*/
     void substitute(const Symbol &symbol, const Row &row)
     {
-        auto it = m_cells.find(symbol);
-        if (it != m_cells.end())
+        std::size_t i = find(symbol);
+        if (i != npos)
         {
-            double coefficient = it->second;
-            m_cells.erase(it);
-            insert(row, coefficient);
+            double coefficient = m_coefficients[i];
+            m_constant += row.m_constant * coefficient;
+            merge(row, coefficient, i);
+        }
+    }
+
+    /* Substitute a symbol with the data from another row, and record the
+	symbols which entered or left the row.
+
+	The symbols of the other row which were added to this row are
+	appended to `entered`, and the ones which cancelled out are appended
+	to `left`. The substituted symbol itself is not recorded.
+
+	*/
+    void substitute(const Symbol &symbol, const Row &row, SymbolVector &entered, SymbolVector &left)
+    {
+        std::size_t i = find(symbol);
+        if (i != npos)
+        {
+            double coefficient = m_coefficients[i];
+            m_constant += row.m_constant * coefficient;
+            merge(row, coefficient, i, &entered, &left);
         }
     }
 
 private:
-    CellMap m_cells;
+    static const std::size_t npos = static_cast<std::size_t>(-1);
+
+    std::size_t lowerBound(const Symbol &symbol, std::size_t first = 0) const
+    {
+        return std::lower_bound(m_symbols.begin() + first, m_symbols.end(), symbol) - m_symbols.begin();
+    }
+
+    std::size_t find(const Symbol &symbol) const
+    {
+        std::size_t i = lowerBound(symbol);
+        if (i != m_symbols.size() && m_symbols[i] == symbol)
+            return i;
+        return npos;
+    }
+
+    void eraseAt(std::size_t i)
+    {
+        m_symbols.erase(m_symbols.begin() + i);
+        m_coefficients.erase(m_coefficients.begin() + i);
+    }
+
+    /* Merge the scaled cells of another row into this row.
+
+	Both symbol vectors are sorted, so the merge runs in two passes. The
+	first pass locates each incoming symbol with a binary search that
+	resumes from the previous match, and updates the existing cells in
+	place. Cells which cancel out, and the optional `dropped` cell, are
+	marked with an exact zero coefficient. If new symbols are needed,
+	the vectors are grown once and the second pass merges backwards from
+	the end, so no cell is moved more than once. The marked cells are
+	compacted away at the end. The symbols added and cancelled out are
+	recorded in `entered` and `left` when those are given.
+
+	This costs O(m log n) when the structure of the row is unchanged
+	and O(n + m) otherwise, instead of one memmove per incoming cell.
+
+	*/
+    void merge(const Row &other, double coefficient, std::size_t dropped,
+               SymbolVector *entered = nullptr, SymbolVector *left = nullptr)
+    {
+        const Symbol *their_syms = other.m_symbols.data();
+        const double *their_coeffs = other.m_coefficients.data();
+        const std::size_t m = other.m_symbols.size();
+        std::size_t added = 0;
+        std::size_t removed = 0;
+        if (dropped != npos)
+        {
+            m_coefficients[dropped] = 0.0;
+            ++removed;
+        }
+
+        std::size_t pos = 0;
+        for (std::size_t j = 0; j < m; ++j)
+        {
+            double coeff = their_coeffs[j] * coefficient;
+            pos = lowerBound(their_syms[j], pos);
+            if (pos != m_symbols.size() && m_symbols[pos] == their_syms[j])
+            {
+                if (nearZero(m_coefficients[pos] += coeff))
+                {
+                    m_coefficients[pos] = 0.0;
+                    ++removed;
+                    if (left)
+                        left->push_back(m_symbols[pos]);
+                }
+            }
+            else if (!nearZero(coeff))
+                ++added;
+        }
+
+        if (added)
+        {
+            std::size_t mine = m_symbols.size();
+            std::size_t out = mine + added;
+            std::size_t theirs = m;
+            m_symbols.resize(out);
+            m_coefficients.resize(out);
+            Symbol *syms = m_symbols.data();
+            double *coeffs = m_coefficients.data();
+            while (out != mine)
+            {
+                const Symbol &symbol = their_syms[theirs - 1];
+                if (mine != 0 && !(syms[mine - 1] < symbol))
+                {
+                    if (syms[mine - 1] == symbol)
+                        --theirs;
+                    --out;
+                    --mine;
+                    syms[out] = syms[mine];
+                    coeffs[out] = coeffs[mine];
+                }
+                else
+                {
+                    double coeff = their_coeffs[theirs - 1] * coefficient;
+                    if (!nearZero(coeff))
+                    {
+                        --out;
+                        syms[out] = symbol;
+                        coeffs[out] = coeff;
+                        if (entered)
+                            entered->push_back(symbol);
+                    }
+                    --theirs;
+                }
+            }
+        }
+
+        if (removed)
+            compact();
+    }
+
+    /* Remove the cells marked with an exact zero coefficient.
+
+	*/
+    void compact()
+    {
+        Symbol *syms = m_symbols.data();
+        double *coeffs = m_coefficients.data();
+        std::size_t n = m_symbols.size();
+        std::size_t out = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            if (coeffs[i] != 0.0)
+            {
+                syms[out] = syms[i];
+                coeffs[out] = coeffs[i];
+                ++out;
+            }
+        }
+        m_symbols.resize(out);
+        m_coefficients.resize(out);
+    }
+
+    SymbolVector m_symbols;
+    CoefficientVector m_coefficients;
     double m_constant;
 };
 
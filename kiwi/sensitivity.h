@@ -0,0 +1,241 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "arrayview.h"
+#include "memoryresource.h"
+#include "variable.h"
+
+namespace kiwi
+{
+
+namespace impl
+{
+
+template <typename MapPolicy, typename PivotRule>
+class SolverImpl;
+
+} // namespace impl
+
+/* The sensitivity of the variables of a solver to some of its edit variables.
+
+As long as the suggested values of the edit variables only move the rows of
+the tableau without making one infeasible, the solver needs no pivot, and the
+value of each variable is an affine function of the suggested values. The
+sensitivity holds that function for the basis of the tableau it was taken
+from: the values of the variables depending on the edit variables and their
+derivatives with respect to each edit variable, along with the limits of the
+region of suggested values where the basis stays feasible.
+
+Only the variables depending on at least one of the edit variables are part
+of the sensitivity, the others keep their value within the region.
+
+*/
+class Sensitivity
+{
+
+public:
+    Sensitivity() : Sensitivity(newDeleteResource()) {}
+
+    explicit Sensitivity(MemoryResource *resource) : m_edits(resource),
+                                                     m_edit_values(resource),
+                                                     m_variables(resource),
+                                                     m_values(resource),
+                                                     m_derivatives(resource),
+                                                     m_limits(resource),
+                                                     m_limit_constants(resource) {}
+
+    /* Get the edit variables, by edit index.
+
+    */
+    ArrayView<Variable> edits() const
+    {
+        return ArrayView<Variable>(m_edits.data(), m_edits.size());
+    }
+
+    /* Get the suggested values the sensitivity was taken at, by edit index.
+
+    */
+    ArrayView<double> editValues() const
+    {
+        return ArrayView<double>(m_edit_values.data(), m_edit_values.size());
+    }
+
+    /* Get the variables depending on the edit variables.
+
+    */
+    ArrayView<Variable> variables() const
+    {
+        return ArrayView<Variable>(m_variables.data(), m_variables.size());
+    }
+
+    /* Get the values of the variables at the suggested values the
+    sensitivity was taken at.
+
+    */
+    ArrayView<double> values() const
+    {
+        return ArrayView<double>(m_values.data(), m_values.size());
+    }
+
+    /* Get the derivative of a variable with respect to an edit variable,
+    given their indices.
+
+    */
+    double derivative(std::size_t variable, std::size_t edit) const
+    {
+        return m_derivatives[variable * m_edits.size() + edit];
+    }
+
+    /* Test whether the basis stays feasible for the given suggested
+    values, one per edit variable.
+
+    */
+    bool contains(const double *edits) const
+    {
+        const std::size_t n = m_edits.size();
+        for (std::size_t k = 0, count = m_limit_constants.size(); k < count; ++k)
+        {
+            const double *limit = &m_limits[k * n];
+            double constant = m_limit_constants[k];
+            for (std::size_t j = 0; j < n; ++j)
+                constant += limit[j] * (edits[j] - m_edit_values[j]);
+            if (constant < 0.0)
+                return false;
+        }
+        return true;
+    }
+
+    /* Get the range of suggested values of an edit variable where the basis
+    stays feasible, the other edit variables keeping their value.
+
+    The bounds are infinite when the basis never becomes infeasible on
+    that side.
+
+    */
+    std::pair<double, double> range(std::size_t edit) const
+    {
+        const std::size_t n = m_edits.size();
+        double lower = -std::numeric_limits<double>::infinity();
+        double upper = std::numeric_limits<double>::infinity();
+        for (std::size_t k = 0, count = m_limit_constants.size(); k < count; ++k)
+        {
+            double coefficient = m_limits[k * n + edit];
+            double bound = m_edit_values[edit] - m_limit_constants[k] / coefficient;
+            if (coefficient > 0.0)
+                lower = std::max(lower, bound);
+            else if (coefficient < 0.0)
+                upper = std::min(upper, bound);
+        }
+        return std::make_pair(lower, upper);
+    }
+
+    /* Compute the values of the variables for the given suggested values,
+    one per edit variable.
+
+    The values are only those of the solver if the suggested values are
+    within the region where the basis stays feasible.
+
+    */
+    void evaluate(const double *edits, double *values) const
+    {
+        const std::size_t n = m_edits.size();
+        for (std::size_t i = 0, count = m_values.size(); i < count; ++i)
+        {
+            const double *derivatives = &m_derivatives[i * n];
+            double value = m_values[i];
+            for (std::size_t j = 0; j < n; ++j)
+                value += derivatives[j] * (edits[j] - m_edit_values[j]);
+            values[i] = value;
+        }
+    }
+
+private:
+    template <typename MapPolicy, typename PivotRule>
+    friend class impl::SolverImpl;
+
+    using VariableList = std::vector<Variable, impl::ResourceAllocator<Variable>>;
+
+    using ValueList = std::vector<double, impl::ResourceAllocator<double>>;
+
+    void clear()
+    {
+        m_edits.clear();
+        m_edit_values.clear();
+        m_variables.clear();
+        m_values.clear();
+        m_derivatives.clear();
+        m_limits.clear();
+        m_limit_constants.clear();
+    }
+
+    /* Add a variable of the given value, returning its derivatives.
+
+    */
+    double *addVariable(const Variable &variable, double value)
+    {
+        m_variables.push_back(variable);
+        m_values.push_back(value);
+        m_derivatives.resize(m_derivatives.size() + m_edits.size(), 0.0);
+        return &m_derivatives[m_derivatives.size() - m_edits.size()];
+    }
+
+    /* Add a limit of the region, `constant + limit * (edits - editValues)
+    >= 0`, returning its coefficients.
+
+    */
+    double *addLimit(double constant)
+    {
+        m_limit_constants.push_back(constant);
+        m_limits.resize(m_limits.size() + m_edits.size(), 0.0);
+        return &m_limits[m_limits.size() - m_edits.size()];
+    }
+
+    /* Get the number of bytes held by the arrays of the sensitivity.
+
+    */
+    std::size_t memory() const
+    {
+        return (m_edits.capacity() + m_variables.capacity()) * sizeof(Variable) +
+               (m_edit_values.capacity() + m_values.capacity() + m_derivatives.capacity() + m_limits.capacity() +
+                m_limit_constants.capacity()) *
+                   sizeof(double);
+    }
+
+    VariableList m_edits;
+    ValueList m_edit_values;
+    VariableList m_variables;
+    ValueList m_values;
+    ValueList m_derivatives;
+    ValueList m_limits;
+    ValueList m_limit_constants;
+};
+
+/* The statistics of the cache of bases of a solver, see
+`Solver::setBasisCacheSize`.
+
+*/
+struct BasisCacheStats
+{
+    // The suggestions leaving the feasible region of the basis which were
+    // answered from a cached basis.
+    std::size_t hits = 0;
+    // The suggestions leaving the feasible region of the basis for which no
+    // cached basis was feasible, and which pivoted.
+    std::size_t misses = 0;
+    // The number of cached bases.
+    std::size_t entries = 0;
+    // The number of bytes held by the cached bases.
+    std::size_t memory = 0;
+};
+
+} // namespace kiwi
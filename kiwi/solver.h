@@ -6,26 +6,169 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <initializer_list>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "arrayview.h"
 #include "constraint.h"
 #include "debug.h"
+#include "maptype.h"
+#include "pivotrule.h"
+#include "sensitivity.h"
 #include "solverimpl.h"
 #include "strength.h"
+#include "threadpool.h"
 #include "variable.h"
 
 
 namespace kiwi
 {
 
-class Solver
+/* A Cassowary constraint solver.
+
+The map policy selects the map type used internally by the solver, see
+maptype.h for the available policies. The pivot rule selects the symbol
+entering the basis at each step of the simplex method, see pivotrule.h.
+Most code should use the Solver alias, which selects the default policies.
+
+*/
+template<typename MapPolicy = DefaultMapPolicy, typename PivotRule = DefaultPivotRule>
+class BasicSolver
 {
 
 public:
 
-	Solver() = default;
+	BasicSolver() = default;
+
+	/* Create a solver drawing all of its memory from the given resource.
+
+	The rows of the tableau and the internal maps are allocated from the
+	resource, which must outlive the solver.
+
+	*/
+	explicit BasicSolver( MemoryResource* resource ) : m_impl( resource ) {}
+
+	BasicSolver( const BasicSolver& ) = delete;
+
+	/* Move a solver into a new one, leaving it empty.
+
+	*/
+	BasicSolver( BasicSolver&& ) = default;
+
+	~BasicSolver() = default;
+
+	BasicSolver& operator=( const BasicSolver& ) = delete;
+
+	/* Move a solver into this one, leaving it empty.
+
+	The constraints of this solver are dropped, and it takes the memory
+	resource of the other one.
+
+	*/
+	BasicSolver& operator=( BasicSolver&& ) = default;
+
+	/* Create a copy of the solver, to explore changes to it without
+	touching the solver itself.
+
+	The copy shares the rows of the tableau with the solver, and each
+	row is only copied once either of them changes it. The maps of the
+	solver are not shared: cloning copies the constraints, the variables
+	and, for each component, the maps indexing its rows and the cells of
+	its columns, so it costs time linear in the size of the solver, but
+	copies no row. Trying a change on the copy then costs as much as on
+	the solver plus a copy of the rows it touches.
+
+	The copy has the constraints, edit variables, bounds, affine edits,
+	thread pool and settings of the solver, draws its memory from the
+	same resource, and starts with an empty cache of bases. It refers to
+	the same variables, whose values are written by whichever solver
+	updates them last. The rows may be shared between threads, but not
+	the variables and constraints, whose reference counts are not atomic.
+
+	*/
+	BasicSolver clone() const
+	{
+		return BasicSolver( m_impl.clone() );
+	}
+
+	/* Record the state of the solver and return a token to restore it.
+
+	Trying changes which may be undone is then a matter of taking a
+	checkpoint, making them, and either keeping them with `commit` or
+	undoing them with `rollback`, instead of removing each constraint
+	added since. The maps of the solver are not copied: while a
+	checkpoint is held, each entry is logged before it changes, and each
+	component of the tableau is copied the first time it changes,
+	sharing its rows until they change. Taking a checkpoint and rolling
+	back hence cost the changes made in between. Checkpoints nest, and a
+	token is never given twice by the same solver.
+
+	*/
+	std::size_t checkpoint()
+	{
+		return m_impl.checkpoint();
+	}
 
-	~Solver() = default;
+	/* Restore the state recorded by a checkpoint.
 
-	/* Add a constraint to the solver.
+	The constraints, edit variables, bounds, affine edits, suggested
+	values and tableau become those of the checkpoint, without pivoting.
+	The checkpoint and the ones taken after it are released. The thread
+	pool and settings of the solver are kept, and the variables whose
+	value may differ are returned by the next `updateChangedVariables`.
+
+	Throws
+	------
+	UnknownCheckpoint
+		The solver does not hold the given checkpoint.
+
+	*/
+	void rollback( std::size_t token )
+	{
+		m_impl.rollback( token );
+	}
+
+	/* Keep the changes made since a checkpoint.
+
+	The checkpoint and the ones taken after it are released.
+
+	Throws
+	------
+	UnknownCheckpoint
+		The solver does not hold the given checkpoint.
+
+	*/
+	void commit( std::size_t token )
+	{
+		m_impl.commit( token );
+	}
+
+	/* Get the number of checkpoints held by the solver.
+
+	*/
+	std::size_t checkpointCount() const
+	{
+		return m_impl.checkpointCount();
+	}
+
+	/* Test whether the solver holds a checkpoint.
+
+	A checkpoint is released by `rollback` and `commit`, including when
+	they are given a checkpoint taken before it.
+
+	*/
+	bool hasCheckpoint( std::size_t token ) const
+	{
+		return m_impl.hasCheckpoint( token );
+	}
+
+	/* Add a constraint to the solver and return its handle.
+
+	The handle refers to the constraint in the solver, so removing the
+	constraint or testing for it through the handle does not look the
+	constraint up. It stays valid until the constraint is removed, and
+	in the clones of the solver taken until then.
 
 	Throws
 	------
@@ -36,9 +179,37 @@ public:
 		The given constraint is required and cannot be satisfied.
 
 	*/
-	void addConstraint( const Constraint& constraint )
+	ConstraintHandle addConstraint( const Constraint& constraint )
 	{
-		m_impl.addConstraint( constraint );
+		return m_impl.addConstraint( constraint );
+	}
+
+	/* Add a range of constraints to the solver.
+
+	The solver is optimized once, after all the constraints have been
+	added. If a constraint cannot be added, the exception refers to it,
+	the constraints preceding it remain in the solver and the following
+	ones are not added.
+
+	Throws
+	------
+	DuplicateConstraint
+		A constraint has already been added to the solver.
+
+	UnsatisfiableConstraint
+		A constraint is required and cannot be satisfied.
+
+	*/
+	template<typename InputIterator>
+	void addConstraints( InputIterator first, InputIterator last )
+	{
+		m_impl.addConstraints( first, last );
+	}
+
+	template<typename Range>
+	void addConstraints( const Range& constraints )
+	{
+		m_impl.addConstraints( std::begin( constraints ), std::end( constraints ) );
 	}
 
 	/* Remove a constraint from the solver.
@@ -54,6 +225,48 @@ public:
 		m_impl.removeConstraint( constraint );
 	}
 
+	/* Remove the constraint a handle refers to from the solver.
+
+	Throws
+	------
+	UnknownConstraintHandle
+		The constraint of the handle has been removed from the solver.
+
+	*/
+	void removeConstraint( const ConstraintHandle& handle )
+	{
+		m_impl.removeConstraint( handle );
+	}
+
+	/* Remove a range of constraints, or of handles of constraints, from
+	the solver.
+
+	The solver is optimized once, after all the constraints have been
+	removed. If a constraint is unknown, the exception refers to it,
+	the constraints preceding it are removed and the following ones
+	are kept.
+
+	Throws
+	------
+	UnknownConstraint
+		A constraint has not been added to the solver.
+
+	UnknownConstraintHandle
+		The constraint of a handle has been removed from the solver.
+
+	*/
+	template<typename InputIterator>
+	void removeConstraints( InputIterator first, InputIterator last )
+	{
+		m_impl.removeConstraints( first, last );
+	}
+
+	template<typename Range>
+	void removeConstraints( const Range& constraints )
+	{
+		m_impl.removeConstraints( std::begin( constraints ), std::end( constraints ) );
+	}
+
 	/* Test whether a constraint has been added to the solver.
 
 	*/
@@ -62,6 +275,73 @@ public:
 		return m_impl.hasConstraint( constraint );
 	}
 
+	/* Test whether the constraint a handle refers to is in the solver.
+
+	*/
+	bool hasConstraint( const ConstraintHandle& handle ) const
+	{
+		return m_impl.hasConstraint( handle );
+	}
+
+	/* Add a constraint to the solver, returning why it cannot be added
+	instead of throwing.
+
+	A constraint which cannot be added leaves the solver unchanged, so
+	that trying candidate constraints costs no exception and no removal.
+	The handle of the constraint is written to the given one, if any,
+	once it is added.
+
+	Returns
+	-------
+	STATUS_OK
+		The constraint has been added to the solver.
+
+	STATUS_DUPLICATE_CONSTRAINT
+		The given constraint has already been added to the solver.
+
+	STATUS_UNSATISFIABLE_CONSTRAINT
+		The given constraint is required and cannot be satisfied.
+
+	*/
+	Status tryAddConstraint( const Constraint& constraint, ConstraintHandle* handle = nullptr )
+	{
+		return m_impl.tryAddConstraint( constraint, handle );
+	}
+
+	/* Remove a constraint from the solver, returning whether it had been
+	added instead of throwing.
+
+	Returns
+	-------
+	STATUS_OK
+		The constraint has been removed from the solver.
+
+	STATUS_UNKNOWN_CONSTRAINT
+		The given constraint has not been added to the solver.
+
+	*/
+	Status tryRemoveConstraint( const Constraint& constraint )
+	{
+		return m_impl.tryRemoveConstraint( constraint );
+	}
+
+	/* Remove the constraint a handle refers to, returning whether it is
+	in the solver instead of throwing.
+
+	Returns
+	-------
+	STATUS_OK
+		The constraint has been removed from the solver.
+
+	STATUS_UNKNOWN_CONSTRAINT
+		The constraint of the handle has been removed from the solver.
+
+	*/
+	Status tryRemoveConstraint( const ConstraintHandle& handle )
+	{
+		return m_impl.tryRemoveConstraint( handle );
+	}
+
 	/* Add an edit variable to the solver.
 
 	This method should be called before the `suggestValue` method is
@@ -102,6 +382,40 @@ public:
 		return m_impl.hasEditVariable( variable );
 	}
 
+	/* Remove a variable and every constraint referring to it from the
+	solver.
+
+	The variable stops being an edit variable and loses its bounds. The
+	constraints are removed before a single optimization pass. A variable
+	the solver does not know is ignored.
+
+	The solver keeps the references of its constraints to each variable,
+	so the work grows with the number of constraints referring to the
+	variable. It drops a variable along with its symbol once no
+	constraint refers to it, whichever way its constraints are removed.
+
+	*/
+	void removeVariable( const Variable& variable )
+	{
+		m_impl.removeVariables( &variable, &variable + 1 );
+	}
+
+	/* Remove a range of variables and every constraint referring to them
+	from the solver, in a single optimization pass.
+
+	*/
+	template<typename InputIterator>
+	void removeVariables( InputIterator first, InputIterator last )
+	{
+		m_impl.removeVariables( first, last );
+	}
+
+	template<typename Range>
+	void removeVariables( const Range& variables )
+	{
+		m_impl.removeVariables( std::begin( variables ), std::end( variables ) );
+	}
+
 	/* Suggest a value for the given edit variable.
 
 	This method should be used after an edit variable as been added to
@@ -120,6 +434,230 @@ public:
 		m_impl.suggestValue( variable, value );
 	}
 
+	/* Suggest a value for an edit variable, returning whether it is an
+	edit variable instead of throwing.
+
+	Returns
+	-------
+	STATUS_OK
+		The value has been suggested.
+
+	STATUS_UNKNOWN_EDIT_VARIABLE
+		The given edit variable has not been added to the solver.
+
+	*/
+	Status trySuggestValue( const Variable& variable, double value )
+	{
+		return m_impl.trySuggestValue( variable, value );
+	}
+
+	/* Suggest values for several edit variables at once.
+
+	The elements are pairs of an edit variable and its suggested value,
+	e.g. `std::pair<Variable, double>`. The solver is re-optimized once
+	for all the suggestions, instead of once per variable. If a variable
+	is not an edit variable, the exception refers to it, the suggestions
+	preceding it are applied and the following ones are ignored.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	void suggestValues( InputIterator first, InputIterator last )
+	{
+		m_impl.suggestValues( first, last );
+	}
+
+	template<typename Range>
+	void suggestValues( const Range& suggestions )
+	{
+		m_impl.suggestValues( std::begin( suggestions ), std::end( suggestions ) );
+	}
+
+	void suggestValues( std::initializer_list<std::pair<Variable, double>> suggestions )
+	{
+		m_impl.suggestValues( suggestions.begin(), suggestions.end() );
+	}
+
+	/* Answer the suggestions of some edit variables without pivoting.
+
+	While a window is resized or an item dragged, most suggestions only
+	move the values of the variables along the current basis, which are
+	then affine functions of the suggested values. The suggestions of
+	the given edit variables are answered from the `sensitivity` of the
+	basis while they stay within its feasible region: they are recorded
+	without modifying the tableau, and the values of the variables which
+	depend on them are computed by a small product of matrices by vectors
+	when the variables are updated. A suggestion out of the region, or
+	any other change to the solver, applies the recorded suggestions to
+	the tableau and the sensitivity is taken again at the next one.
+
+	The values of the variables are the same as without this method, up
+	to rounding. An empty range answers every suggestion normally again.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	void setAffineEdits( InputIterator first, InputIterator last )
+	{
+		m_impl.setAffineEdits( first, last );
+	}
+
+	template<typename Range>
+	void setAffineEdits( const Range& variables )
+	{
+		m_impl.setAffineEdits( std::begin( variables ), std::end( variables ) );
+	}
+
+	void setAffineEdits( std::initializer_list<Variable> variables )
+	{
+		m_impl.setAffineEdits( variables.begin(), variables.end() );
+	}
+
+	/* Get the edit variables whose suggestions are answered without
+	pivoting.
+
+	*/
+	ArrayView<Variable> affineEdits() const
+	{
+		return m_impl.affineEdits();
+	}
+
+	/* Get the sensitivity of the variables to some edit variables.
+
+	The sensitivity holds the derivatives of the variables depending on
+	the edit variables with respect to each of them, and the region of
+	suggested values where the current basis stays feasible, within
+	which the values of the variables are affine functions of the
+	suggested values. See sensitivity.h.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	Sensitivity sensitivity( InputIterator first, InputIterator last )
+	{
+		return m_impl.sensitivity( first, last );
+	}
+
+	template<typename Range>
+	Sensitivity sensitivity( const Range& variables )
+	{
+		return m_impl.sensitivity( std::begin( variables ), std::end( variables ) );
+	}
+
+	Sensitivity sensitivity( std::initializer_list<Variable> variables )
+	{
+		return m_impl.sensitivity( variables.begin(), variables.end() );
+	}
+
+	/* Set the number of bases of the affine edits kept in a cache.
+
+	Dragging an edit variable back and forth crosses the same basis
+	changes again and again. With a cache, a suggestion of the affine
+	edits leaving the feasible region of the basis is answered from a
+	cached basis feasible for it, if any, instead of pivoting, and the
+	least recently used basis is dropped when the cache is full. The
+	cache is emptied by any other change to the solver, and disabled by
+	default or with a size of 0.
+
+	*/
+	void setBasisCacheSize( std::size_t size )
+	{
+		m_impl.setBasisCacheSize( size );
+	}
+
+	/* Get the number of bases of the affine edits kept in a cache.
+
+	*/
+	std::size_t basisCacheSize() const
+	{
+		return m_impl.basisCacheSize();
+	}
+
+	/* Get the hits, misses, entries and memory use of the cache of bases.
+
+	The hits and misses are counted since the solver was created or
+	reset. See sensitivity.h.
+
+	*/
+	BasisCacheStats basisCacheStats() const
+	{
+		return m_impl.basisCacheStats();
+	}
+
+	/* Solve the solver for many scenarios of suggested values at once.
+
+	The values are a dense row-major matrix of the given number of
+	scenarios, each row holding the suggested values of the edit
+	variables in the order of the range. The result is a dense row-major
+	matrix with one row per scenario and one column per variable index,
+	see `variables`, holding the value each variable would be updated to
+	after suggesting the values of the scenario.
+
+	The scenarios are evaluated in contiguous blocks by copies of the
+	solver, one per thread of the thread pool, and the solver itself is
+	left unchanged. With a single thread, the values are those of
+	suggesting the scenarios in order to the solver. When several
+	solutions have the same cost, the one found may depend on the number
+	of threads.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	std::vector<double> sweep( InputIterator first, InputIterator last, const double* values, std::size_t scenarios )
+	{
+		return m_impl.sweep( first, last, values, scenarios );
+	}
+
+	template<typename Range>
+	std::vector<double> sweep( const Range& variables, const double* values, std::size_t scenarios )
+	{
+		return m_impl.sweep( std::begin( variables ), std::end( variables ), values, scenarios );
+	}
+
+	std::vector<double> sweep( std::initializer_list<Variable> variables, const double* values, std::size_t scenarios )
+	{
+		return m_impl.sweep( variables.begin(), variables.end(), values, scenarios );
+	}
+
+	/* Set the bounds of a variable.
+
+	The variable is required to stay within [lower, upper]; an infinite
+	bound leaves that side free. The bounds replace the ones previously
+	set by this method, but not the constraints added to the solver.
+
+	Bounding a variable before any constraint refers to it, either with
+	this method or with a required single variable inequality, costs no
+	row of the tableau and lets the bound be moved cheaply afterwards.
+
+	Throws
+	------
+	UnsatisfiableConstraint
+		The lower bound is above the upper bound, or a bound cannot be
+		satisfied together with the required constraints. The variable
+		is left without that bound, or with its previous native bound.
+
+	*/
+	void setBounds( const Variable& variable, double lower, double upper )
+	{
+		m_impl.setBounds( variable, lower, upper );
+	}
+
 	/* Update the values of the external solver variables.
 
 	*/
@@ -128,13 +666,124 @@ public:
 		m_impl.updateVariables();
 	}
 
+	/* Update the values of the external solver variables which changed.
+
+	Only the variables whose value may have changed since the last update
+	are examined, and the ones whose value actually changed are written
+	and returned. This lets callers redraw only what moved.
+
+	*/
+	std::vector<Variable> updateChangedVariables()
+	{
+		return m_impl.updateChangedVariables();
+	}
+
+	/* Get the values of the external variables, by variable index.
+
+	The values are stored in a single contiguous array, and are those
+	written by the last update of the variables. The view is invalidated
+	when a constraint refers to a new variable, a variable is dropped
+	once no constraint refers to it, or the solver is reset; a dropped
+	variable gives its index to the last variable.
+
+	*/
+	ArrayView<double> values() const
+	{
+		return m_impl.values();
+	}
+
+	/* Get the external variables of the solver, by variable index.
+
+	The variable at a given index is the one whose value is stored at the
+	same index of `values`.
+
+	*/
+	ArrayView<Variable> variables() const
+	{
+		return m_impl.variables();
+	}
+
+	/* Get the number of simplex pivots performed by the solver.
+
+	The count starts when the solver is created or reset. It is mostly
+	useful to compare the pivot rules on a given system.
+
+	*/
+	std::size_t pivotCount() const
+	{
+		return m_impl.pivotCount();
+	}
+
+	/* Get the number of independent components of the solver.
+
+	Constraints which share no variable, directly or through other
+	constraints, belong to different components, and optimizing after
+	a change only involves the components it touches. Components are
+	merged as soon as a constraint ties them, but only split once enough
+	constraints have been removed, so the count is a lower bound.
+
+	*/
+	std::size_t componentCount() const
+	{
+		return m_impl.componentCount();
+	}
+
+	/* Set the thread pool used to optimize the components concurrently.
+
+	When several components need to be optimized at once, for instance
+	after a batch of suggestions touching independent parts of a layout,
+	they are optimized on the threads of the pool. The result does not
+	depend on the pool. A null pool, the default, optimizes them on the
+	calling thread.
+
+	The pool may be shared by several solvers and must outlive the ones
+	using it. The memory resource of the solver must be thread safe, as
+	the default one is.
+
+	*/
+	void setThreadPool( ThreadPool* pool )
+	{
+		m_impl.setThreadPool( pool );
+	}
+
+	/* Get the thread pool of the solver, or null if it has none.
+
+	*/
+	ThreadPool* threadPool() const
+	{
+		return m_impl.threadPool();
+	}
+
+	/* Set the number of rows from which a pivot runs on the thread pool.
+
+	A pivot substitutes the entering symbol into every row referring to
+	it. When there are at least the given number of such rows, they are
+	split between the threads of the pool. This only pays off for very
+	large tableaux, and is disabled by default or with a threshold of 0.
+	The result does not depend on the threshold.
+
+	*/
+	void setSubstituteThreshold( std::size_t rows )
+	{
+		m_impl.setSubstituteThreshold( rows );
+	}
+
+	/* Get the number of rows from which a pivot runs on the thread pool,
+	or 0 if pivots always run on the calling thread.
+
+	*/
+	std::size_t substituteThreshold() const
+	{
+		return m_impl.substituteThreshold();
+	}
+
 	/* Reset the solver to the empty starting condition.
 
 	This method resets the internal solver state to the empty starting
 	condition, as if no constraints or edit variables have been added.
 	This can be faster than deleting the solver and creating a new one
 	when the entire system must change, since it can avoid unecessary
-	heap (de)allocations.
+	heap (de)allocations. The checkpoints of the solver are released.
 
 	*/
 	void reset()
@@ -168,11 +817,11 @@ public:
 
 private:
 
-	Solver( const Solver& );
+	explicit BasicSolver( impl::SolverImpl<MapPolicy, PivotRule>&& impl ) : m_impl( std::move( impl ) ) {}
 
-	Solver& operator=( const Solver& );
-
-	impl::SolverImpl m_impl;
+	impl::SolverImpl<MapPolicy, PivotRule> m_impl;
 };
 
+using Solver = BasicSolver<>;
+
 } // namespace kiwi
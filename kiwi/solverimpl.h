@@ -7,16 +7,24 @@
 |----------------------------------------------------------------------------*/
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <limits>
 #include <memory>
+#include <new>
 #include <vector>
+#include "arrayview.h"
 #include "constraint.h"
 #include "errors.h"
 #include "expression.h"
 #include "maptype.h"
+#include "memoryresource.h"
+#include "pivotrule.h"
 #include "row.h"
+#include "sensitivity.h"
 #include "symbol.h"
 #include "term.h"
+#include "threadpool.h"
 #include "util.h"
 #include "variable.h"
 
@@ -27,6 +35,14 @@ namespace kiwi
 namespace impl
 {
 
+/* The implementation of the solver.
+
+The map policy selects the map type used for every map of the solver, see
+maptype.h for the available policies. The pivot rule selects the symbol
+entering the basis in the primal simplex, see pivotrule.h.
+
+*/
+template<typename MapPolicy = DefaultMapPolicy, typename PivotRule = DefaultPivotRule>
 class SolverImpl
 {
 	friend class DebugHelper;
@@ -44,326 +60,3582 @@ class SolverImpl
 		double constant;
 	};
 
-	using VarMap = MapType<Variable, Symbol>;
+	struct BoundInfo
+	{
+		Constraint lower;
+		Constraint upper;
+	};
 
-	using RowMap = MapType<Symbol, Row*>;
+	/* A constraint of the solver and its tag, in the slot a handle of
+	the constraint refers to. The generation of a free slot is zero.
+	The references of the constraint to its variables start at `refs`,
+	see `VarRef`.
 
-	using CnMap = MapType<Constraint, Tag>;
+	*/
+	struct CnSlot
+	{
+		Constraint constraint;
+		Tag tag;
+		std::size_t generation;
+		std::size_t refs;
+	};
 
-	using EditMap = MapType<Variable, EditInfo>;
+	/* A term of a constraint referring to a variable. The references to
+	a variable form a doubly linked list starting at the entry of the
+	variable in `m_var_refs`, and the references of a constraint a list
+	linked through `sibling`, in the order of its terms.
 
-	struct DualOptimizeGuard
+	*/
+	struct VarRef
 	{
-		DualOptimizeGuard( SolverImpl& impl ) : m_impl( impl ) {}
-		~DualOptimizeGuard() { m_impl.dualOptimize(); }
-		SolverImpl& m_impl;
+		std::size_t slot;
+		std::size_t prev;
+		std::size_t next;
+		std::size_t sibling;
 	};
 
-public:
+	using VarMap = typename MapPolicy::template Map<Variable, Symbol>;
 
-	SolverImpl() : m_objective( new Row() ), m_id_tick( 1 ) {}
+	using IndexMap = typename MapPolicy::template Map<Symbol, std::size_t>;
 
-	SolverImpl( const SolverImpl& ) = delete;
+	/* The component of each symbol of the tableau. It is a hash map
+	whatever the map policy, as splitting the components fills it anew
+	in no particular order, and nothing depends on its order.
 
-	SolverImpl( SolverImpl&& ) = delete;
+	*/
+	using SymbolComponentMap = FlatHashMap<Symbol, std::size_t, std::hash<Symbol>, KeyEquivalent<Symbol>,
+										   ResourceAllocator<std::pair<Symbol, std::size_t>>>;
 
-	~SolverImpl() { clearRows(); }
+	using RowMap = typename MapPolicy::template Map<Symbol, Row*>;
 
-	/* Add a constraint to the solver.
+	using ColumnMap = typename MapPolicy::template Map<Symbol, RowMap>;
 
-	Throws
-	------
-	DuplicateConstraint
-		The given constraint has already been added to the solver.
+	/* The slot of each constraint. The entries of the constraints which
+	have been removed are left in place, see `releaseSlot`, and so are
+	the ones of the constraints added since a checkpoint rolled back,
+	whose slot may be past the end of the slots.
 
-	UnsatisfiableConstraint
-		The given constraint is required and cannot be satisfied.
+	*/
+	using CnMap = typename MapPolicy::template Map<Constraint, std::size_t>;
+
+	using EditMap = typename MapPolicy::template Map<Variable, EditInfo>;
+
+	using BoundMap = typename MapPolicy::template Map<Variable, BoundInfo>;
+
+	using SymbolList = std::vector<Symbol, ResourceAllocator<Symbol>>;
+
+	using VariableList = std::vector<Variable, ResourceAllocator<Variable>>;
+
+	using ValueList = std::vector<double, ResourceAllocator<double>>;
+
+	using IndexList = std::vector<std::size_t, ResourceAllocator<std::size_t>>;
+
+	using CnSlotList = std::vector<CnSlot, ResourceAllocator<CnSlot>>;
+
+	using VarRefList = std::vector<VarRef, ResourceAllocator<VarRef>>;
+
+	/* A row of the tableau along with the number of solvers sharing it.
+
+	The copies of a solver made by `clone` share its rows until they
+	change them: a shared row is copied by the first solver about to
+	change it, see `ownRow`. The count is atomic as the copies may be
+	used on different threads.
 
 	*/
-	void addConstraint( const Constraint& constraint )
+	struct SharedRow : Row
 	{
-		if( m_cns.find( constraint ) != m_cns.end() )
-			throw DuplicateConstraint( constraint );
+		SharedRow( double constant, MemoryResource* resource ) : Row( constant, resource ), refs( 1 ) {}
+		explicit SharedRow( const Row& row ) : Row( row ), refs( 1 ) {}
+		std::atomic<std::size_t> refs;
+	};
 
-		// Creating a row causes symbols to be reserved for the variables
-		// in the constraint. If this method exits with an exception,
-		// then its possible those variables will linger in the var map.
-		// Since its likely that those variables will be used in other
-		// constraints and since exceptional conditions are uncommon,
-		// i'm not too worried about aggressive cleanup of the var map.
-		Tag tag;
-		std::unique_ptr<Row> rowptr( createRow( constraint, tag ) );
-		Symbol subject( chooseSubject( *rowptr, tag ) );
+	/* Release a reference to a row, deleting it with the last one.
 
-		// If chooseSubject could not find a valid entering symbol, one
-		// last option is available if the entire row is composed of
-		// dummy variables. If the constant of the row is zero, then
-		// this represents redundant constraints and the new dummy
-		// marker can enter the basis. If the constant is non-zero,
-		// then it represents an unsatisfiable constraint.
-		if( subject.type() == Symbol::Invalid && allDummies( *rowptr ) )
+	*/
+	struct RowDeleter
+	{
+		void operator()( Row* row ) const
 		{
-			if( !nearZero( rowptr->constant() ) )
-				throw UnsatisfiableConstraint( constraint );
-			else
-				subject = tag.marker;
+			SharedRow* shared = static_cast<SharedRow*>( row );
+			if( shared->refs.load( std::memory_order_acquire ) == 1 ||
+				shared->refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+				allocator.deleteObject( shared );
 		}
+		ResourceAllocator<SharedRow> allocator;
+	};
 
-		// If an entering symbol still isn't found, then the row must
-		// be added using an artificial variable. If that fails, then
-		// the row represents an unsatisfiable constraint.
-		if( subject.type() == Symbol::Invalid )
-		{
-			if( !addWithArtificialVariable( *rowptr ) )
-				throw UnsatisfiableConstraint( constraint );
-		}
-		else
-		{
-			rowptr->solveFor( subject );
-			substitute( subject, *rowptr );
-			m_rows[ subject ] = rowptr.release();
-		}
+	using RowPtr = std::unique_ptr<Row, RowDeleter>;
 
-		m_cns[ constraint ] = tag;
+	/* An independent component of the tableau.
 
-		// Optimizing after each constraint is added performs less
-		// aggregate work due to a smaller average system size. It
-		// also ensures the solver remains in a consistent state.
-		optimize( *m_objective );
-	}
+	The components form a union-find: a merged component refers to the
+	component which absorbed it through `parent`, and only the roots own
+	rows, columns and an objective. The rows of a root are the rows of
+	the tableau whose symbols are part of it, and its columns index them.
+	Its objective is the part of the objective function which involves
+	its symbols, and is created when first used.
 
-	/* Remove a constraint from the solver.
+	*/
+	struct Component
+	{
+		std::size_t parent;
+		RowPtr objective;
+		RowMap rows;
+		ColumnMap columns;
+	};
 
-	Throws
-	------
-	UnknownConstraint
-		The given constraint has not been added to the solver.
+	using ComponentList = std::vector<Component, ResourceAllocator<Component>>;
+
+	/* The state written by the pivots of a pass of the simplex method,
+	besides the rows of the component it works on.
+
+	The solver has its own. Each task of a parallel pass has another one,
+	which is merged into the one of the solver once the tasks are done.
 
 	*/
-	void removeConstraint( const Constraint& constraint )
+	struct Pass
 	{
-		auto cn_it = m_cns.find( constraint );
-		if( cn_it == m_cns.end() )
-			throw UnknownConstraint( constraint );
+		explicit Pass( MemoryResource* resource ) :
+			infeasible( resource ),
+			changed( resource ),
+			entered( resource ),
+			left( resource ),
+			pivots( 0 ) {}
+
+		SymbolList infeasible;
+		SymbolList changed;
+		Row::SymbolVector entered;
+		Row::SymbolVector left;
+		std::size_t pivots;
+	};
 
-		Tag tag( cn_it->second );
-		m_cns.erase( cn_it );
+	using PassList = std::vector<Pass, ResourceAllocator<Pass>>;
 
-		// Remove the error effects from the objective function
-		// *before* pivoting, or substitutions into the objective
-		// will lead to incorrect solver results.
-		removeConstraintEffects( constraint, tag );
+	/* A change of the column index left by a parallel substitution: the
+	basic symbol enters the column of the cell, with its row, or leaves
+	it if the row is null.
 
-		// If the marker is basic, simply drop the row. Otherwise,
-		// pivot the marker into the basis and then drop the row.
-		auto row_it = m_rows.find( tag.marker );
-		if( row_it != m_rows.end() )
-		{
-			std::unique_ptr<Row> rowptr( row_it->second );
-			m_rows.erase( row_it );
-		}
-		else
-		{
-			row_it = getMarkerLeavingRow( tag.marker );
-			if( row_it == m_rows.end() )
-				throw InternalSolverError( "failed to find leaving row" );
-			Symbol leaving( row_it->first );
-			std::unique_ptr<Row> rowptr( row_it->second );
-			m_rows.erase( row_it );
-			rowptr->solveFor( leaving, tag.marker );
-			substitute( tag.marker, *rowptr );
-		}
+	*/
+	struct ColumnUpdate
+	{
+		Symbol cell;
+		Symbol basic;
+		Row* row;
+	};
 
-		// Optimizing after each constraint is removed ensures that the
-		// solver remains consistent. It makes the solver api easier to
-		// use at a small tradeoff for speed.
-		optimize( *m_objective );
-	}
+	using UpdateList = std::vector<ColumnUpdate, ResourceAllocator<ColumnUpdate>>;
 
-	/* Test whether a constraint has been added to the solver.
+	/* The state of a task of a parallel substitution.
 
 	*/
-	bool hasConstraint( const Constraint& constraint ) const
+	struct Chunk
 	{
-		return m_cns.find( constraint ) != m_cns.end();
-	}
+		explicit Chunk( MemoryResource* resource ) : pass( resource ), updates( resource ) {}
 
-	/* Add an edit variable to the solver.
+		Pass pass;
+		UpdateList updates;
+	};
 
-	This method should be called before the `suggestValue` method is
-	used to supply a suggested value for the given edit variable.
+	using ChunkList = std::vector<Chunk, ResourceAllocator<Chunk>>;
 
-	Throws
-	------
-	DuplicateEditVariable
-		The given edit variable has already been added to the solver.
+	using RowList = std::vector<std::pair<Symbol, Row*>, ResourceAllocator<std::pair<Symbol, Row*>>>;
 
-	BadRequiredStrength
-		The given strength is >= required.
+	using SuggestionList = std::vector<std::pair<std::size_t, double>, ResourceAllocator<std::pair<std::size_t, double>>>;
+
+	/* The edit variables whose suggestions are answered from the
+	sensitivity of the current basis, see `setAffineEdits`.
+
+	The values are the last suggested values within the feasible region
+	of the basis, and differ from the ones of the tableau while `pending`
+	is set. The suggestions of the current call are recorded by edit
+	index until they are accepted, or applied to the tableau in order.
 
 	*/
-	void addEditVariable( const Variable& variable, double strength )
+	struct AffineEdits
 	{
-		if( m_edits.find( variable ) != m_edits.end() )
-			throw DuplicateEditVariable( variable );
-		strength = strength::clip( strength );
-		if( strength == strength::required )
-			throw BadRequiredStrength();
-		Constraint cn( Expression( variable ), OP_EQ, strength );
-		addConstraint( cn );
-		EditInfo info;
-		info.tag = m_cns[ cn ];
-		info.constraint = cn;
-		info.constant = 0.0;
-		m_edits[ variable ] = info;
-	}
+		explicit AffineEdits( MemoryResource* resource ) :
+			variables( resource ),
+			sensitivity( resource ),
+			indices( resource ),
+			basics( resource ),
+			values( resource ),
+			candidate( resource ),
+			suggestions( resource ),
+			scratch( resource ),
+			valid( false ),
+			pending( false ) {}
+
+		VariableList variables;
+		Sensitivity sensitivity;
+		IndexList indices;
+		SymbolList basics;
+		ValueList values;
+		ValueList candidate;
+		SuggestionList suggestions;
+		ValueList scratch;
+		bool valid;
+		bool pending;
+	};
 
-	/* Remove an edit variable from the solver.
+	/* A coefficient of an edit variable in the row of a basic symbol, used
+	to build a sensitivity.
 
-	Throws
-	------
-	UnknownEditVariable
-		The given edit variable has not been added to the solver.
+	*/
+	struct EditCell
+	{
+		Symbol basic;
+		std::size_t edit;
+		double coefficient;
+	};
+
+	using EditCellList = std::vector<EditCell, ResourceAllocator<EditCell>>;
+
+	/* A basis met by the affine edits, kept to answer the suggestions
+	falling back in its feasible region without pivoting again.
+
+	The key lists the basic symbols of the rows the edit variables move,
+	which identifies the basis as far as the edit variables are
+	concerned. The sensitivity also holds the variables which had moved
+	since the cache was emptied when it was built, the reach of the
+	cache, with no derivative if they do not depend on the edits.
 
 	*/
-	void removeEditVariable( const Variable& variable )
+	struct CachedBasis
 	{
-		auto it = m_edits.find( variable );
-		if( it == m_edits.end() )
-			throw UnknownEditVariable( variable );
-		removeConstraint( it->second.constraint );
-		m_edits.erase( it );
-	}
+		explicit CachedBasis( MemoryResource* resource ) :
+			sensitivity( resource ),
+			indices( resource ),
+			basics( resource ),
+			key( resource ),
+			used( 0 ) {}
+
+		Sensitivity sensitivity;
+		IndexList indices;
+		SymbolList basics;
+		SymbolList key;
+		std::size_t used;
+	};
 
-	/* Test whether an edit variable has been added to the solver.
+	using BasisList = std::vector<CachedBasis, ResourceAllocator<CachedBasis>>;
+
+	struct ImplDeleter
+	{
+		void operator()( SolverImpl* impl ) const { allocator.deleteObject( impl ); }
+		ResourceAllocator<SolverImpl> allocator;
+	};
+
+	/* A copy of the solver evaluating the scenarios of a sweep.
 
 	*/
-	bool hasEditVariable( const Variable& variable ) const
+	using ImplPtr = std::unique_ptr<SolverImpl, ImplDeleter>;
+
+	using ImplList = std::vector<ImplPtr, ResourceAllocator<ImplPtr>>;
+
+	/* An entry of a map before it changed while the solver held a
+	checkpoint. The entry is erased on rollback if it was absent.
+
+	*/
+	template<typename Map>
+	struct MapUndo
 	{
-		return m_edits.find( variable ) != m_edits.end();
-	}
+		typename Map::key_type key;
+		typename Map::mapped_type value;
+		bool present;
+	};
 
-	/* Suggest a value for the given edit variable.
+	/* An element of a list before it changed while the solver held a
+	checkpoint. The elements appended since are popped on rollback, and
+	the ones popped since are appended again.
 
-	This method should be used after an edit variable as been added to
-	the solver in order to suggest the value for that variable.
+	*/
+	template<typename T>
+	struct ListUndo
+	{
+		std::size_t index;
+		T value;
+		bool present;
+	};
 
-	Throws
-	------
-	UnknownEditVariable
-		The given edit variable has not been added to the solver.
+	template<typename T>
+	using UndoList = std::vector<T, ResourceAllocator<T>>;
+
+	/* A variable and its entries in the lists indexed by variable.
 
 	*/
-	void suggestValue( const Variable& variable, double value )
+	struct VarSlot
 	{
-		auto it = m_edits.find( variable );
-		if( it == m_edits.end() )
-			throw UnknownEditVariable( variable );
+		Variable variable;
+		Symbol symbol;
+		double value;
+		double offset;
+		double scale;
+		std::size_t next;
+		std::size_t refs;
+	};
 
-		DualOptimizeGuard guard( *this );
-		EditInfo& info = it->second;
-		double delta = value - info.constant;
-		info.constant = value;
+	/* The lengths of the logs of an `UndoLog`.
 
-		// Check first if the positive error variable is basic.
-		auto row_it = m_rows.find( info.tag.marker );
-		if( row_it != m_rows.end() )
+	*/
+	struct UndoMark
+	{
+		std::size_t cns;
+		std::size_t cn_slots;
+		std::size_t free_slots;
+		std::size_t refs;
+		std::size_t free_refs;
+		std::size_t vars;
+		std::size_t var_indices;
+		std::size_t var_slots;
+		std::size_t edits;
+		std::size_t bounds;
+		std::size_t symbol_components;
+	};
+
+	/* The changes made to the maps and lists of the solver while it holds
+	a checkpoint, in the order they were made.
+
+	Each entry is logged before the change it undoes. A checkpoint keeps
+	the lengths of the logs when it is taken, and `rollback` undoes the
+	entries logged since in reverse order, so that its work grows with
+	the changes made since the checkpoint rather than with the size of
+	the solver. The values written by the updates of the variables are
+	not logged, as the variables which may need another value are
+	reported as changed by the rollback.
+
+	*/
+	struct UndoLog
+	{
+		explicit UndoLog( MemoryResource* resource ) :
+			cns( resource ),
+			cn_slots( resource ),
+			free_slots( resource ),
+			refs( resource ),
+			free_refs( resource ),
+			vars( resource ),
+			var_indices( resource ),
+			var_slots( resource ),
+			edits( resource ),
+			bounds( resource ),
+			symbol_components( resource ) {}
+
+		UndoMark mark() const
 		{
-			if( row_it->second->add( -delta ) < 0.0 )
-				m_infeasible_rows.push_back( row_it->first );
-			return;
+			return UndoMark{ cns.size(), cn_slots.size(), free_slots.size(), refs.size(), free_refs.size(), vars.size(),
+							 var_indices.size(), var_slots.size(), edits.size(), bounds.size(), symbol_components.size() };
 		}
 
-		// Check next if the negative error variable is basic.
-		row_it = m_rows.find( info.tag.other );
-		if( row_it != m_rows.end() )
+		void clear()
 		{
-			if( row_it->second->add( delta ) < 0.0 )
-				m_infeasible_rows.push_back( row_it->first );
-			return;
+			cns.clear();
+			cn_slots.clear();
+			free_slots.clear();
+			refs.clear();
+			free_refs.clear();
+			vars.clear();
+			var_indices.clear();
+			var_slots.clear();
+			edits.clear();
+			bounds.clear();
+			symbol_components.clear();
 		}
 
-		// Otherwise update each row where the error variables exist.
-		for (const auto & rowPair : m_rows)
+		UndoList<MapUndo<CnMap>> cns;
+		UndoList<ListUndo<CnSlot>> cn_slots;
+		UndoList<ListUndo<std::size_t>> free_slots;
+		UndoList<ListUndo<VarRef>> refs;
+		UndoList<ListUndo<std::size_t>> free_refs;
+		UndoList<MapUndo<VarMap>> vars;
+		UndoList<MapUndo<IndexMap>> var_indices;
+		UndoList<ListUndo<VarSlot>> var_slots;
+		UndoList<MapUndo<EditMap>> edits;
+		UndoList<MapUndo<BoundMap>> bounds;
+		UndoList<MapUndo<SymbolComponentMap>> symbol_components;
+	};
+
+	/* The state of the solver recorded by `checkpoint`.
+
+	The changes made to the maps and lists of the solver from then on
+	are logged, see `UndoLog`, and only its counters, the lists of
+	pending work and the affine edits are copied. A component is only
+	copied the first time it is about to change while the checkpoint is
+	the newest one, see `saveComponent`. The copies share their rows
+	with the tableau, which copies a shared row before changing it, so
+	the work done for a checkpoint grows with the changes made since it
+	was taken.
+
+	*/
+	struct Checkpoint
+	{
+		Checkpoint( std::size_t token, const UndoMark& mark, MemoryResource* resource ) :
+			token( token ),
+			mark( mark ),
+			components( 0 ),
+			stale_cns( 0 ),
+			id_tick( 0 ),
+			removed( 0 ),
+			infeasible( resource ),
+			dirty( resource ),
+			affine( resource ),
+			saved( resource ),
+			indices( resource ) {}
+
+		Checkpoint( Checkpoint&& ) = default;
+
+		Checkpoint& operator=( Checkpoint&& ) = delete;
+
+		~Checkpoint()
 		{
-			double coeff = rowPair.second->coefficientFor( info.tag.marker );
-			if( coeff != 0.0 &&
-				rowPair.second->add( delta * coeff ) < 0.0 &&
-				rowPair.first.type() != Symbol::External )
-				m_infeasible_rows.push_back( rowPair.first );
+			RowDeleter deleter{ ResourceAllocator<SharedRow>( saved.get_allocator().resource() ) };
+			for( auto& component : saved )
+			{
+				for( auto& rowPair : component.rows )
+					deleter( rowPair.second );
+			}
+		}
+
+		std::size_t token;
+		UndoMark mark;
+		std::size_t components;
+		std::size_t stale_cns;
+		Symbol::Id id_tick;
+		std::size_t removed;
+		SymbolList infeasible;
+		IndexList dirty;
+		AffineEdits affine;
+		ComponentList saved;
+		IndexList indices;
+	};
+
+	using CheckpointList = std::vector<Checkpoint, ResourceAllocator<Checkpoint>>;
+
+	using EditList = std::vector<EditInfo*, ResourceAllocator<EditInfo*>>;
+
+	/* Pairs of a component root and a symbol, used to sort the dirty
+	components and the infeasible rows by component.
+
+	*/
+	using RootList = std::vector<std::pair<std::size_t, Symbol>, ResourceAllocator<std::pair<std::size_t, Symbol>>>;
+
+	/* How `insertConstraint` adds the row of a constraint new to the
+	solver, see `probeConstraint`.
+
+	*/
+	enum RowEntry
+	{
+		EntersDirectly,
+		NeedsArtificial,
+		CannotEnter
+	};
+
+	/* The number of consecutive pivots not improving the objective after
+	which the Bland rule takes over from the pivot rule.
+
+	*/
+	static constexpr std::size_t DegeneratePivotLimit = 50;
+
+	/* The amount by which the ratio tests may let a restricted basic
+	symbol, or a coefficient of the objective, go below zero.
+
+	*/
+	static constexpr double RatioTolerance = 1.0e-9;
+
+	/* The end of a list of variable indices.
+
+	*/
+	static constexpr std::size_t NoIndex = static_cast<std::size_t>( -1 );
+
+	/* The number of constraint removals, on top of half the number of
+	constraints, after which the components are split again.
+
+	*/
+	static constexpr std::size_t SplitThreshold = 64;
+
+	/* The number of entries of removed constraints, on top of the number
+	of constraints, after which the map of constraints is compacted.
+
+	*/
+	static constexpr std::size_t CompactThreshold = 64;
+
+	/* The smallest number of rows substituted by a task of a parallel
+	substitution.
+
+	*/
+	static constexpr std::size_t ChunkRows = 32;
+
+	struct DualOptimizeGuard
+	{
+		DualOptimizeGuard( SolverImpl& impl ) : m_impl( impl ) {}
+		~DualOptimizeGuard() { m_impl.dualOptimize(); }
+		SolverImpl& m_impl;
+	};
+
+public:
+
+	SolverImpl() : SolverImpl( newDeleteResource() ) {}
+
+	/* Create a solver drawing all of its memory from the given resource.
+
+	The resource must outlive the solver.
+
+	*/
+	explicit SolverImpl( MemoryResource* resource ) :
+		m_resource( resource ),
+		m_cns( resource ),
+		m_cn_slots( resource ),
+		m_free_slots( resource ),
+		m_refs( resource ),
+		m_free_refs( resource ),
+		m_stale_cns( 0 ),
+		m_cn_tick( 0 ),
+		m_vars( resource ),
+		m_var_indices( resource ),
+		m_var_list( resource ),
+		m_var_symbols( resource ),
+		m_values( resource ),
+		m_var_offsets( resource ),
+		m_var_scales( resource ),
+		m_var_next( resource ),
+		m_var_refs( resource ),
+		m_edits( resource ),
+		m_bounds( resource ),
+		m_pass( resource ),
+		m_components( resource ),
+		m_symbol_components( resource ),
+		m_dirty( resource ),
+		m_roots( resource ),
+		m_groups( resource ),
+		m_chunks( resource ),
+		m_column_rows( resource ),
+		m_pool( nullptr ),
+		m_substitute_threshold( 0 ),
+		m_affine( resource ),
+		m_edit_cells( resource ),
+		m_bases( resource ),
+		m_reach( resource ),
+		m_reach_scratch( resource ),
+		m_moved( resource ),
+		m_basis_capacity( 0 ),
+		m_basis_tick( 0 ),
+		m_basis_hits( 0 ),
+		m_basis_misses( 0 ),
+		m_id_tick( 1 ),
+		m_removed( 0 ),
+		m_checkpoints( resource ),
+		m_component_saves( resource ),
+		m_undo( resource ),
+		m_checkpoint_tick( 0 ),
+		m_trial_log( resource ),
+		m_trial( false ) {}
+
+	SolverImpl( const SolverImpl& ) = delete;
+
+	/* Move a solver into a new one, leaving it empty.
+
+	*/
+	SolverImpl( SolverImpl&& other ) noexcept :
+		m_resource( other.m_resource ),
+		m_cns( std::move( other.m_cns ) ),
+		m_cn_slots( std::move( other.m_cn_slots ) ),
+		m_free_slots( std::move( other.m_free_slots ) ),
+		m_refs( std::move( other.m_refs ) ),
+		m_free_refs( std::move( other.m_free_refs ) ),
+		m_stale_cns( other.m_stale_cns ),
+		m_cn_tick( other.m_cn_tick ),
+		m_vars( std::move( other.m_vars ) ),
+		m_var_indices( std::move( other.m_var_indices ) ),
+		m_var_list( std::move( other.m_var_list ) ),
+		m_var_symbols( std::move( other.m_var_symbols ) ),
+		m_values( std::move( other.m_values ) ),
+		m_var_offsets( std::move( other.m_var_offsets ) ),
+		m_var_scales( std::move( other.m_var_scales ) ),
+		m_var_next( std::move( other.m_var_next ) ),
+		m_var_refs( std::move( other.m_var_refs ) ),
+		m_edits( std::move( other.m_edits ) ),
+		m_bounds( std::move( other.m_bounds ) ),
+		m_pass( std::move( other.m_pass ) ),
+		m_components( std::move( other.m_components ) ),
+		m_symbol_components( std::move( other.m_symbol_components ) ),
+		m_dirty( std::move( other.m_dirty ) ),
+		m_roots( std::move( other.m_roots ) ),
+		m_groups( std::move( other.m_groups ) ),
+		m_chunks( std::move( other.m_chunks ) ),
+		m_column_rows( std::move( other.m_column_rows ) ),
+		m_artificial( std::move( other.m_artificial ) ),
+		m_pool( other.m_pool ),
+		m_substitute_threshold( other.m_substitute_threshold ),
+		m_affine( std::move( other.m_affine ) ),
+		m_edit_cells( std::move( other.m_edit_cells ) ),
+		m_bases( std::move( other.m_bases ) ),
+		m_reach( std::move( other.m_reach ) ),
+		m_reach_scratch( std::move( other.m_reach_scratch ) ),
+		m_moved( std::move( other.m_moved ) ),
+		m_basis_capacity( other.m_basis_capacity ),
+		m_basis_tick( other.m_basis_tick ),
+		m_basis_hits( other.m_basis_hits ),
+		m_basis_misses( other.m_basis_misses ),
+		m_id_tick( other.m_id_tick ),
+		m_removed( other.m_removed ),
+		m_checkpoints( std::move( other.m_checkpoints ) ),
+		m_component_saves( std::move( other.m_component_saves ) ),
+		m_undo( std::move( other.m_undo ) ),
+		m_checkpoint_tick( other.m_checkpoint_tick ),
+		m_trial_log( std::move( other.m_trial_log ) ),
+		m_trial( false )
+	{
+		other.reset();
+	}
+
+	~SolverImpl() { clearRows(); }
+
+	/* Create a copy of the solver drawing its memory from the same
+	resource.
+
+	The copy shares the rows of the tableau with the solver, and a row is
+	only copied by the first of them to change it, so cloning costs a
+	copy of the maps indexing the tableau and the variables, and changing
+	the copy a copy of the rows it touches. The copy has the constraints,
+	edit variables, bounds, affine edits and settings of the solver, and
+	an empty cache of bases of the same size. It refers to the same
+	variables, whose values are written by whichever solver updates them.
+
+	*/
+	SolverImpl clone() const
+	{
+		SolverImpl copy( resource() );
+		copy.copyFrom( *this );
+		copy.m_affine = m_affine;
+		copy.m_basis_capacity = m_basis_capacity;
+		return copy;
+	}
+
+	/* Record the state of the solver, to be restored by `rollback`.
+
+	Taking a checkpoint copies neither the maps of the solver, whose
+	changes are logged from then on, nor its tableau, whose components
+	are copied as they change, see `Checkpoint`. Checkpoints nest, and
+	the returned token is never given again by the solver.
+
+	*/
+	std::size_t checkpoint()
+	{
+		Checkpoint checkpoint( m_checkpoint_tick, m_undo.mark(), resource() );
+		checkpoint.components = m_components.size();
+		checkpoint.stale_cns = m_stale_cns;
+		checkpoint.id_tick = m_id_tick;
+		checkpoint.removed = m_removed;
+		checkpoint.infeasible = m_pass.infeasible;
+		checkpoint.dirty = m_dirty;
+		checkpoint.affine = m_affine;
+		if( m_component_saves.size() < m_components.size() )
+			m_component_saves.resize( m_components.size(), NoIndex );
+		m_checkpoints.push_back( std::move( checkpoint ) );
+		return m_checkpoint_tick++;
+	}
+
+	/* Restore the state recorded by a checkpoint, and release it along
+	with the checkpoints taken after it.
+
+	The constraints, edit variables, bounds, affine edits, suggested
+	values and tableau are those of the checkpoint, and the symbols it
+	had not given yet will be given again. Only the components changed
+	since the checkpoint are restored, and only the entries of the maps
+	changed since are undone. The thread pool, settings and statistics
+	of the solver are kept, and its cache of bases is emptied. The
+	variables whose value may differ are reported by the next call to
+	`updateChangedVariables`.
+
+	Throws
+	------
+	UnknownCheckpoint
+		The solver does not hold the given checkpoint.
+
+	*/
+	void rollback( std::size_t token )
+	{
+		std::size_t index = findCheckpoint( token );
+		std::size_t size = m_checkpoints[ index ].components;
+		IndexList restored( size, 0, resource() );
+		for( std::size_t i = index, n = m_checkpoints.size(); i < n; ++i )
+		{
+			for( std::size_t component : m_checkpoints[ i ].indices )
+			{
+				if( component < size )
+					restored[ component ] = 1;
+			}
+		}
+
+		// Only the basic variables of the components changed since the
+		// checkpoint, before and after the rollback, the variables whose
+		// entries are undone, and the ones given the values of pending
+		// suggestions, may hold a value differing from the one of the
+		// checkpoint.
+		SymbolList changed( resource() );
+		if( m_affine.pending )
+			changed.assign( m_affine.basics.begin(), m_affine.basics.end() );
+		CheckpointList checkpoints( std::move( m_checkpoints ) );
+
+		// The components created since the checkpoint are dropped, and
+		// each component changed since gets back its oldest copy, which
+		// is the one of the checkpoint.
+		while( m_components.size() > size )
+		{
+			appendBasics( m_components.back(), changed );
+			releaseRows( m_components.back() );
+			m_components.pop_back();
+		}
+		while( m_components.size() < size )
+			newComponent();
+		for( std::size_t i = index, n = checkpoints.size(); i < n; ++i )
+		{
+			Checkpoint& later( checkpoints[ i ] );
+			for( std::size_t j = 0, count = later.saved.size(); j < count; ++j )
+			{
+				std::size_t component = later.indices[ j ];
+				if( component >= size || restored[ component ] != 1 )
+					continue;
+				restored[ component ] = 2;
+				appendBasics( m_components[ component ], changed );
+				releaseRows( m_components[ component ] );
+				m_components[ component ] = std::move( later.saved[ j ] );
+				later.saved[ j ].rows.clear();
+				appendBasics( m_components[ component ], changed );
+			}
+		}
+
+		Checkpoint& checkpoint( checkpoints[ index ] );
+		m_stale_cns = checkpoint.stale_cns;
+		undoChanges( checkpoint.mark, changed );
+		m_id_tick = checkpoint.id_tick;
+		m_removed = checkpoint.removed;
+		m_pass.infeasible = checkpoint.infeasible;
+		m_dirty = checkpoint.dirty;
+		m_affine = checkpoint.affine;
+		dropBases();
+		while( checkpoints.size() > index )
+			checkpoints.pop_back();
+		m_checkpoints.swap( checkpoints );
+
+		for( const auto& symbol : changed )
+			markChanged( symbol, m_pass );
+	}
+
+	/* Keep the changes made since a checkpoint, and release it along with
+	the checkpoints taken after it.
+
+	The copies of the components they hold are passed on to the previous
+	checkpoint, unless it already has a copy of the same component. The
+	changes logged since stay in the log of the previous checkpoint, and
+	the log is emptied once no checkpoint is left.
+
+	Throws
+	------
+	UnknownCheckpoint
+		The solver does not hold the given checkpoint.
+
+	*/
+	void commit( std::size_t token )
+	{
+		std::size_t index = findCheckpoint( token );
+		if( index > 0 )
+		{
+			Checkpoint& earlier( m_checkpoints[ index - 1 ] );
+			std::size_t count = earlier.saved.size();
+			for( std::size_t i = index, n = m_checkpoints.size(); i < n; ++i )
+				count += m_checkpoints[ i ].saved.size();
+			earlier.saved.reserve( count );
+			earlier.indices.reserve( count );
+			for( std::size_t i = index, n = m_checkpoints.size(); i < n; ++i )
+			{
+				Checkpoint& later( m_checkpoints[ i ] );
+				for( std::size_t j = 0, size = later.saved.size(); j < size; ++j )
+				{
+					std::size_t component = later.indices[ j ];
+					if( component >= earlier.components || m_component_saves[ component ] == earlier.token )
+						continue;
+					m_component_saves[ component ] = earlier.token;
+					earlier.saved.push_back( std::move( later.saved[ j ] ) );
+					earlier.indices.push_back( component );
+					later.saved[ j ].rows.clear();
+				}
+			}
+		}
+		while( m_checkpoints.size() > index )
+			m_checkpoints.pop_back();
+		if( m_checkpoints.empty() )
+			m_undo.clear();
+	}
+
+	/* Get the number of checkpoints held by the solver.
+
+	*/
+	std::size_t checkpointCount() const
+	{
+		return m_checkpoints.size();
+	}
+
+	/* Test whether the solver holds a checkpoint.
+
+	*/
+	bool hasCheckpoint( std::size_t token ) const
+	{
+		for( const auto& checkpoint : m_checkpoints )
+		{
+			if( checkpoint.token == token )
+				return true;
+		}
+		return false;
+	}
+
+	/* Add a constraint to the solver and return its handle.
+
+	Throws
+	------
+	DuplicateConstraint
+		The given constraint has already been added to the solver.
+
+	UnsatisfiableConstraint
+		The given constraint is required and cannot be satisfied.
+
+	*/
+	ConstraintHandle addConstraint( const Constraint& constraint )
+	{
+		prepareChange();
+		ConstraintHandle handle;
+		try
+		{
+			handle = addConstraintRow( constraint );
+		}
+		catch( ... )
+		{
+			optimizeDirty();
+			throw;
+		}
+
+		// Optimizing after each constraint is added performs less
+		// aggregate work due to a smaller average system size. It
+		// also ensures the solver remains in a consistent state.
+		optimizeDirty();
+		return handle;
+	}
+
+	/* Add a range of constraints to the solver.
+
+	The rows of all the constraints are added to the tableau before a
+	single optimization pass. The tableau stays feasible while the rows
+	are added, only the objective is left unoptimized in between.
+
+	If a constraint cannot be added, the constraints preceding it remain
+	in the solver, which is optimized before the exception propagates.
+	The following constraints are not added.
+
+	Throws
+	------
+	DuplicateConstraint
+		A constraint has already been added to the solver.
+
+	UnsatisfiableConstraint
+		A constraint is required and cannot be satisfied.
+
+	*/
+	template<typename InputIterator>
+	void addConstraints( InputIterator first, InputIterator last )
+	{
+		prepareChange();
+		try
+		{
+			for( ; first != last; ++first )
+				addConstraintRow( *first );
+		}
+		catch( ... )
+		{
+			optimizeDirty();
+			throw;
+		}
+		optimizeDirty();
+	}
+
+	/* Remove a constraint from the solver.
+
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	*/
+	void removeConstraint( const Constraint& constraint )
+	{
+		prepareChange();
+		removeConstraintRow( constraint );
+
+		// Optimizing after each constraint is removed ensures that the
+		// solver remains consistent. It makes the solver api easier to
+		// use at a small tradeoff for speed.
+		optimizeDirty();
+	}
+
+	/* Remove the constraint a handle refers to from the solver.
+
+	Throws
+	------
+	UnknownConstraintHandle
+		The constraint of the handle has been removed from the solver.
+
+	*/
+	void removeConstraint( const ConstraintHandle& handle )
+	{
+		prepareChange();
+		removeConstraintRow( handle );
+		optimizeDirty();
+	}
+
+	/* Remove a range of constraints, or of handles of constraints, from
+	the solver.
+
+	All the rows are removed from the tableau before a single
+	optimization pass. If a constraint is unknown, the constraints
+	preceding it are removed and the solver is optimized before the
+	exception propagates. The following constraints are not removed.
+
+	Throws
+	------
+	UnknownConstraint
+		A constraint has not been added to the solver.
+
+	UnknownConstraintHandle
+		The constraint of a handle has been removed from the solver.
+
+	*/
+	template<typename InputIterator>
+	void removeConstraints( InputIterator first, InputIterator last )
+	{
+		prepareChange();
+		try
+		{
+			for( ; first != last; ++first )
+				removeConstraintRow( *first );
+		}
+		catch( ... )
+		{
+			optimizeDirty();
+			throw;
+		}
+		optimizeDirty();
+	}
+
+	/* Test whether a constraint has been added to the solver.
+
+	*/
+	bool hasConstraint( const Constraint& constraint ) const
+	{
+		return findSlot( constraint ) != NoIndex;
+	}
+
+	/* Test whether the constraint a handle refers to is in the solver.
+
+	*/
+	bool hasConstraint( const ConstraintHandle& handle ) const
+	{
+		return findSlot( handle ) != NoIndex;
+	}
+
+	/* Add a constraint to the solver, returning why it cannot be added
+	instead of throwing.
+
+	A constraint which cannot be added leaves the solver as it was: none
+	of its variables is added, no symbol is taken, and the parts of the
+	tableau it changed are restored. Only a required constraint whose
+	row needs an artificial variable to enter the basis can fail once it
+	changed the tableau, so only such a constraint copies the components
+	of the tableau it joins, sharing their rows, before it is added.
+
+	The handle of the constraint is written to the given one, if any,
+	once it is added.
+
+	*/
+	Status tryAddConstraint( const Constraint& constraint, ConstraintHandle* handle = nullptr )
+	{
+		if( findSlot( constraint ) != NoIndex )
+			return STATUS_DUPLICATE_CONSTRAINT;
+		syncAffine();
+		Row row( 0.0, resource() );
+		ConstraintHandle added;
+		switch( probeConstraint( constraint, row ) )
+		{
+			case CannotEnter:
+				return STATUS_UNSATISFIABLE_CONSTRAINT;
+			case NeedsArtificial:
+				if( !addTrialConstraint( constraint, row, added ) )
+					return STATUS_UNSATISFIABLE_CONSTRAINT;
+				dropBases();
+				break;
+			default:
+				dropBases();
+				insertConstraint( constraint, added );
+				break;
+		}
+		optimizeDirty();
+		if( handle )
+			*handle = added;
+		return STATUS_OK;
+	}
+
+	/* Remove a constraint from the solver, returning whether it had been
+	added instead of throwing.
+
+	*/
+	Status tryRemoveConstraint( const Constraint& constraint )
+	{
+		if( findSlot( constraint ) == NoIndex )
+			return STATUS_UNKNOWN_CONSTRAINT;
+		removeConstraint( constraint );
+		return STATUS_OK;
+	}
+
+	/* Remove the constraint a handle refers to, returning whether it is
+	in the solver instead of throwing.
+
+	*/
+	Status tryRemoveConstraint( const ConstraintHandle& handle )
+	{
+		if( findSlot( handle ) == NoIndex )
+			return STATUS_UNKNOWN_CONSTRAINT;
+		removeConstraint( handle );
+		return STATUS_OK;
+	}
+
+	/* Add an edit variable to the solver.
+
+	This method should be called before the `suggestValue` method is
+	used to supply a suggested value for the given edit variable.
+
+	Throws
+	------
+	DuplicateEditVariable
+		The given edit variable has already been added to the solver.
+
+	BadRequiredStrength
+		The given strength is >= required.
+
+	*/
+	void addEditVariable( const Variable& variable, double strength )
+	{
+		if( m_edits.find( variable ) != m_edits.end() )
+			throw DuplicateEditVariable( variable );
+		strength = strength::clip( strength );
+		if( strength == strength::required )
+			throw BadRequiredStrength();
+		Constraint cn( Expression( variable ), OP_EQ, strength );
+		ConstraintHandle handle( addConstraint( cn ) );
+		EditInfo info;
+		info.tag = m_cn_slots[ handle.slot() ].tag;
+		info.constraint = cn;
+		info.constant = 0.0;
+		saveEntry( m_undo.edits, m_edits, variable );
+		m_edits[ variable ] = info;
+	}
+
+	/* Remove an edit variable from the solver.
+
+	Throws
+	------
+	UnknownEditVariable
+		The given edit variable has not been added to the solver.
+
+	*/
+	void removeEditVariable( const Variable& variable )
+	{
+		auto it = m_edits.find( variable );
+		if( it == m_edits.end() )
+			throw UnknownEditVariable( variable );
+		removeConstraint( it->second.constraint );
+		saveEntry( m_undo.edits, m_edits, variable );
+		m_edits.erase( it );
+		std::size_t index = findVariable( m_affine.variables, variable );
+		if( index != NoIndex )
+			m_affine.variables.erase( m_affine.variables.begin() + index );
+	}
+
+	/* Test whether an edit variable has been added to the solver.
+
+	*/
+	bool hasEditVariable( const Variable& variable ) const
+	{
+		return m_edits.find( variable ) != m_edits.end();
+	}
+
+	/* Remove a range of variables and every constraint referring to them
+	from the solver.
+
+	The variables stop being edit variables and lose their bounds. All
+	the rows are removed from the tableau before a single optimization
+	pass. The constraints are found from the references to the given
+	variables, so the work grows with the number of constraints referring
+	to them rather than with the size of the solver. The variables which
+	no constraint refers to, like the ones left by a constraint which
+	could not be added, are dropped, and the variables unknown to the
+	solver are ignored.
+
+	*/
+	template<typename InputIterator>
+	void removeVariables( InputIterator first, InputIterator last )
+	{
+		VariableList variables( resource() );
+		for( ; first != last; ++first )
+		{
+			if( m_vars.find( *first ) != m_vars.end() )
+				variables.push_back( *first );
+		}
+		if( variables.empty() )
+			return;
+		std::sort( variables.begin(), variables.end() );
+		variables.erase( std::unique( variables.begin(), variables.end(), []( const Variable& a, const Variable& b )
+		{
+			return !( a < b ) && !( b < a );
+		} ), variables.end() );
+		prepareChange();
+
+		// The constraints are removed in the order of their slots, which
+		// does not depend on the order of the references.
+		IndexList slots( resource() );
+		for( const auto& variable : variables )
+		{
+			for( std::size_t ref = m_var_refs[ variableIndex( variable ) ]; ref != NoIndex; ref = m_refs[ ref ].next )
+				slots.push_back( m_refs[ ref ].slot );
+		}
+		std::sort( slots.begin(), slots.end() );
+		slots.erase( std::unique( slots.begin(), slots.end() ), slots.end() );
+		for( std::size_t slot : slots )
+			removeSlotRow( slot );
+
+		for( const auto& variable : variables )
+		{
+			auto edit_it = m_edits.find( variable );
+			if( edit_it != m_edits.end() )
+			{
+				saveEntry( m_undo.edits, m_edits, variable );
+				m_edits.erase( edit_it );
+				std::size_t index = findVariable( m_affine.variables, variable );
+				if( index != NoIndex )
+					m_affine.variables.erase( m_affine.variables.begin() + index );
+			}
+			saveEntry( m_undo.bounds, m_bounds, variable );
+			m_bounds.erase( variable );
+			if( m_vars.find( variable ) != m_vars.end() )
+				dropVariable( variableIndex( variable ) );
+		}
+		optimizeDirty();
+	}
+
+	/* Suggest a value for the given edit variable.
+
+	This method should be used after an edit variable as been added to
+	the solver in order to suggest the value for that variable.
+
+	The suggestion of an edit variable given to `setAffineEdits` is
+	answered from the sensitivity of the basis when it stays feasible.
+
+	Throws
+	------
+	UnknownEditVariable
+		The given edit variable has not been added to the solver.
+
+	*/
+	void suggestValue( const Variable& variable, double value )
+	{
+		auto it = m_edits.find( variable );
+		if( it == m_edits.end() )
+			throw UnknownEditVariable( variable );
+
+		if( setAffineValue( variable, value ) )
+		{
+			settleAffine();
+			return;
+		}
+		DualOptimizeGuard guard( *this );
+		applyAffine();
+		dropBases();
+		applySuggestion( variable, it->second, value );
+	}
+
+	/* Suggest a value for an edit variable, returning whether it is an
+	edit variable instead of throwing.
+
+	*/
+	Status trySuggestValue( const Variable& variable, double value )
+	{
+		if( m_edits.find( variable ) == m_edits.end() )
+			return STATUS_UNKNOWN_EDIT_VARIABLE;
+		suggestValue( variable, value );
+		return STATUS_OK;
+	}
+
+	/* Suggest values for a range of edit variables.
+
+	The elements of the range are pairs of an edit variable and its
+	suggested value. The changes of all the suggestions are pushed
+	into the tableau before a single pass of the dual simplex method.
+
+	If a variable is not an edit variable, the suggestions preceding it
+	are applied and the solver is optimized before the exception
+	propagates. The following suggestions are ignored.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	void suggestValues( InputIterator first, InputIterator last )
+	{
+		bool affine = true;
+		try
+		{
+			for( ; first != last; ++first )
+			{
+				auto it = m_edits.find( first->first );
+				if( it == m_edits.end() )
+					throw UnknownEditVariable( first->first );
+				if( affine && setAffineValue( first->first, first->second ) )
+					continue;
+				affine = false;
+				applyAffine();
+				dropBases();
+				applySuggestion( first->first, it->second, first->second );
+			}
+		}
+		catch( ... )
+		{
+			settleAffine();
+			throw;
+		}
+		settleAffine();
+	}
+
+	/* Answer the suggestions of the given edit variables from the
+	sensitivity of the current basis.
+
+	While the suggested values keep the basis feasible, the suggestions
+	of these edit variables are recorded without changing the tableau,
+	and the values of the variables depending on them are computed from
+	the sensitivity when the variables are updated. A suggestion leaving
+	the feasible region, any other change to the solver, or an empty
+	range, pushes the recorded suggestions into the tableau first.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	void setAffineEdits( InputIterator first, InputIterator last )
+	{
+		VariableList variables( resource() );
+		collectEdits( first, last, variables );
+		prepareChange();
+		m_affine.variables.swap( variables );
+	}
+
+	/* Get the edit variables whose suggestions are answered from the
+	sensitivity of the basis.
+
+	*/
+	ArrayView<Variable> affineEdits() const
+	{
+		return ArrayView<Variable>( m_affine.variables.data(), m_affine.variables.size() );
+	}
+
+	/* Get the sensitivity of the variables to the given edit variables,
+	for the current basis.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	Sensitivity sensitivity( InputIterator first, InputIterator last )
+	{
+		AffineEdits affine( resource() );
+		collectEdits( first, last, affine.variables );
+		syncAffine();
+		buildSensitivity( affine, nullptr );
+		return affine.sensitivity;
+	}
+
+	/* Set the number of bases of the affine edits kept in a cache.
+
+	When a suggestion of the affine edits leaves the feasible region of
+	the basis, it is answered from the most recently used cached basis
+	feasible for it, if any, instead of pivoting. The least recently used
+	basis is dropped when the cache is full. The cache is emptied by any
+	change to the solver other than a suggestion of the affine edits, and
+	is disabled by default or with a size of 0.
+
+	*/
+	void setBasisCacheSize( std::size_t size )
+	{
+		m_basis_capacity = size;
+		if( m_bases.size() > size )
+		{
+			std::sort( m_bases.begin(), m_bases.end(), []( const CachedBasis& lhs, const CachedBasis& rhs )
+			{
+				return lhs.used > rhs.used;
+			} );
+			m_bases.erase( m_bases.begin() + size, m_bases.end() );
+		}
+		if( size == 0 )
+			m_reach.clear();
+	}
+
+	/* Get the number of bases of the affine edits kept in a cache.
+
+	*/
+	std::size_t basisCacheSize() const
+	{
+		return m_basis_capacity;
+	}
+
+	/* Get the statistics of the cache of bases.
+
+	The hits and misses are counted since the solver was created or
+	reset.
+
+	*/
+	BasisCacheStats basisCacheStats() const
+	{
+		BasisCacheStats stats;
+		stats.hits = m_basis_hits;
+		stats.misses = m_basis_misses;
+		stats.entries = m_bases.size();
+		stats.memory = m_bases.capacity() * sizeof( CachedBasis ) + m_reach.capacity() * sizeof( Symbol );
+		for( const auto& basis : m_bases )
+		{
+			stats.memory += basis.sensitivity.memory() + basis.indices.capacity() * sizeof( std::size_t ) +
+				( basis.basics.capacity() + basis.key.capacity() ) * sizeof( Symbol );
+		}
+		return stats;
+	}
+
+	/* Solve the solver for many scenarios of suggested values at once.
+
+	The values are a dense row-major matrix with one row per scenario and
+	one column per edit variable of the range. Each scenario suggests its
+	values as `suggestValues` would, and the result is a dense row-major
+	matrix with one row per scenario and one column per variable index,
+	holding the values the variables would be updated to.
+
+	The scenarios are split into contiguous blocks evaluated in order by
+	copies of the solver, one per thread of the thread pool, so the solver
+	itself is left unchanged. With a single thread the values are those
+	of suggesting the scenarios in order to the solver. When several
+	solutions have the same cost, the one found for a scenario may depend
+	on the number of threads.
+
+	Throws
+	------
+	UnknownEditVariable
+		A variable has not been added to the solver as edit variable.
+
+	*/
+	template<typename InputIterator>
+	std::vector<double> sweep( InputIterator first, InputIterator last, const double* values, std::size_t scenarios )
+	{
+		VariableList edits( resource() );
+		for( ; first != last; ++first )
+		{
+			if( m_edits.find( *first ) == m_edits.end() )
+				throw UnknownEditVariable( *first );
+			edits.push_back( *first );
+		}
+		syncAffine();
+
+		// The copies are made and destroyed on the calling thread, as the
+		// reference counts of the variables and constraints are not atomic.
+		std::size_t columns = edits.size();
+		std::size_t count = m_pool ? std::min( m_pool->size(), scenarios ) : std::min<std::size_t>( 1, scenarios );
+		ImplList workers( resource() );
+		std::vector<EditList, ResourceAllocator<EditList>> infos( resource() );
+		ResourceAllocator<SolverImpl> allocator( resource() );
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			workers.push_back( ImplPtr( allocator.newObject( resource() ), ImplDeleter{ allocator } ) );
+			SolverImpl& worker( *workers.back() );
+			worker.copyFrom( *this );
+			worker.m_pool = nullptr;
+			infos.emplace_back( resource() );
+			for( const auto& edit : edits )
+				infos.back().push_back( &worker.m_edits.find( edit )->second );
+		}
+
+		std::size_t width = m_var_list.size();
+		std::vector<double> results( scenarios * width );
+		auto task = [&]( std::size_t i )
+		{
+			SolverImpl& worker( *workers[ i ] );
+			for( std::size_t scenario = i * scenarios / count, end = ( i + 1 ) * scenarios / count;
+				 scenario < end; ++scenario )
+			{
+				const double* row = values + scenario * columns;
+				for( std::size_t j = 0; j < columns; ++j )
+					worker.applySuggestion( edits[ j ], *infos[ i ][ j ], row[ j ] );
+				worker.dualOptimize();
+				worker.computeValues( &results[ scenario * width ] );
+			}
+		};
+		if( count > 1 )
+			m_pool->parallelFor( count, task );
+		else if( count == 1 )
+			task( 0 );
+		return results;
+	}
+
+	/* Set the bounds of a variable.
+
+	The variable is required to stay within [lower, upper]. An infinite
+	bound leaves that side of the variable free, so bounds can be removed
+	by setting them to infinity. The bounds replace the ones previously
+	set by this method, but not the constraints added to the solver.
+
+	The first bound of a variable which no constraint refers to yet is a
+	native bound, which costs no row of the tableau and is moved in place
+	by the dual simplex method, see `addNativeBound`. The other bounds
+	are required constraints.
+
+	If a bound cannot be satisfied, the exception refers to it and the
+	variable is left without it, or with its previous native bound.
+
+	Throws
+	------
+	UnsatisfiableConstraint
+		The lower bound is above the upper bound, or a bound cannot be
+		satisfied together with the required constraints.
+
+	*/
+	void setBounds( const Variable& variable, double lower, double upper )
+	{
+		if( lower > upper )
+			throw UnsatisfiableConstraint( boundConstraint( variable, OP_GE, lower ) );
+		prepareChange();
+
+		// Remove the bounds which cannot be moved in place first, so that
+		// they do not conflict with the new ones.
+		saveEntry( m_undo.bounds, m_bounds, variable );
+		BoundInfo& info( m_bounds[ variable ] );
+		bool removed = dropBound( info.lower, lower );
+		removed = dropBound( info.upper, upper ) || removed;
+		if( removed )
+			optimizeDirty();
+
+		// Move the native bound while the objective is optimal, as needed
+		// by the dual simplex method, then add the other bounds.
+		try
+		{
+			bool add_lower = !info.lower;
+			bool add_upper = !info.upper;
+			if( !add_lower )
+				moveBound( info.lower, variable, OP_GE, lower );
+			if( !add_upper )
+				moveBound( info.upper, variable, OP_LE, upper );
+			if( add_lower && std::isfinite( lower ) )
+				addBound( info.lower, variable, OP_GE, lower );
+			if( add_upper && std::isfinite( upper ) )
+				addBound( info.upper, variable, OP_LE, upper );
+		}
+		catch( ... )
+		{
+			optimizeDirty();
+			throw;
+		}
+		optimizeDirty();
+		if( !info.lower && !info.upper )
+			m_bounds.erase( variable );
+	}
+
+	/* Update the values of the external solver variables.
+
+	*/
+	void updateVariables()
+	{
+		for( std::size_t i = 0, n = m_var_list.size(); i < n; ++i )
+		{
+			const Row* row = rowOf( m_var_symbols[ i ] );
+			double value = row ? row->constant() : 0.0;
+			value = m_var_offsets[ i ] + m_var_scales[ i ] * value;
+			m_values[ i ] = value;
+			m_var_list[ i ].setValue( value );
+		}
+		if( m_affine.pending )
+			updateAffineVariables( nullptr );
+		m_pass.changed.clear();
+	}
+
+	/* Update the values of the external solver variables which changed.
+
+	Only the variables whose row was modified since the last update are
+	examined, along with their aliases, and only the ones whose value
+	differs from the current one are written. Those variables are
+	returned.
+
+	*/
+	std::vector<Variable> updateChangedVariables()
+	{
+		std::vector<Variable> changed;
+		compactChanged( m_pass.changed );
+		for( const auto& symbol : m_pass.changed )
+		{
+			// The variables of pending suggestions are updated below.
+			if( m_affine.pending &&
+				std::binary_search( m_affine.basics.begin(), m_affine.basics.end(), symbol ) )
+				continue;
+			auto index_it = m_var_indices.find( symbol );
+			if( index_it == m_var_indices.end() )
+				continue;
+			const Row* row = rowOf( symbol );
+			double basic = row ? row->constant() : 0.0;
+			for( std::size_t index = index_it->second; index != NoIndex; index = m_var_next[ index ] )
+			{
+				Variable& var = m_var_list[ index ];
+				double value = m_var_offsets[ index ] + m_var_scales[ index ] * basic;
+				m_values[ index ] = value;
+				if( var.value() != value )
+				{
+					var.setValue( value );
+					changed.push_back( var );
+				}
+			}
+		}
+		if( m_affine.pending )
+			updateAffineVariables( &changed );
+		m_pass.changed.clear();
+		return changed;
+	}
+
+	/* Get the values of the external variables, by variable index.
+
+	The values are those written by the last update of the variables.
+	Each variable is given the next index the first time a constraint
+	refers to it. A variable is dropped once no constraint refers to it,
+	and the last variable then takes its index, so the indices are dense
+	and only change when a variable is dropped.
+
+	*/
+	ArrayView<double> values() const
+	{
+		return ArrayView<double>( m_values.data(), m_values.size() );
+	}
+
+	/* Get the external variables of the solver, by variable index.
+
+	*/
+	ArrayView<Variable> variables() const
+	{
+		return ArrayView<Variable>( m_var_list.data(), m_var_list.size() );
+	}
+
+	/* Reset the solver to the empty starting condition.
+
+	This method resets the internal solver state to the empty starting
+	condition, as if no constraints or edit variables have been added.
+	This can be faster than deleting the solver and creating a new one
+	when the entire system must change, since it can avoid unecessary
+	heap (de)allocations. The checkpoints of the solver are released.
+
+	*/
+	void reset()
+	{
+		clearRows();
+		m_cns.clear();
+		m_cn_slots.clear();
+		m_free_slots.clear();
+		m_refs.clear();
+		m_free_refs.clear();
+		m_stale_cns = 0;
+		m_vars.clear();
+		m_var_indices.clear();
+		m_var_list.clear();
+		m_var_symbols.clear();
+		m_values.clear();
+		m_var_offsets.clear();
+		m_var_scales.clear();
+		m_var_next.clear();
+		m_var_refs.clear();
+		m_edits.clear();
+		m_bounds.clear();
+		m_pass.infeasible.clear();
+		m_pass.changed.clear();
+		m_pass.pivots = 0;
+		m_symbol_components.clear();
+		m_dirty.clear();
+		m_artificial.reset();
+		m_affine.variables.clear();
+		m_affine.suggestions.clear();
+		m_affine.valid = false;
+		m_affine.pending = false;
+		dropBases();
+		m_basis_hits = 0;
+		m_basis_misses = 0;
+		m_id_tick = 1;
+		m_removed = 0;
+		m_checkpoints.clear();
+		m_component_saves.clear();
+		m_undo.clear();
+	}
+
+	/* Get the number of simplex pivots performed since the solver was
+	created or last reset.
+
+	*/
+	std::size_t pivotCount() const
+	{
+		return m_pass.pivots;
+	}
+
+	/* Get the number of independent components of the tableau.
+
+	Components are merged as soon as a constraint ties them together,
+	but only split again once enough constraints have been removed, so
+	the count may be lower than the actual number of independent parts.
+
+	*/
+	std::size_t componentCount() const
+	{
+		std::size_t count = 0;
+		for( std::size_t i = 0, n = m_components.size(); i < n; ++i )
+		{
+			if( m_components[ i ].parent == i )
+				++count;
+		}
+		return count;
+	}
+
+	/* Set the thread pool used to optimize independent components
+	concurrently, or null to optimize them on the calling thread.
+
+	The pool must outlive the solver, or be replaced before it is
+	destroyed. The memory resource of the solver must be thread safe,
+	as the default one is, since the tasks allocate rows from it.
+
+	*/
+	void setThreadPool( ThreadPool* pool )
+	{
+		m_pool = pool;
+	}
+
+	/* Get the thread pool of the solver, or null if it has none.
+
+	*/
+	ThreadPool* threadPool() const
+	{
+		return m_pool;
+	}
+
+	/* Set the number of rows from which a pivot substitutes the entering
+	symbol into the rows of its column on the thread pool, or 0 to never
+	do so, which is the default.
+
+	*/
+	void setSubstituteThreshold( std::size_t rows )
+	{
+		m_substitute_threshold = rows;
+	}
+
+	/* Get the number of rows from which substitutions run on the thread
+	pool, or 0 if they never do.
+
+	*/
+	std::size_t substituteThreshold() const
+	{
+		return m_substitute_threshold;
+	}
+
+	SolverImpl& operator=( const SolverImpl& ) = delete;
+
+	/* Move a solver into this one, whose constraints are dropped.
+
+	The solver takes the memory resource of the other one.
+
+	*/
+	SolverImpl& operator=( SolverImpl&& other ) noexcept
+	{
+		if( this != &other )
+		{
+			// The containers can only be moved between solvers using the
+			// same resource, so this one is rebuilt from the other.
+			this->~SolverImpl();
+			new( this ) SolverImpl( std::move( other ) );
+		}
+		return *this;
+	}
+
+	/* Get the memory resource used by the solver.
+
+	*/
+	MemoryResource* resource() const
+	{
+		return m_resource;
+	}
+
+private:
+	/* Add the row of a constraint to the tableau, without optimizing,
+	and return the handle of the constraint.
+
+	Throws
+	------
+	DuplicateConstraint
+		The given constraint has already been added to the solver.
+
+	UnsatisfiableConstraint
+		The given constraint is required and cannot be satisfied.
+
+	*/
+	ConstraintHandle addConstraintRow( const Constraint& constraint )
+	{
+		ConstraintHandle handle;
+		switch( insertConstraint( constraint, handle ) )
+		{
+			case STATUS_DUPLICATE_CONSTRAINT:
+				throw DuplicateConstraint( constraint );
+			case STATUS_UNSATISFIABLE_CONSTRAINT:
+				throw UnsatisfiableConstraint( constraint );
+			default:
+				break;
+		}
+		return handle;
+	}
+
+	/* Add the row of a constraint to the tableau, without optimizing, and
+	return why it cannot be added instead of throwing.
+
+	The handle of the constraint is written to the given one once it is
+	added.
+
+	*/
+	Status insertConstraint( const Constraint& constraint, ConstraintHandle& handle )
+	{
+		if( findSlot( constraint ) != NoIndex )
+			return STATUS_DUPLICATE_CONSTRAINT;
+
+		// A required bound on a variable new to the solver, or a required
+		// equality tying such a variable to another one, needs no row.
+		Tag tag;
+		if( addNativeBound( constraint, tag ) || addAlias( constraint, tag ) )
+		{
+			handle = takeSlot( constraint, tag );
+			addReferences( constraint, handle.slot() );
+			return STATUS_OK;
+		}
+
+		// Creating a row causes symbols to be reserved for the variables
+		// in the constraint. If the constraint cannot be added, then its
+		// possible those variables will linger in the var map. Since its
+		// likely that those variables will be used in other constraints
+		// and since failures are uncommon, i'm not too worried about
+		// aggressive cleanup of the var map. `tryAddConstraint` finds
+		// out beforehand whether the constraint may fail, see
+		// `probeConstraint`, and `removeVariables` drops such variables.
+		RowPtr rowptr( createRow( constraint, tag ) );
+		Symbol subject( chooseSubject( *rowptr, tag ) );
+
+		// If chooseSubject could not find a valid entering symbol, one
+		// last option is available if the entire row is composed of
+		// dummy variables. If the constant of the row is zero, then
+		// this represents redundant constraints and the new dummy
+		// marker can enter the basis. If the constant is non-zero,
+		// then it represents an unsatisfiable constraint.
+		if( subject.type() == Symbol::Invalid && allDummies( *rowptr ) )
+		{
+			if( !nearZero( rowptr->constant() ) )
+				return STATUS_UNSATISFIABLE_CONSTRAINT;
+			else
+				subject = tag.marker;
+		}
+
+		// If an entering symbol still isn't found, then the row must
+		// be added using an artificial variable. If that fails, then
+		// the row represents an unsatisfiable constraint.
+		if( subject.type() == Symbol::Invalid )
+		{
+			if( !addWithArtificialVariable( *rowptr ) )
+				return STATUS_UNSATISFIABLE_CONSTRAINT;
+		}
+		else
+		{
+			rowptr->solveFor( subject );
+			substitute( subject, *rowptr, m_pass );
+			insertRow( subject, rowptr.release(), m_pass );
+		}
+
+		markDirty( tag.marker );
+		handle = takeSlot( constraint, tag );
+		addReferences( constraint, handle.slot() );
+		return STATUS_OK;
+	}
+
+	/* Find out how `insertConstraint` would add a constraint new to the
+	solver, building its row into the given empty row.
+
+	Only a required constraint whose row keeps no external symbol once
+	the basic symbols are substituted can fail: right away if the row is
+	a nonzero constant over dummy symbols, or once the artificial variable
+	it needs cannot leave the basis. The new variables and the marker are
+	given the symbols they would get, without taking them.
+
+	*/
+	RowEntry probeConstraint( const Constraint& constraint, Row& row )
+	{
+		const Term* alias;
+		const Term* target;
+		if( constraint.strength() < strength::required || isNativeBound( constraint ) ||
+			findAlias( constraint, alias, target ) )
+			return EntersDirectly;
+
+		const Expression& expr( constraint.expression() );
+		VariableList fresh( resource() );
+		for( const auto& term : expr.terms() )
+		{
+			if( !nearZero( term.coefficient() ) && m_vars.find( term.variable() ) == m_vars.end() )
+				fresh.push_back( term.variable() );
+		}
+		std::sort( fresh.begin(), fresh.end() );
+		fresh.erase( std::unique( fresh.begin(), fresh.end(), []( const Variable& a, const Variable& b )
+		{
+			return !( a < b ) && !( b < a );
+		} ), fresh.end() );
+
+		row.add( expr.constant() );
+		for( const auto& term : expr.terms() )
+		{
+			if( nearZero( term.coefficient() ) )
+				continue;
+			auto var_it = m_vars.find( term.variable() );
+			if( var_it != m_vars.end() )
+				insertVariable( row, var_it->second, term.coefficient() );
+			else
+			{
+				auto index = std::lower_bound( fresh.begin(), fresh.end(), term.variable() ) - fresh.begin();
+				row.insert( Symbol( Symbol::External, m_id_tick + index ), term.coefficient() );
+			}
+		}
+
+		Tag tag;
+		Symbol::Id id = m_id_tick + fresh.size();
+		if( constraint.op() == OP_EQ )
+		{
+			tag.marker = Symbol( Symbol::Dummy, id );
+			row.insert( tag.marker );
+		}
+		else
+		{
+			tag.marker = Symbol( Symbol::Slack, id );
+			row.insert( tag.marker, constraint.op() == OP_LE ? 1.0 : -1.0 );
+		}
+		if( row.constant() < 0.0 )
+			row.reverseSign();
+		if( chooseSubject( row, tag ).type() != Symbol::Invalid )
+			return EntersDirectly;
+		if( allDummies( row ) )
+			return nearZero( row.constant() ) ? EntersDirectly : CannotEnter;
+		return NeedsArtificial;
+	}
+
+	/* Add a constraint needing an artificial variable, given its row built
+	by `probeConstraint`, and restore the solver if it cannot be added.
+	The handle of the constraint is written to the given one once it is
+	added.
+
+	The row has no new variable, which would be an external symbol. The
+	components it joins are copied first, sharing their rows, and while
+	the constraint is added the components given to the symbols are
+	logged instead of compressed. Putting back the copies and the logged
+	components then undoes the attempt.
+
+	*/
+	bool addTrialConstraint( const Constraint& constraint, const Row& row, ConstraintHandle& handle )
+	{
+		IndexList roots( resource() );
+		for( const auto& symbol : row.symbols() )
+		{
+			std::size_t component = findComponent( symbol );
+			if( component != NoIndex )
+				roots.push_back( component );
+		}
+		std::sort( roots.begin(), roots.end() );
+		roots.erase( std::unique( roots.begin(), roots.end() ), roots.end() );
+		ComponentList saved( resource() );
+		saved.reserve( roots.size() );
+		for( std::size_t component : roots )
+			shareComponent( m_components[ component ], saved );
+
+		std::size_t components = m_components.size();
+		std::size_t infeasible = m_pass.infeasible.size();
+		std::size_t dirty = m_dirty.size();
+		Symbol::Id tick = m_id_tick;
+		auto restore = [&]()
+		{
+			while( m_components.size() > components )
+			{
+				releaseRows( m_components.back() );
+				m_components.pop_back();
+			}
+			for( std::size_t i = 0, n = roots.size(); i < n; ++i )
+			{
+				releaseRows( m_components[ roots[ i ] ] );
+				m_components[ roots[ i ] ] = std::move( saved[ i ] );
+				saved[ i ].rows.clear();
+			}
+			for( auto it = m_trial_log.rbegin(); it != m_trial_log.rend(); ++it )
+			{
+				if( it->first == NoIndex )
+					m_symbol_components.erase( it->second );
+				else
+					m_symbol_components[ it->second ] = it->first;
+			}
+			m_id_tick = tick;
+			if( m_pass.infeasible.size() > infeasible )
+				m_pass.infeasible.resize( infeasible );
+			if( m_dirty.size() > dirty )
+				m_dirty.resize( dirty );
+		};
+
+		Status status;
+		m_trial_log.clear();
+		m_trial = true;
+		try
+		{
+			status = insertConstraint( constraint, handle );
+		}
+		catch( ... )
+		{
+			m_trial = false;
+			restore();
+			throw;
+		}
+		m_trial = false;
+		if( status != STATUS_OK )
+			restore();
+		for( auto& component : saved )
+			releaseRows( component );
+		return status == STATUS_OK;
+	}
+
+	/* Remove the row of a constraint from the tableau, without optimizing.
+
+	*/
+	void removeConstraintRow( const Constraint& constraint )
+	{
+		std::size_t slot = findSlot( constraint );
+		if( slot == NoIndex )
+			throw UnknownConstraint( constraint );
+		removeSlotRow( slot );
+	}
+
+	/* Remove the row of the constraint a handle refers to from the
+	tableau, without optimizing.
+
+	*/
+	void removeConstraintRow( const ConstraintHandle& handle )
+	{
+		std::size_t slot = findSlot( handle );
+		if( slot == NoIndex )
+			throw UnknownConstraintHandle( handle );
+		removeSlotRow( slot );
+	}
+
+	/* Remove the row of the constraint in a slot from the tableau, and
+	free the slot.
+
+	*/
+	void removeSlotRow( std::size_t slot )
+	{
+		Constraint constraint( m_cn_slots[ slot ].constraint );
+		Tag tag( m_cn_slots[ slot ].tag );
+		releaseSlot( slot );
+
+		// Remove the error effects from the objective function
+		// *before* pivoting, or substitutions into the objective
+		// will lead to incorrect solver results.
+		removeConstraintEffects( constraint, tag );
+
+		// A native bound or an alias is first turned into the row of an
+		// ordinary constraint, whose marker is removed as any other.
+		if( tag.marker.type() == Symbol::Bound ||
+			( tag.marker.type() == Symbol::Dummy &&
+			  m_var_indices.find( tag.marker ) != m_var_indices.end() ) )
+			releaseVariable( tag.marker );
+		markDirty( tag.marker );
+		++m_removed;
+
+		// If the marker is basic, simply drop the row. Otherwise,
+		// pivot the marker into the basis and then drop the row.
+		if( rowOf( tag.marker ) )
+		{
+			RowPtr rowptr( eraseRow( tag.marker, m_pass ), rowDeleter() );
+		}
+		else
+		{
+			Symbol leaving( getMarkerLeavingRow( tag.marker ) );
+			if( leaving.type() == Symbol::Invalid )
+				throw InternalSolverError( "failed to find leaving row" );
+			RowPtr rowptr( eraseRow( leaving, m_pass ), rowDeleter() );
+			if( isShared( *rowptr ) )
+				rowptr = makeRow( *rowptr );
+			rowptr->solveFor( leaving, tag.marker );
+			substitute( tag.marker, *rowptr, m_pass );
+		}
+		dropReferences( constraint, slot );
+	}
+
+	/* Find the slot of a constraint of the solver.
+
+	NoIndex is returned if the constraint is not in the solver.
+
+	*/
+	std::size_t findSlot( const Constraint& constraint ) const
+	{
+		auto cn_it = m_cns.find( constraint );
+		if( cn_it == m_cns.end() || cn_it->second >= m_cn_slots.size() ||
+			m_cn_slots[ cn_it->second ].constraint != constraint )
+			return NoIndex;
+		return cn_it->second;
+	}
+
+	/* Find the slot a handle refers to.
+
+	NoIndex is returned if the constraint of the handle was removed, the
+	slot then being free or given to a later constraint with another
+	generation.
+
+	*/
+	std::size_t findSlot( const ConstraintHandle& handle ) const
+	{
+		if( !handle || handle.slot() >= m_cn_slots.size() ||
+			m_cn_slots[ handle.slot() ].generation != handle.generation() )
+			return NoIndex;
+		return handle.slot();
+	}
+
+	/* Give a slot to a constraint new to the solver and return its handle.
+
+	The generation of the slot is never given again by the solver, not
+	even after a rollback, so the handles of the removed constraints
+	never refer to a later one. An entry left in the map of constraints
+	by a previous removal of the constraint is reused.
+
+	*/
+	ConstraintHandle takeSlot( const Constraint& constraint, const Tag& tag )
+	{
+		std::size_t slot;
+		if( m_free_slots.empty() )
+		{
+			slot = m_cn_slots.size();
+			saveElement( m_undo.cn_slots, m_cn_slots, slot );
+			m_cn_slots.push_back( CnSlot{ constraint, tag, 0, NoIndex } );
+		}
+		else
+		{
+			slot = m_free_slots.back();
+			saveElement( m_undo.free_slots, m_free_slots, m_free_slots.size() - 1 );
+			m_free_slots.pop_back();
+			saveElement( m_undo.cn_slots, m_cn_slots, slot );
+			m_cn_slots[ slot ].constraint = constraint;
+			m_cn_slots[ slot ].tag = tag;
+		}
+		m_cn_slots[ slot ].generation = ++m_cn_tick;
+		saveEntry( m_undo.cns, m_cns, constraint );
+		auto inserted = m_cns.insert( std::make_pair( constraint, slot ) );
+		if( !inserted.second )
+		{
+			inserted.first->second = slot;
+			--m_stale_cns;
+		}
+		return ConstraintHandle( slot, m_cn_tick );
+	}
+
+	/* Free the slot of a constraint removed from the solver.
+
+	The entry of the constraint is left in the map of constraints, as
+	erasing it would move all the following entries of a sorted map.
+	The map is compacted once such entries outnumber the constraints,
+	so that a removal costs constant amortized time once the slot is
+	found. It is not compacted while the solver holds a checkpoint, so
+	that a rollback only undoes the entries changed since.
+
+	*/
+	void releaseSlot( std::size_t slot )
+	{
+		saveElement( m_undo.cn_slots, m_cn_slots, slot );
+		m_cn_slots[ slot ].constraint = Constraint();
+		m_cn_slots[ slot ].generation = 0;
+		saveElement( m_undo.free_slots, m_free_slots, m_free_slots.size() );
+		m_free_slots.push_back( slot );
+		++m_stale_cns;
+		if( m_checkpoints.empty() && m_stale_cns > m_cns.size() - m_stale_cns + CompactThreshold )
+			compactConstraints();
+	}
+
+	/* Drop the entries of the removed constraints from the map of
+	constraints.
+
+	*/
+	void compactConstraints()
+	{
+		CnMap cns( resource() );
+		for( const auto& cnPair : m_cns )
+		{
+			if( cnPair.second < m_cn_slots.size() && m_cn_slots[ cnPair.second ].constraint == cnPair.first )
+				cns.insert( cnPair );
+		}
+		m_cns.swap( cns );
+		m_stale_cns = 0;
+	}
+
+	/* Test whether a constraint is a native bound, see `addNativeBound`.
+
+	*/
+	bool isNativeBound( const Constraint& constraint ) const
+	{
+		if( constraint.op() == OP_EQ || constraint.strength() < strength::required )
+			return false;
+		const Expression& expr( constraint.expression() );
+		if( expr.terms().size() != 1 )
+			return false;
+		const Term& term( expr.terms().front() );
+		return !nearZero( term.coefficient() ) && m_vars.find( term.variable() ) == m_vars.end();
+	}
+
+	/* Find the terms of the alias and of its target if a constraint is an
+	alias, see `addAlias`.
+
+	*/
+	bool findAlias( const Constraint& constraint, const Term*& alias, const Term*& target ) const
+	{
+		if( constraint.op() != OP_EQ || constraint.strength() < strength::required )
+			return false;
+		const Expression& expr( constraint.expression() );
+		if( expr.terms().size() != 2 )
+			return false;
+		alias = &expr.terms()[ 0 ];
+		target = &expr.terms()[ 1 ];
+		if( nearZero( alias->coefficient() ) || nearZero( target->coefficient() ) )
+			return false;
+		if( !( alias->variable() < target->variable() ) && !( target->variable() < alias->variable() ) )
+			return false;
+		if( m_vars.find( alias->variable() ) != m_vars.end() )
+			std::swap( alias, target );
+		if( m_vars.find( alias->variable() ) != m_vars.end() )
+			return false;
+		auto var_it = m_vars.find( target->variable() );
+		return var_it == m_vars.end() || var_it->second.type() != Symbol::Dummy;
+	}
+
+	/* Add a constraint as a native bound if possible.
+
+	A required inequality on a single variable which no constraint refers
+	to yet is a bound of the variable. Instead of adding a row and a slack
+	for it, the variable is written `bound + symbol` for a lower bound, or
+	`bound - symbol` for an upper bound, where the symbol is a restricted
+	Bound symbol. The ratio tests then keep the variable within its bound
+	as they keep any restricted symbol non-negative, and the variable has
+	no row until it is basic.
+
+	Returns false, without modifying the solver, if the constraint is not
+	such a bound.
+
+	*/
+	bool addNativeBound( const Constraint& constraint, Tag& tag )
+	{
+		if( !isNativeBound( constraint ) )
+			return false;
+		const Expression& expr( constraint.expression() );
+		const Term& term( expr.terms().front() );
+		// coeff * x + constant >= 0 bounds x from below when coeff > 0.
+		bool lower = ( constraint.op() == OP_GE ) == ( term.coefficient() > 0.0 );
+		double bound = -expr.constant() / term.coefficient();
+		tag.marker = Symbol( Symbol::Bound, m_id_tick++ );
+		addVariable( term.variable(), tag.marker, bound, lower ? 1.0 : -1.0 );
+		return true;
+	}
+
+	/* Add a constraint as the alias of a variable if possible.
+
+	A required equality `a * x + b * y + c == 0`, where x is new to the
+	solver, makes x the affine function `-c / a - b / a * y` of y. Instead
+	of adding a row and a dummy for it, x is given no symbol of its own:
+	its value is read from the symbol of y, and each row referring to x
+	gets that function plus the dummy marker of the equality, which is
+	zero but lets the equality be removed as if it had a row.
+
+	The aliases form a union-find of depth one. y must own its symbol,
+	as an External or Bound symbol, and every alias of a symbol is linked
+	after its owner in `m_var_next`. Aliasing an alias is not attempted,
+	since removing the first equality would leave the dummy of the first
+	alias in the function of the second.
+
+	Returns false, without modifying the solver, if the constraint is not
+	such an equality.
+
+	*/
+	bool addAlias( const Constraint& constraint, Tag& tag )
+	{
+		const Term* alias;
+		const Term* target;
+		if( !findAlias( constraint, alias, target ) )
+			return false;
+		const Expression& expr( constraint.expression() );
+		Symbol symbol( getVarSymbol( target->variable() ) );
+		std::size_t owner = m_var_indices.find( symbol )->second;
+		double ratio = -target->coefficient() / alias->coefficient();
+		double offset = -expr.constant() / alias->coefficient() + ratio * m_var_offsets[ owner ];
+		std::size_t index = m_var_list.size();
+		tag.marker = Symbol( Symbol::Dummy, m_id_tick++ );
+		addVariable( alias->variable(), tag.marker, offset, ratio * m_var_scales[ owner ] );
+		m_var_symbols[ index ] = symbol;
+		m_var_next[ index ] = m_var_next[ owner ];
+		saveVariable( owner );
+		m_var_next[ owner ] = index;
+		markChanged( symbol, m_pass );
+		return true;
+	}
+
+	/* Give a variable with a native bound or an alias an external symbol.
+
+	The new symbol gets the row the variable is substituted with, which
+	is the row an ordinary constraint would have: `bound +/- marker` for
+	a bound, the marker being its slack, and the affine function of the
+	other variable plus the dummy marker for an alias.
+
+	The aliases of a released bound variable are rewritten in terms of
+	the new symbol, and a released alias is unlinked from its owner.
+
+	*/
+	void releaseVariable( const Symbol& marker )
+	{
+		std::size_t index = m_var_indices.find( marker )->second;
+		Symbol symbol( Symbol::External, m_id_tick++ );
+		RowPtr rowptr( makeRow( resource() ) );
+		insertVariable( *rowptr, marker, 1.0 );
+		joinComponents( symbol, *rowptr );
+		insertRow( symbol, rowptr.release(), m_pass );
+		saveVariable( index );
+		if( marker.type() == Symbol::Dummy )
+		{
+			std::size_t previous = m_var_indices.find( m_var_symbols[ index ] )->second;
+			while( m_var_next[ previous ] != index )
+				previous = m_var_next[ previous ];
+			saveVariable( previous );
+			m_var_next[ previous ] = m_var_next[ index ];
+			m_var_next[ index ] = NoIndex;
+		}
+		else
+		{
+			// marker == ( symbol - offset ) / scale for the bound variable.
+			for( std::size_t alias = m_var_next[ index ]; alias != NoIndex; alias = m_var_next[ alias ] )
+			{
+				saveVariable( alias );
+				m_var_scales[ alias ] /= m_var_scales[ index ];
+				m_var_offsets[ alias ] -= m_var_scales[ alias ] * m_var_offsets[ index ];
+				m_var_symbols[ alias ] = symbol;
+			}
+		}
+		saveEntry( m_undo.var_indices, m_var_indices, marker );
+		m_var_indices.erase( marker );
+		saveEntry( m_undo.var_indices, m_var_indices, symbol );
+		m_var_indices.insert( std::make_pair( symbol, index ) );
+		saveEntry( m_undo.vars, m_vars, m_var_list[ index ] );
+		m_vars[ m_var_list[ index ] ] = symbol;
+		m_var_symbols[ index ] = symbol;
+		m_var_offsets[ index ] = 0.0;
+		m_var_scales[ index ] = 1.0;
+	}
+
+	/* Move a native bound to a new value, without optimizing.
+
+	Changing the bound shifts the Bound symbol by a constant, which is
+	pushed into the tableau as the change of an edit variable is, and
+	into the offsets of the aliases of the variable. The rows made
+	infeasible are recorded for the next dual optimization.
+
+	*/
+	void shiftBound( const Symbol& marker, double bound )
+	{
+		std::size_t index = m_var_indices.find( marker )->second;
+		double delta = m_var_scales[ index ] * ( bound - m_var_offsets[ index ] );
+		saveVariable( index );
+		m_var_offsets[ index ] = bound;
+		for( std::size_t alias = m_var_next[ index ]; alias != NoIndex; alias = m_var_next[ alias ] )
+		{
+			saveVariable( alias );
+			m_var_offsets[ alias ] += m_var_scales[ alias ] * delta;
+		}
+		markChanged( marker, m_pass );
+
+		if( Row* row = rowOf( marker ) )
+		{
+			if( ownRow( marker, row )->add( -delta ) < 0.0 )
+				m_pass.infeasible.push_back( marker );
+			return;
+		}
+
+		const RowMap* column = columnOf( marker );
+		if( !column )
+			return;
+		for( const auto& rowPair : *column )
+		{
+			double coeff = rowPair.second->coefficientFor( marker );
+			if( coeff != 0.0 )
+				markChanged( rowPair.first, m_pass );
+			if( coeff != 0.0 &&
+				ownRow( rowPair.first, rowPair.second )->add( delta * coeff ) < 0.0 &&
+				rowPair.first.type() != Symbol::External )
+				m_pass.infeasible.push_back( rowPair.first );
+		}
+	}
+
+	/* Remove a bound set by `setBounds`, without optimizing, unless it
+	is a native bound which can be moved to the given finite value.
+
+	Returns true if the bound was removed.
+
+	*/
+	bool dropBound( Constraint& bound, double value )
+	{
+		if( !bound )
+			return false;
+		if( std::isfinite( value ) && m_cn_slots[ findSlot( bound ) ].tag.marker.type() == Symbol::Bound )
+			return false;
+		removeConstraintRow( bound );
+		bound = Constraint();
+		return true;
+	}
+
+	/* Move a native bound set by `setBounds` to a new value.
+
+	The objective must be optimal. If the dual simplex finds that the
+	new bound cannot be satisfied, the bound is moved back before the
+	exception propagates.
+
+	*/
+	void moveBound( Constraint& bound, const Variable& variable, RelationalOperator op, double value )
+	{
+		Constraint cn( boundConstraint( variable, op, value ) );
+		std::size_t slot = findSlot( bound );
+		Tag tag( m_cn_slots[ slot ].tag );
+		double previous = m_var_offsets[ m_var_indices.find( tag.marker )->second ];
+		shiftBound( tag.marker, value );
+		try
+		{
+			dualOptimize();
+		}
+		catch( const InternalSolverError& )
+		{
+			// The dual simplex keeps the objective optimal, so it can
+			// make the rows feasible again for the previous bound.
+			shiftBound( tag.marker, previous );
+			for( const auto& component : m_components )
+			{
+				for( const auto& rowPair : component.rows )
+				{
+					if( rowPair.first.type() != Symbol::External &&
+						rowPair.second->constant() < 0.0 )
+						m_pass.infeasible.push_back( rowPair.first );
+				}
+			}
+			dualOptimize();
+			throw UnsatisfiableConstraint( cn );
+		}
+		releaseSlot( slot );
+		takeSlot( cn, tag );
+		bound = cn;
+	}
+
+	/* Add a bound for `setBounds`, without optimizing.
+
+	*/
+	void addBound( Constraint& bound, const Variable& variable, RelationalOperator op, double value )
+	{
+		Constraint cn( boundConstraint( variable, op, value ) );
+		addConstraintRow( cn );
+		bound = cn;
+	}
+
+	/* Create the required constraint bounding a variable.
+
+	*/
+	static Constraint boundConstraint( const Variable& variable, RelationalOperator op, double value )
+	{
+		return Constraint( Expression( Term( variable ), -value ), op, strength::required );
+	}
+
+	/* Push the change of the suggested value of an edit variable, given
+	along with its entry, into the tableau, without optimizing.
+
+	The rows made infeasible by the change are recorded for the next
+	dual optimization.
+
+	*/
+	void applySuggestion( const Variable& variable, EditInfo& info, double value )
+	{
+		saveEntry( m_undo.edits, m_edits, variable );
+		double delta = value - info.constant;
+		info.constant = value;
+
+		// Check first if the positive error variable is basic.
+		if( Row* row = rowOf( info.tag.marker ) )
+		{
+			if( ownRow( info.tag.marker, row )->add( -delta ) < 0.0 )
+				m_pass.infeasible.push_back( info.tag.marker );
+			return;
+		}
+
+		// Check next if the negative error variable is basic.
+		if( Row* row = rowOf( info.tag.other ) )
+		{
+			if( ownRow( info.tag.other, row )->add( delta ) < 0.0 )
+				m_pass.infeasible.push_back( info.tag.other );
+			return;
+		}
+
+		// Otherwise update each row where the error variables exist.
+		const RowMap* column = columnOf( info.tag.marker );
+		if( !column )
+			return;
+		for (const auto & rowPair : *column)
+		{
+			double coeff = rowPair.second->coefficientFor( info.tag.marker );
+			if( coeff != 0.0 )
+				markChanged( rowPair.first, m_pass );
+			if( coeff != 0.0 &&
+				ownRow( rowPair.first, rowPair.second )->add( delta * coeff ) < 0.0 &&
+				rowPair.first.type() != Symbol::External )
+				m_pass.infeasible.push_back( rowPair.first );
+		}
+	}
+
+	/* Copy a range of edit variables into a list, dropping duplicates.
+
+	*/
+	template<typename InputIterator>
+	void collectEdits( InputIterator first, InputIterator last, VariableList& variables ) const
+	{
+		for( ; first != last; ++first )
+		{
+			if( m_edits.find( *first ) == m_edits.end() )
+				throw UnknownEditVariable( *first );
+			if( findVariable( variables, *first ) == NoIndex )
+				variables.push_back( *first );
+		}
+	}
+
+	static std::size_t findVariable( const VariableList& variables, const Variable& variable )
+	{
+		for( std::size_t i = 0, n = variables.size(); i < n; ++i )
+		{
+			if( !( variables[ i ] < variable ) && !( variable < variables[ i ] ) )
+				return i;
+		}
+		return NoIndex;
+	}
+
+	/* Record the suggested value of an edit variable answered from the
+	sensitivity of the basis, building it if needed.
+
+	Returns false if the variable is not one of the affine edits.
+
+	*/
+	bool setAffineValue( const Variable& variable, double value )
+	{
+		std::size_t index = findVariable( m_affine.variables, variable );
+		if( index == NoIndex )
+			return false;
+		if( !m_affine.valid )
+		{
+			buildSensitivity( m_affine, m_basis_capacity != 0 ? &m_reach : nullptr );
+			cacheBasis();
+		}
+		m_affine.suggestions.push_back( std::make_pair( index, value ) );
+		return true;
+	}
+
+	/* Push the accepted values, then the recorded suggestions, into the
+	tableau, without optimizing, and drop the sensitivity as the tableau
+	is about to change.
+
+	Unless they come from a cached basis, the accepted values keep every
+	row feasible, so the rows made infeasible are those of the recorded
+	suggestions, as if all of them had been applied to the tableau when
+	suggested.
+
+	*/
+	void applyAffine()
+	{
+		if( !m_affine.valid )
+			return;
+		m_affine.valid = false;
+		if( m_affine.pending )
+		{
+			m_affine.pending = false;
+			for( std::size_t i = 0, n = m_affine.variables.size(); i < n; ++i )
+				applySuggestion( m_affine.variables[ i ], m_edits.find( m_affine.variables[ i ] )->second, m_affine.values[ i ] );
+			// The values written from a cached basis may be those of
+			// another optimum than the one the tableau is about to reach.
+			m_pass.changed.insert( m_pass.changed.end(), m_affine.basics.begin(), m_affine.basics.end() );
+		}
+		for( const auto& suggestion : m_affine.suggestions )
+		{
+			const Variable& variable( m_affine.variables[ suggestion.first ] );
+			applySuggestion( variable, m_edits.find( variable )->second, suggestion.second );
+		}
+		m_affine.suggestions.clear();
+	}
+
+	/* Push the recorded suggestions into the tableau before changing it.
+
+	Within the feasible region no row becomes infeasible, but rounding
+	may still require a pivot of the dual simplex method.
+
+	*/
+	void syncAffine()
+	{
+		if( m_bases.empty() )
+		{
+			applyAffine();
+			dualOptimize();
+			return;
+		}
+
+		// The variables moved by the pivots may differ between the bases
+		// met so far, so they are added to the reach of the cache.
+		m_moved.clear();
+		m_moved.swap( m_pass.changed );
+		applyAffine();
+		dualOptimize();
+		m_moved.swap( m_pass.changed );
+		compactChanged( m_moved );
+		if( !std::includes( m_reach.begin(), m_reach.end(), m_moved.begin(), m_moved.end() ) )
+		{
+			std::size_t size = m_reach.size();
+			m_reach.insert( m_reach.end(), m_moved.begin(), m_moved.end() );
+			std::inplace_merge( m_reach.begin(), m_reach.begin() + size, m_reach.end() );
+			m_reach.erase( std::unique( m_reach.begin(), m_reach.end() ), m_reach.end() );
+		}
+		m_pass.changed.insert( m_pass.changed.end(), m_moved.begin(), m_moved.end() );
+	}
+
+	/* Push the recorded suggestions into the tableau and drop the cached
+	bases, before any change to the tableau other than a suggestion of
+	the affine edits.
+
+	*/
+	void prepareChange()
+	{
+		syncAffine();
+		dropBases();
+	}
+
+	/* Keep the recorded suggestions if the basis is feasible for them, or
+	push them into the tableau and re-optimize it.
+
+	*/
+	void settleAffine()
+	{
+		if( m_affine.valid )
+		{
+			m_affine.candidate.assign( m_affine.values.begin(), m_affine.values.end() );
+			for( const auto& suggestion : m_affine.suggestions )
+				m_affine.candidate[ suggestion.first ] = suggestion.second;
+			if( m_affine.sensitivity.contains( m_affine.candidate.data() ) )
+			{
+				m_affine.pending = m_affine.pending || !m_affine.suggestions.empty();
+				m_affine.values.swap( m_affine.candidate );
+				m_affine.suggestions.clear();
+				return;
+			}
+			if( m_basis_capacity != 0 && loadBasis() )
+			{
+				m_affine.pending = true;
+				m_affine.values.swap( m_affine.candidate );
+				m_affine.suggestions.clear();
+				return;
+			}
+		}
+		syncAffine();
+	}
+
+	/* Replace the sensitivity of the affine edits by the one of the most
+	recently used cached basis feasible for the candidate values.
+
+	The values of the variables out of the sensitivity of the basis must
+	not have changed since it was cached. They did not if it covers the
+	current reach of the cache, as only the variables of the reach moved
+	since the cache was last emptied.
+
+	*/
+	bool loadBasis()
+	{
+		CachedBasis* found = nullptr;
+		for( auto& basis : m_bases )
+		{
+			if( ( !found || basis.used > found->used ) &&
+				basis.sensitivity.contains( m_affine.candidate.data() ) &&
+				std::includes( basis.basics.begin(), basis.basics.end(), m_reach.begin(), m_reach.end() ) )
+				found = &basis;
+		}
+		if( !found )
+		{
+			++m_basis_misses;
+			return false;
+		}
+		++m_basis_hits;
+		found->used = ++m_basis_tick;
+		m_affine.sensitivity = found->sensitivity;
+		m_affine.indices.assign( found->indices.begin(), found->indices.end() );
+		m_affine.basics.assign( found->basics.begin(), found->basics.end() );
+		m_reach.assign( found->basics.begin(), found->basics.end() );
+		return true;
+	}
+
+	/* Add the sensitivity of the affine edits just built to the cache,
+	replacing the basis with the same key or the least recently used one
+	if the cache is full.
+
+	*/
+	void cacheBasis()
+	{
+		if( m_basis_capacity == 0 )
+			return;
+		m_reach_scratch.clear();
+		for( const auto& cell : m_edit_cells )
+		{
+			if( m_reach_scratch.empty() || !( m_reach_scratch.back() == cell.basic ) )
+				m_reach_scratch.push_back( cell.basic );
+		}
+		CachedBasis* target = nullptr;
+		for( auto& basis : m_bases )
+		{
+			if( basis.key == m_reach_scratch )
+			{
+				target = &basis;
+				break;
+			}
+			if( !target || basis.used < target->used )
+				target = &basis;
+		}
+		if( !target || ( target->key != m_reach_scratch && m_bases.size() < m_basis_capacity ) )
+		{
+			m_bases.emplace_back( resource() );
+			target = &m_bases.back();
+		}
+		target->sensitivity = m_affine.sensitivity;
+		target->indices.assign( m_affine.indices.begin(), m_affine.indices.end() );
+		target->basics.assign( m_affine.basics.begin(), m_affine.basics.end() );
+		target->key.swap( m_reach_scratch );
+		target->used = ++m_basis_tick;
+		m_reach.assign( m_affine.basics.begin(), m_affine.basics.end() );
+	}
+
+	/* Empty the cache of bases.
+
+	*/
+	void dropBases()
+	{
+		m_bases.clear();
+		m_reach.clear();
+	}
+
+	/* Build the sensitivity of the variables to some edit variables.
+
+	A suggestion moves the constant of the row of one error symbol of the
+	edit constraint, if one is basic, or of the rows of the column of the
+	marker otherwise, see `applySuggestion`. The derivatives of a basic
+	symbol are thus the coefficients of those changes, and its row must
+	keep a non-negative constant if the symbol is restricted.
+
+	The symbols of the given reach which do not depend on the edit
+	variables are added with their current value, so that the basis can
+	be cached.
+
+	*/
+	void buildSensitivity( AffineEdits& affine, const SymbolList* reach )
+	{
+		Sensitivity& sensitivity( affine.sensitivity );
+		sensitivity.clear();
+		affine.indices.clear();
+		affine.basics.clear();
+		m_edit_cells.clear();
+		for( std::size_t i = 0, n = affine.variables.size(); i < n; ++i )
+		{
+			const EditInfo& info( m_edits.find( affine.variables[ i ] )->second );
+			sensitivity.m_edits.push_back( affine.variables[ i ] );
+			sensitivity.m_edit_values.push_back( info.constant );
+			if( rowOf( info.tag.marker ) )
+				m_edit_cells.push_back( EditCell{ info.tag.marker, i, -1.0 } );
+			else if( rowOf( info.tag.other ) )
+				m_edit_cells.push_back( EditCell{ info.tag.other, i, 1.0 } );
+			else if( const RowMap* column = columnOf( info.tag.marker ) )
+			{
+				for( const auto& rowPair : *column )
+				{
+					double coeff = rowPair.second->coefficientFor( info.tag.marker );
+					if( coeff != 0.0 )
+						m_edit_cells.push_back( EditCell{ rowPair.first, i, coeff } );
+				}
+			}
+		}
+		std::sort( m_edit_cells.begin(), m_edit_cells.end(), []( const EditCell& lhs, const EditCell& rhs )
+		{
+			return lhs.basic < rhs.basic || ( lhs.basic == rhs.basic && lhs.edit < rhs.edit );
+		} );
+		for( std::size_t i = 0, n = m_edit_cells.size(); i < n; )
+		{
+			const Symbol& basic( m_edit_cells[ i ].basic );
+			std::size_t end = i + 1;
+			while( end < n && m_edit_cells[ end ].basic == basic )
+				++end;
+			double constant = rowOf( basic )->constant();
+			if( basic.type() != Symbol::External )
+			{
+				double* limit = sensitivity.addLimit( constant );
+				for( std::size_t j = i; j < end; ++j )
+					limit[ m_edit_cells[ j ].edit ] = m_edit_cells[ j ].coefficient;
+			}
+			auto index_it = m_var_indices.find( basic );
+			if( ( basic.type() == Symbol::External || basic.type() == Symbol::Bound ) &&
+				index_it != m_var_indices.end() )
+			{
+				affine.basics.push_back( basic );
+				for( std::size_t index = index_it->second; index != NoIndex; index = m_var_next[ index ] )
+				{
+					double scale = m_var_scales[ index ];
+					double* derivatives = sensitivity.addVariable(
+						m_var_list[ index ], m_var_offsets[ index ] + scale * constant );
+					for( std::size_t j = i; j < end; ++j )
+						derivatives[ m_edit_cells[ j ].edit ] = scale * m_edit_cells[ j ].coefficient;
+					affine.indices.push_back( index );
+				}
+			}
+			i = end;
+		}
+		if( reach )
+			addReach( affine, *reach );
+		affine.values.assign( sensitivity.m_edit_values.begin(), sensitivity.m_edit_values.end() );
+		affine.valid = true;
+		affine.pending = false;
+	}
+
+	/* Add the symbols of a reach missing from a sensitivity, with no
+	derivative.
+
+	*/
+	void addReach( AffineEdits& affine, const SymbolList& reach )
+	{
+		std::size_t size = affine.basics.size();
+		for( const auto& symbol : reach )
+		{
+			if( std::binary_search( affine.basics.begin(), affine.basics.begin() + size, symbol ) )
+				continue;
+			affine.basics.push_back( symbol );
+			auto index_it = m_var_indices.find( symbol );
+			if( index_it == m_var_indices.end() )
+				continue;
+			const Row* row = rowOf( symbol );
+			double constant = row ? row->constant() : 0.0;
+			for( std::size_t index = index_it->second; index != NoIndex; index = m_var_next[ index ] )
+			{
+				affine.sensitivity.addVariable(
+					m_var_list[ index ], m_var_offsets[ index ] + m_var_scales[ index ] * constant );
+				affine.indices.push_back( index );
+			}
+		}
+		std::inplace_merge( affine.basics.begin(), affine.basics.begin() + size, affine.basics.end() );
+	}
+
+	/* Compute the values of the variables from the tableau, by variable
+	index, without updating them.
+
+	*/
+	void computeValues( double* values )
+	{
+		for( std::size_t i = 0, n = m_var_list.size(); i < n; ++i )
+		{
+			const Row* row = rowOf( m_var_symbols[ i ] );
+			values[ i ] = m_var_offsets[ i ] + m_var_scales[ i ] * ( row ? row->constant() : 0.0 );
+		}
+	}
+
+	/* Find the index of a checkpoint held by the solver.
+
+	Throws
+	------
+	UnknownCheckpoint
+		The solver does not hold the given checkpoint.
+
+	*/
+	std::size_t findCheckpoint( std::size_t token ) const
+	{
+		for( std::size_t i = m_checkpoints.size(); i > 0; --i )
+		{
+			if( m_checkpoints[ i - 1 ].token == token )
+				return i - 1;
+		}
+		throw UnknownCheckpoint( token );
+	}
+
+	/* Copy the constraints, variables and tableau of another solver into
+	this new one, which must use the same memory resource.
+
+	The maps are copied as a whole so that their order, and thus the
+	pivots taken from now on, are the same in both solvers. This includes
+	the rows and columns maps of each component, so copying costs time
+	linear in the number of constraints, variables and indexed cells. The
+	rows and objectives themselves are shared with the other solver until
+	one of them changes them. The affine edits, the cache of bases and the
+	checkpoints are not copied.
+
+	*/
+	void copyFrom( const SolverImpl& other )
+	{
+		assignState( other );
+		m_cn_tick = other.m_cn_tick;
+		m_pass.pivots = other.m_pass.pivots;
+		m_pool = other.m_pool;
+		m_substitute_threshold = other.m_substitute_threshold;
+		m_components.reserve( other.m_components.size() );
+		for( const auto& component : other.m_components )
+			shareComponent( component, m_components );
+	}
+
+	/* Copy the maps, lists and counters of another solver, but not its
+	tableau, into this one, which must use the same memory resource.
+
+	*/
+	void assignState( const SolverImpl& other )
+	{
+		m_cns = other.m_cns;
+		m_cn_slots = other.m_cn_slots;
+		m_free_slots = other.m_free_slots;
+		m_refs = other.m_refs;
+		m_free_refs = other.m_free_refs;
+		m_stale_cns = other.m_stale_cns;
+		m_vars = other.m_vars;
+		m_var_indices = other.m_var_indices;
+		m_var_list = other.m_var_list;
+		m_var_symbols = other.m_var_symbols;
+		m_values = other.m_values;
+		m_var_offsets = other.m_var_offsets;
+		m_var_scales = other.m_var_scales;
+		m_var_next = other.m_var_next;
+		m_var_refs = other.m_var_refs;
+		m_edits = other.m_edits;
+		m_bounds = other.m_bounds;
+		m_pass.infeasible = other.m_pass.infeasible;
+		m_pass.changed = other.m_pass.changed;
+		m_symbol_components = other.m_symbol_components;
+		m_dirty = other.m_dirty;
+		m_id_tick = other.m_id_tick;
+		m_removed = other.m_removed;
+	}
+
+	/* Append a copy of a component to a list, sharing its rows and its
+	objective with it.
+
+	*/
+	void shareComponent( const Component& component, ComponentList& components ) const
+	{
+		Component copy{ component.parent, RowPtr( nullptr, rowDeleter() ), component.rows, component.columns };
+		if( component.objective )
+			copy.objective.reset( shareRow( component.objective.get() ) );
+		components.push_back( std::move( copy ) );
+		// The references are only taken once the list owns the rows, so
+		// that a failed copy leaves the counts untouched.
+		for( const auto& rowPair : components.back().rows )
+			shareRow( rowPair.second );
+	}
+
+	/* Copy a component into the newest checkpoint before it changes for
+	the first time since the checkpoint was taken.
+
+	The components created after the checkpoint are not copied. Within a
+	parallel pass, the components of the tasks must have been copied
+	beforehand, as the checkpoint is not thread safe.
+
+	*/
+	void saveComponent( std::size_t component )
+	{
+		if( m_checkpoints.empty() )
+			return;
+		Checkpoint& checkpoint( m_checkpoints.back() );
+		if( component >= checkpoint.components || m_component_saves[ component ] == checkpoint.token )
+			return;
+		checkpoint.indices.push_back( component );
+		try
+		{
+			shareComponent( m_components[ component ], checkpoint.saved );
+		}
+		catch( ... )
+		{
+			checkpoint.indices.pop_back();
+			throw;
+		}
+		m_component_saves[ component ] = checkpoint.token;
+	}
+
+	/* Log an entry of a map before it changes, if the solver holds a
+	checkpoint.
+
+	*/
+	template<typename Map>
+	void saveEntry( UndoList<MapUndo<Map>>& log, const Map& map, const typename Map::key_type& key )
+	{
+		if( m_checkpoints.empty() )
+			return;
+		auto it = map.find( key );
+		if( it == map.end() )
+			log.push_back( MapUndo<Map>{ key, typename Map::mapped_type(), false } );
+		else
+			log.push_back( MapUndo<Map>{ key, it->second, true } );
+	}
+
+	/* Log an element of a list before it changes, or before it is
+	appended if the index is the size of the list, if the solver holds a
+	checkpoint.
+
+	*/
+	template<typename T>
+	void saveElement( UndoList<ListUndo<T>>& log, const std::vector<T, ResourceAllocator<T>>& list, std::size_t index )
+	{
+		if( m_checkpoints.empty() )
+			return;
+		if( index < list.size() )
+			log.push_back( ListUndo<T>{ index, list[ index ], true } );
+		else
+			log.push_back( ListUndo<T>{ index, T(), false } );
+	}
+
+	/* Log the entries of a variable in the lists indexed by variable
+	before they change, if the solver holds a checkpoint.
+
+	*/
+	void saveVariable( std::size_t index )
+	{
+		if( m_checkpoints.empty() )
+			return;
+		m_undo.var_slots.push_back( ListUndo<VarSlot>{ index, VarSlot{ m_var_list[ index ], m_var_symbols[ index ],
+			m_values[ index ], m_var_offsets[ index ], m_var_scales[ index ], m_var_next[ index ], m_var_refs[ index ] }, true } );
+	}
+
+	/* Undo the changes logged since the given mark, in reverse order,
+	adding the symbols of the variables whose entries are undone to the
+	given list.
+
+	*/
+	void undoChanges( const UndoMark& mark, SymbolList& changed )
+	{
+		// As for a removal, the entries of the constraints added since are
+		// left in the map of constraints rather than erased.
+		while( m_undo.cns.size() > mark.cns )
+		{
+			const MapUndo<CnMap>& entry( m_undo.cns.back() );
+			if( entry.present )
+				m_cns[ entry.key ] = entry.value;
+			else
+				++m_stale_cns;
+			m_undo.cns.pop_back();
+		}
+		undoList( m_undo.cn_slots, mark.cn_slots, m_cn_slots );
+		undoList( m_undo.free_slots, mark.free_slots, m_free_slots );
+		undoList( m_undo.refs, mark.refs, m_refs );
+		undoList( m_undo.free_refs, mark.free_refs, m_free_refs );
+		undoMap( m_undo.vars, mark.vars, m_vars );
+		undoMap( m_undo.var_indices, mark.var_indices, m_var_indices );
+		undoMap( m_undo.edits, mark.edits, m_edits );
+		undoMap( m_undo.bounds, mark.bounds, m_bounds );
+		IndexList indices( resource() );
+		while( m_undo.var_slots.size() > mark.var_slots )
+		{
+			ListUndo<VarSlot>& entry( m_undo.var_slots.back() );
+			if( !entry.present )
+			{
+				m_var_list.pop_back();
+				m_var_symbols.pop_back();
+				m_values.pop_back();
+				m_var_offsets.pop_back();
+				m_var_scales.pop_back();
+				m_var_next.pop_back();
+				m_var_refs.pop_back();
+			}
+			else
+			{
+				const VarSlot& slot( entry.value );
+				if( entry.index == m_var_list.size() )
+				{
+					m_var_list.push_back( slot.variable );
+					m_var_symbols.push_back( slot.symbol );
+					m_values.push_back( slot.value );
+					m_var_offsets.push_back( slot.offset );
+					m_var_scales.push_back( slot.scale );
+					m_var_next.push_back( slot.next );
+					m_var_refs.push_back( slot.refs );
+				}
+				else
+				{
+					m_var_list[ entry.index ] = slot.variable;
+					m_var_symbols[ entry.index ] = slot.symbol;
+					m_values[ entry.index ] = slot.value;
+					m_var_offsets[ entry.index ] = slot.offset;
+					m_var_scales[ entry.index ] = slot.scale;
+					m_var_next[ entry.index ] = slot.next;
+					m_var_refs[ entry.index ] = slot.refs;
+				}
+				indices.push_back( entry.index );
+			}
+			m_undo.var_slots.pop_back();
+		}
+		for( std::size_t index : indices )
+		{
+			if( index < m_var_symbols.size() )
+				changed.push_back( m_var_symbols[ index ] );
+		}
+		undoMap( m_undo.symbol_components, mark.symbol_components, m_symbol_components );
+	}
+
+	template<typename Map>
+	static void undoMap( UndoList<MapUndo<Map>>& log, std::size_t mark, Map& map )
+	{
+		while( log.size() > mark )
+		{
+			MapUndo<Map>& entry( log.back() );
+			if( entry.present )
+				map[ entry.key ] = std::move( entry.value );
+			else
+				map.erase( entry.key );
+			log.pop_back();
+		}
+	}
+
+	template<typename T>
+	static void undoList( UndoList<ListUndo<T>>& log, std::size_t mark, std::vector<T, ResourceAllocator<T>>& list )
+	{
+		while( log.size() > mark )
+		{
+			ListUndo<T>& entry( log.back() );
+			if( !entry.present )
+				list.pop_back();
+			else if( entry.index == list.size() )
+				list.push_back( std::move( entry.value ) );
+			else
+				list[ entry.index ] = std::move( entry.value );
+			log.pop_back();
+		}
+	}
+
+	/* Add the basic symbols of the rows of a component to a list.
+
+	*/
+	static void appendBasics( const Component& component, SymbolList& symbols )
+	{
+		for( const auto& rowPair : component.rows )
+			symbols.push_back( rowPair.first );
+	}
+
+	/* Write the values of the variables depending on the recorded
+	suggestions, adding the ones which changed to the given list.
+
+	*/
+	void updateAffineVariables( std::vector<Variable>* changed )
+	{
+		const Sensitivity& sensitivity( m_affine.sensitivity );
+		m_affine.scratch.resize( m_affine.indices.size() );
+		sensitivity.evaluate( m_affine.values.data(), m_affine.scratch.data() );
+		if( changed )
+			changed->reserve( changed->size() + m_affine.indices.size() );
+		for( std::size_t i = 0, n = m_affine.indices.size(); i < n; ++i )
+		{
+			std::size_t index = m_affine.indices[ i ];
+			double value = m_affine.scratch[ i ];
+			m_values[ index ] = value;
+			Variable& var = m_var_list[ index ];
+			if( var.value() != value )
+			{
+				var.setValue( value );
+				if( changed )
+					changed->push_back( var );
+			}
+		}
+	}
+
+	static RowPtr makeRow( MemoryResource* resource, double constant = 0.0 )
+	{
+		ResourceAllocator<SharedRow> allocator( resource );
+		return RowPtr( allocator.newObject( constant, resource ), RowDeleter{ allocator } );
+	}
+
+	RowPtr makeRow( const Row& row ) const
+	{
+		ResourceAllocator<SharedRow> allocator( resource() );
+		return RowPtr( allocator.newObject( row ), RowDeleter{ allocator } );
+	}
+
+	RowDeleter rowDeleter() const
+	{
+		return RowDeleter{ ResourceAllocator<SharedRow>( resource() ) };
+	}
+
+	/* Add a reference to a row, which is then shared by another solver.
+
+	*/
+	static Row* shareRow( Row* row )
+	{
+		static_cast<SharedRow*>( row )->refs.fetch_add( 1, std::memory_order_relaxed );
+		return row;
+	}
+
+	static bool isShared( const Row& row )
+	{
+		return static_cast<const SharedRow&>( row ).refs.load( std::memory_order_acquire ) != 1;
+	}
+
+	/* Get a row of the solver's own for a row removed from the tableau,
+	copying it if it is shared.
+
+	*/
+	Row* unshareRow( Row* row )
+	{
+		if( !isShared( *row ) )
+			return row;
+		Row* copy = makeRow( *row ).release();
+		rowDeleter()( row );
+		return copy;
+	}
+
+	/* Get a row of the solver's own for the row of a basic symbol about
+	to be changed, copying it if it is shared, once its component is
+	saved by the newest checkpoint.
+
+	The copy replaces the row in the tableau and the column index. The
+	columns missing from the index, like the one of a symbol being
+	substituted, are skipped.
+
+	*/
+	Row* ownRow( const Symbol& basic, Row* row )
+	{
+		if( !m_checkpoints.empty() )
+			saveComponent( findComponent( basic ) );
+		if( !isShared( *row ) )
+			return row;
+		row = unshareRow( row );
+		Component& component( m_components[ findComponent( basic ) ] );
+		component.rows.find( basic )->second = row;
+		for( const auto& symbol : row->symbols() )
+		{
+			auto col_it = component.columns.find( symbol );
+			if( col_it == component.columns.end() )
+				continue;
+			auto it = col_it->second.find( basic );
+			if( it != col_it->second.end() )
+				it->second = row;
+		}
+		return row;
+	}
+
+	void clearRows()
+	{
+		for( auto& component : m_components )
+			releaseRows( component );
+		m_components.clear();
+	}
+
+	/* Release the rows of a component, leaving it without rows.
+
+	*/
+	void releaseRows( Component& component )
+	{
+		RowDeleter deleter( rowDeleter() );
+		for( auto& rowPair : component.rows )
+			deleter( rowPair.second );
+		component.rows.clear();
+	}
+
+	/* Get the row of a basic symbol, or null if the symbol is not basic.
+
+	*/
+	Row* rowOf( const Symbol& symbol )
+	{
+		std::size_t component = findComponent( symbol );
+		if( component == NoIndex )
+			return nullptr;
+		const RowMap& rows( m_components[ component ].rows );
+		auto it = rows.find( symbol );
+		return it == rows.end() ? nullptr : it->second;
+	}
+
+	/* Get the column of a parametric symbol, or null if no row refers to
+	the symbol.
+
+	*/
+	const RowMap* columnOf( const Symbol& symbol )
+	{
+		std::size_t component = findComponent( symbol );
+		if( component == NoIndex )
+			return nullptr;
+		const ColumnMap& columns( m_components[ component ].columns );
+		auto it = columns.find( symbol );
+		return it == columns.end() ? nullptr : &it->second;
+	}
+
+	/* Get the column of the given symbol in a column index, creating it
+	if needed.
+
+	*/
+	RowMap& columnFor( ColumnMap& columns, const Symbol& symbol )
+	{
+		auto it = columns.find( symbol );
+		if( it == columns.end() )
+		{
+			RowMap column( resource() );
+			it = columns.insert( std::make_pair( symbol, column ) ).first;
+		}
+		return it->second;
+	}
+
+	/* Add a row to the tableau as the row for the given basic symbol.
+
+	The row is stored by the component of the basic symbol, which must
+	be the one of every symbol of the row, and its column index is
+	updated so that each parametric symbol of the row refers back to it.
+
+	*/
+	void insertRow( const Symbol& basic, Row* row, Pass& pass )
+	{
+		std::size_t component = findComponent( basic );
+		saveComponent( component );
+		indexRow( m_components[ component ], basic, row );
+		markChanged( basic, pass );
+	}
+
+	/* Add a row to the rows and columns of a component.
+
+	*/
+	void indexRow( Component& component, const Symbol& basic, Row* row )
+	{
+		component.rows[ basic ] = row;
+		for( const auto& symbol : row->symbols() )
+			columnFor( component.columns, symbol )[ basic ] = row;
+	}
+
+	/* Remove the row of a basic symbol from the tableau and the column
+	index.
+
+	Ownership of the row is transferred to the caller.
+
+	*/
+	Row* eraseRow( const Symbol& basic, Pass& pass )
+	{
+		std::size_t root = findComponent( basic );
+		saveComponent( root );
+		Component& component( m_components[ root ] );
+		auto it = component.rows.find( basic );
+		Row* row = it->second;
+		component.rows.erase( it );
+		markChanged( basic, pass );
+		for( const auto& symbol : row->symbols() )
+			removeColumnEntry( component.columns, symbol, basic );
+		return row;
+	}
+
+	/* Remove a basic symbol from the column of a parametric symbol.
+
+	Columns which become empty are dropped from the index.
+
+	*/
+	static void removeColumnEntry( ColumnMap& columns, const Symbol& symbol, const Symbol& basic )
+	{
+		auto col_it = columns.find( symbol );
+		if( col_it == columns.end() )
+			return;
+		col_it->second.erase( basic );
+		if( col_it->second.empty() )
+			columns.erase( col_it );
+	}
+
+	/* Record that the value of a basic symbol may have changed.
+
+	Only the symbols of external and bounded variables are recorded, for
+	the next call to `updateChangedVariables`.
+
+	*/
+	void markChanged( const Symbol& basic, Pass& pass ) const
+	{
+		if( basic.type() != Symbol::External && basic.type() != Symbol::Bound )
+			return;
+		pass.changed.push_back( basic );
+		// Bound the list when the variables are never updated.
+		if( pass.changed.size() > 2 * m_vars.size() + 64 )
+			pruneChanged( pass.changed );
+	}
+
+	/* Compact a list of changed symbols, dropping the symbols of the
+	variables dropped since they were recorded.
+
+	The symbols are never reused, so without this the list would keep
+	growing when variables come and go while the values are never
+	updated.
+
+	*/
+	void pruneChanged( SymbolList& changed ) const
+	{
+		compactChanged( changed );
+		changed.erase( std::remove_if( changed.begin(), changed.end(), [this]( const Symbol& symbol ) {
+			return m_var_indices.find( symbol ) == m_var_indices.end();
+		} ), changed.end() );
+	}
+
+	/* Sort a list of changed symbols and drop the duplicates.
+
+	*/
+	static void compactChanged( SymbolList& changed )
+	{
+		std::sort( changed.begin(), changed.end() );
+		changed.erase( std::unique( changed.begin(), changed.end() ), changed.end() );
+	}
+
+	/* Get the symbol for the given variable.
+
+	If a symbol does not exist for the variable, one will be created.
+
+	*/
+	Symbol getVarSymbol( const Variable& variable )
+	{
+		auto it = m_vars.find( variable );
+		if( it != m_vars.end() )
+			return it->second;
+		Symbol symbol( Symbol::External, m_id_tick++ );
+		addVariable( variable, symbol, 0.0, 1.0 );
+		return symbol;
+	}
+
+	/* Give the next variable index to a variable new to the solver.
+
+	The value of the variable is `offset + scale * value( symbol )`, the
+	offset and scale being those of a native bound for a Bound symbol.
+	The symbol of an alias is replaced by the one of its owner by
+	`addAlias`.
+
+	*/
+	void addVariable( const Variable& variable, const Symbol& symbol, double offset, double scale )
+	{
+		if( !m_checkpoints.empty() )
+		{
+			VarSlot slot{ variable, symbol, 0.0, offset, scale, NoIndex, NoIndex };
+			m_undo.var_slots.push_back( ListUndo<VarSlot>{ m_var_list.size(), slot, false } );
 		}
+		saveEntry( m_undo.vars, m_vars, variable );
+		m_vars[ variable ] = symbol;
+		saveEntry( m_undo.var_indices, m_var_indices, symbol );
+		m_var_indices.insert( std::make_pair( symbol, m_var_list.size() ) );
+		m_var_list.push_back( variable );
+		m_var_symbols.push_back( symbol );
+		m_values.push_back( 0.0 );
+		m_var_offsets.push_back( offset );
+		m_var_scales.push_back( scale );
+		m_var_next.push_back( NoIndex );
+		m_var_refs.push_back( NoIndex );
+		markChanged( symbol, m_pass );
 	}
 
-	/* Update the values of the external solver variables.
+	/* Get the index of a variable of the solver.
 
 	*/
-	void updateVariables()
+	std::size_t variableIndex( const Variable& variable ) const
 	{
-		auto row_end = m_rows.end();
+		return m_var_indices.find( m_vars.find( variable )->second )->second;
+	}
 
-		for (auto &varPair : m_vars)
+	/* Add the terms of a constraint just given a slot as references to
+	their variables.
+
+	*/
+	void addReferences( const Constraint& constraint, std::size_t slot )
+	{
+		std::size_t last = NoIndex;
+		for( const auto& term : constraint.expression().terms() )
 		{
-			Variable& var = varPair.first;
-			auto row_it = m_rows.find( varPair.second );
-			if( row_it == row_end )
-				var.setValue( 0.0 );
+			if( nearZero( term.coefficient() ) )
+				continue;
+			std::size_t index = variableIndex( term.variable() );
+			std::size_t ref;
+			if( m_free_refs.empty() )
+			{
+				ref = m_refs.size();
+				saveElement( m_undo.refs, m_refs, ref );
+				m_refs.push_back( VarRef() );
+			}
+			else
+			{
+				ref = m_free_refs.back();
+				saveElement( m_undo.free_refs, m_free_refs, m_free_refs.size() - 1 );
+				m_free_refs.pop_back();
+				saveElement( m_undo.refs, m_refs, ref );
+			}
+			std::size_t head = m_var_refs[ index ];
+			m_refs[ ref ] = VarRef{ slot, NoIndex, head, NoIndex };
+			if( head != NoIndex )
+			{
+				saveElement( m_undo.refs, m_refs, head );
+				m_refs[ head ].prev = ref;
+			}
+			saveVariable( index );
+			m_var_refs[ index ] = ref;
+			if( last == NoIndex )
+			{
+				saveElement( m_undo.cn_slots, m_cn_slots, slot );
+				m_cn_slots[ slot ].refs = ref;
+			}
 			else
-				var.setValue( row_it->second->constant() );
+				m_refs[ last ].sibling = ref;
+			last = ref;
 		}
 	}
 
-	/* Reset the solver to the empty starting condition.
-
-	This method resets the internal solver state to the empty starting
-	condition, as if no constraints or edit variables have been added.
-	This can be faster than deleting the solver and creating a new one
-	when the entire system must change, since it can avoid unecessary
-	heap (de)allocations.
+	/* Drop the references of the terms of a constraint removed from its
+	slot, and the variables no constraint refers to anymore.
 
 	*/
-	void reset()
+	void dropReferences( const Constraint& constraint, std::size_t slot )
 	{
-		clearRows();
-		m_cns.clear();
-		m_vars.clear();
-		m_edits.clear();
-		m_infeasible_rows.clear();
-		m_objective.reset( new Row() );
-		m_artificial.reset();
-		m_id_tick = 1;
+		std::size_t ref = m_cn_slots[ slot ].refs;
+		saveElement( m_undo.cn_slots, m_cn_slots, slot );
+		m_cn_slots[ slot ].refs = NoIndex;
+		for( const auto& term : constraint.expression().terms() )
+		{
+			if( nearZero( term.coefficient() ) )
+				continue;
+			std::size_t index = variableIndex( term.variable() );
+			VarRef node( m_refs[ ref ] );
+			if( node.prev != NoIndex )
+			{
+				saveElement( m_undo.refs, m_refs, node.prev );
+				m_refs[ node.prev ].next = node.next;
+			}
+			else
+			{
+				saveVariable( index );
+				m_var_refs[ index ] = node.next;
+			}
+			if( node.next != NoIndex )
+			{
+				saveElement( m_undo.refs, m_refs, node.next );
+				m_refs[ node.next ].prev = node.prev;
+			}
+			saveElement( m_undo.free_refs, m_free_refs, m_free_refs.size() );
+			m_free_refs.push_back( ref );
+			if( m_var_refs[ index ] == NoIndex )
+				dropVariable( index );
+			ref = node.sibling;
+		}
 	}
 
-	SolverImpl& operator=( const SolverImpl& ) = delete;
-
-	SolverImpl& operator=( SolverImpl&& ) = delete;
+	/* Drop a variable which no constraint refers to, along with its
+	symbol.
 
-private:
+	Removing the constraints of a variable releases its native bound and
+	its alias, so the variable owns an external symbol, which only
+	round-off can leave in the tableau: its row is dropped if it is
+	basic, and its cells otherwise. The last variable takes the index of
+	the dropped one, so that the indices stay dense.
 
-	struct RowDeleter
+	*/
+	void dropVariable( std::size_t index )
 	{
-		template<typename T>
-		void operator()( T& pair ) { delete pair.second; }
-	};
+		Symbol symbol( m_var_symbols[ index ] );
+		std::size_t component = findComponent( symbol );
+		if( component != NoIndex )
+		{
+			if( rowOf( symbol ) )
+			{
+				RowPtr rowptr( eraseRow( symbol, m_pass ), rowDeleter() );
+			}
+			saveComponent( component );
+			ColumnMap& columns( m_components[ component ].columns );
+			auto col_it = columns.find( symbol );
+			if( col_it != columns.end() )
+			{
+				for( auto& rowPair : col_it->second )
+					ownRow( rowPair.first, rowPair.second )->remove( symbol );
+				columns.erase( col_it );
+			}
+			const RowPtr& objective( m_components[ component ].objective );
+			if( objective && objective->coefficientFor( symbol ) != 0.0 )
+				objectiveFor( component ).remove( symbol );
+			saveEntry( m_undo.symbol_components, m_symbol_components, symbol );
+			m_symbol_components.erase( symbol );
+		}
+		saveEntry( m_undo.vars, m_vars, m_var_list[ index ] );
+		m_vars.erase( m_var_list[ index ] );
+		saveEntry( m_undo.var_indices, m_var_indices, symbol );
+		m_var_indices.erase( symbol );
 
-	void clearRows()
-	{
-		std::for_each( m_rows.begin(), m_rows.end(), RowDeleter() );
-		m_rows.clear();
+		std::size_t last = m_var_list.size() - 1;
+		if( index != last )
+		{
+			saveVariable( index );
+			m_var_list[ index ] = m_var_list[ last ];
+			m_var_symbols[ index ] = m_var_symbols[ last ];
+			m_values[ index ] = m_values[ last ];
+			m_var_offsets[ index ] = m_var_offsets[ last ];
+			m_var_scales[ index ] = m_var_scales[ last ];
+			m_var_next[ index ] = m_var_next[ last ];
+			m_var_refs[ index ] = m_var_refs[ last ];
+			// An alias is reached from its owner through `m_var_next`, an
+			// owner through its symbol.
+			const Symbol& key( m_vars.find( m_var_list[ index ] )->second );
+			saveEntry( m_undo.var_indices, m_var_indices, key );
+			m_var_indices.find( key )->second = index;
+			if( !( key == m_var_symbols[ index ] ) )
+			{
+				std::size_t previous = m_var_indices.find( m_var_symbols[ index ] )->second;
+				while( m_var_next[ previous ] != last )
+					previous = m_var_next[ previous ];
+				saveVariable( previous );
+				m_var_next[ previous ] = index;
+			}
+		}
+		saveVariable( last );
+		m_var_list.pop_back();
+		m_var_symbols.pop_back();
+		m_values.pop_back();
+		m_var_offsets.pop_back();
+		m_var_scales.pop_back();
+		m_var_next.pop_back();
+		m_var_refs.pop_back();
 	}
 
-	/* Get the symbol for the given variable.
+	/* Add a multiple of a variable to a row, given the symbol of the
+	variable in the var map.
 
-	If a symbol does not exist for the variable, one will be created.
+	A variable with a native bound is replaced by its bound plus or minus
+	its Bound symbol, and an alias by its affine function of the symbol
+	of its owner plus its marker. If the symbol is basic, it is
+	substituted with its row.
 
 	*/
-	Symbol getVarSymbol( const Variable& variable )
+	void insertVariable( Row& row, Symbol symbol, double coefficient )
 	{
-		auto it = m_vars.find( variable );
-		if( it != m_vars.end() )
-			return it->second;
-		Symbol symbol( Symbol::External, m_id_tick++ );
-		m_vars[ variable ] = symbol;
-		return symbol;
+		if( symbol.type() != Symbol::External )
+		{
+			std::size_t index = m_var_indices.find( symbol )->second;
+			if( symbol.type() == Symbol::Dummy )
+				row.insert( symbol, coefficient );
+			row.add( coefficient * m_var_offsets[ index ] );
+			coefficient *= m_var_scales[ index ];
+			symbol = m_var_symbols[ index ];
+		}
+		if( const Row* basic = rowOf( symbol ) )
+			row.insert( *basic, coefficient );
+		else
+			row.insert( symbol, coefficient );
 	}
 
 	/* Create a new Row object for the given constraint.
@@ -371,9 +3643,10 @@ private:
 	The terms in the constraint will be converted to cells in the row.
 	Any term in the constraint with a coefficient of zero is ignored.
 	This method uses the `getVarSymbol` method to get the symbol for
-	the variables added to the row. If the symbol for a given cell
-	variable is basic, the cell variable will be substituted with the
-	basic row.
+	the variables added to the row, and `insertVariable` to add them,
+	so variables with a native bound or an alias are replaced by the
+	function of their symbol. If the symbol for a given cell variable
+	is basic, the cell variable will be substituted with the basic row.
 
 	The necessary slack and error variables will be added to the row.
 	If the constant for the row is negative, the sign for the row
@@ -383,25 +3656,23 @@ private:
 	for tracking the movement of the constraint in the tableau.
 
 	*/
-	std::unique_ptr<Row> createRow( const Constraint& constraint, Tag& tag )
+	RowPtr createRow( const Constraint& constraint, Tag& tag )
 	{
 		const Expression& expr( constraint.expression() );
-		std::unique_ptr<Row> row( new Row( expr.constant() ) );
+		RowPtr row( makeRow( resource(), expr.constant() ) );
 
 		// Substitute the current basic variables into the row.
 		for (const auto &term : expr.terms())
 		{
 			if( !nearZero( term.coefficient() ) )
-			{
-				Symbol symbol( getVarSymbol( term.variable() ) );
-				auto row_it = m_rows.find( symbol );
-				if( row_it != m_rows.end() )
-					row->insert( *row_it->second, term.coefficient() );
-				else
-					row->insert( symbol, term.coefficient() );
-			}
+				insertVariable( *row, getVarSymbol( term.variable() ), term.coefficient() );
 		}
 
+		// The constraint ties together the components of the symbols of
+		// the row, which its new symbols join.
+		std::size_t component = joinComponents( Symbol(), *row );
+		Row& objective( objectiveFor( component ) );
+
 		// Add the necessary slack, error, and dummy variables.
 		switch( constraint.op() )
 		{
@@ -412,12 +3683,14 @@ private:
 				Symbol slack( Symbol::Slack, m_id_tick++ );
 				tag.marker = slack;
 				row->insert( slack, coeff );
+				setComponent( slack, component );
 				if( constraint.strength() < strength::required )
 				{
 					Symbol error( Symbol::Error, m_id_tick++ );
 					tag.other = error;
 					row->insert( error, -coeff );
-					m_objective->insert( error, constraint.strength() );
+					objective.insert( error, constraint.strength() );
+					setComponent( error, component );
 				}
 				break;
 			}
@@ -431,14 +3704,17 @@ private:
 					tag.other = errminus;
 					row->insert( errplus, -1.0 ); // v = eplus - eminus
 					row->insert( errminus, 1.0 ); // v - eplus + eminus = 0
-					m_objective->insert( errplus, constraint.strength() );
-					m_objective->insert( errminus, constraint.strength() );
+					objective.insert( errplus, constraint.strength() );
+					objective.insert( errminus, constraint.strength() );
+					setComponent( errplus, component );
+					setComponent( errminus, component );
 				}
 				else
 				{
 					Symbol dummy( Symbol::Dummy, m_id_tick++ );
 					tag.marker = dummy;
 					row->insert( dummy );
+					setComponent( dummy, component );
 				}
 				break;
 			}
@@ -467,10 +3743,10 @@ private:
 	*/
 	Symbol chooseSubject( const Row& row, const Tag& tag ) const
 	{
-		for (const auto &cellPair : row.cells())
+		for (const auto &symbol : row.symbols())
 		{
-			if( cellPair.first.type() == Symbol::External )
-				return cellPair.first;
+			if( symbol.type() == Symbol::External )
+				return symbol;
 		}
 		if( tag.marker.type() == Symbol::Slack || tag.marker.type() == Symbol::Error )
 		{
@@ -494,64 +3770,178 @@ private:
  	{
 		// Create and add the artificial variable to the tableau
 		Symbol art( Symbol::Slack, m_id_tick++ );
-		m_rows[ art ] = new Row( row );
-		m_artificial.reset( new Row( row ) );
+		std::size_t component = joinComponents( art, row );
+		insertRow( art, makeRow( row ).release(), m_pass );
+		m_artificial = makeRow( row );
 
 		// Optimize the artificial objective. This is successful
 		// only if the artificial objective is optimized to zero.
-		optimize( *m_artificial );
+		optimize( component, *m_artificial, m_pass );
 		bool success = nearZero( m_artificial->constant() );
 		m_artificial.reset();
 
+		// If the artificial variable is still basic and positive, the
+		// constraint cannot be satisfied and its row is dropped. The
+		// pivots only moved the other rows to another feasible basis,
+		// which may no longer be optimal for the objective.
+		if( !success && rowOf( art ) )
+		{
+			RowPtr rowptr( eraseRow( art, m_pass ), rowDeleter() );
+			m_dirty.push_back( component );
+			return false;
+		}
+
 		// If the artificial variable is not basic, pivot the row so that
 		// it becomes basic. If the row is constant, exit early.
-		auto it = m_rows.find( art );
-		if( it != m_rows.end() )
+		if( rowOf( art ) )
 		{
-			std::unique_ptr<Row> rowptr( it->second );
-			m_rows.erase( it );
+			RowPtr rowptr( eraseRow( art, m_pass ), rowDeleter() );
 			if( rowptr->cells().empty() )
 				return success;
 			Symbol entering( anyPivotableSymbol( *rowptr ) );
 			if( entering.type() == Symbol::Invalid )
 				return false;  // unsatisfiable (will this ever happen?)
+			if( isShared( *rowptr ) )
+				rowptr = makeRow( *rowptr );
 			rowptr->solveFor( art, entering );
-			substitute( entering, *rowptr );
-			m_rows[ entering ] = rowptr.release();
+			substitute( entering, *rowptr, m_pass );
+			insertRow( entering, rowptr.release(), m_pass );
 		}
 
 		// Remove the artificial variable from the tableau.
-		for (auto &rowPair : m_rows)
-			rowPair.second->remove(art);
+		saveComponent( component );
+		ColumnMap& columns( m_components[ component ].columns );
+		auto col_it = columns.find( art );
+		if( col_it != columns.end() )
+		{
+			for (auto &rowPair : col_it->second)
+				ownRow( rowPair.first, rowPair.second )->remove(art);
+			columns.erase( col_it );
+		}
 
-		m_objective->remove( art );
+		objectiveFor( component ).remove( art );
 		return success;
  	}
 
 	/* Substitute the parametric symbol with the given row.
 
 	This method will substitute all instances of the parametric symbol
-	in the tableau and the objective function with the given row.
+	in the tableau and the objective of its component with the given
+	row.
+
+	Only the rows listed in the column of the symbol are visited. The
+	symbol leaves all of them, and only the symbols which entered or
+	cancelled out of a visited row are re-indexed. Large columns are
+	substituted on the thread pool, see `substituteChunks`.
 
 	*/
-	void substitute( const Symbol& symbol, const Row& row )
+	void substitute( const Symbol& symbol, const Row& row, Pass& pass )
 	{
-		for( auto& rowPair : m_rows )
+		std::size_t component = findComponent( symbol );
+		if( component == NoIndex )
+			return;
+		saveComponent( component );
+		ColumnMap& columns( m_components[ component ].columns );
+		auto col_it = columns.find( symbol );
+		if( col_it != columns.end() )
 		{
-			rowPair.second->substitute( symbol, row );
-			if( rowPair.first.type() != Symbol::External &&
-				rowPair.second->constant() < 0.0 )
-				m_infeasible_rows.push_back( rowPair.first );
+			RowMap rows( resource() );
+			rows.swap( col_it->second );
+			columns.erase( col_it );
+			// The tasks of a parallel pass have their own pass and are
+			// already running on the pool.
+			if( m_pool && m_pool->size() > 1 && m_substitute_threshold != 0 &&
+				rows.size() >= m_substitute_threshold && &pass == &m_pass )
+				substituteChunks( symbol, row, rows, columns );
+			else
+			{
+				for( auto& rowPair : rows )
+				{
+					pass.entered.clear();
+					pass.left.clear();
+					rowPair.second = ownRow( rowPair.first, rowPair.second );
+					rowPair.second->substitute( symbol, row, pass.entered, pass.left );
+					markChanged( rowPair.first, pass );
+					for( const auto& cell : pass.entered )
+						columnFor( columns, cell )[ rowPair.first ] = rowPair.second;
+					for( const auto& cell : pass.left )
+						removeColumnEntry( columns, cell, rowPair.first );
+					if( rowPair.first.type() != Symbol::External &&
+						rowPair.second->constant() < 0.0 )
+						pass.infeasible.push_back( rowPair.first );
+				}
+			}
 		}
-		m_objective->substitute( symbol, row );
+		objectiveFor( component ).substitute( symbol, row );
 		if( m_artificial.get() )
 			m_artificial->substitute( symbol, row );
 	}
 
-	/* Optimize the system for the given objective function.
+	/* Substitute the parametric symbol with the given row in the rows of
+	its column, on the thread pool.
+
+	The rows are split into contiguous chunks, each substituted by a task
+	which only writes to its rows and to its own pass. The changes of the
+	column index, the changed symbols and the infeasible rows of the
+	chunks are then applied in the order of the rows, as the serial loop
+	of `substitute` does.
+
+	*/
+	void substituteChunks( const Symbol& symbol, const Row& row, const RowMap& rows, ColumnMap& columns )
+	{
+		m_column_rows.assign( rows.begin(), rows.end() );
+		// The shared rows are copied beforehand, as copying one updates
+		// the column index.
+		for( auto& rowPair : m_column_rows )
+			rowPair.second = ownRow( rowPair.first, rowPair.second );
+		std::size_t size = m_column_rows.size();
+		std::size_t count = std::min( 4 * m_pool->size(), ( size + ChunkRows - 1 ) / ChunkRows );
+		while( m_chunks.size() < count )
+			m_chunks.emplace_back( resource() );
+		m_pool->parallelFor( count, [&]( std::size_t i )
+		{
+			Chunk& chunk( m_chunks[ i ] );
+			chunk.updates.clear();
+			for( std::size_t j = size * i / count, end = size * ( i + 1 ) / count; j < end; ++j )
+			{
+				const Symbol& basic( m_column_rows[ j ].first );
+				Row* target = m_column_rows[ j ].second;
+				chunk.pass.entered.clear();
+				chunk.pass.left.clear();
+				target->substitute( symbol, row, chunk.pass.entered, chunk.pass.left );
+				markChanged( basic, chunk.pass );
+				for( const auto& cell : chunk.pass.entered )
+					chunk.updates.push_back( ColumnUpdate{ cell, basic, target } );
+				for( const auto& cell : chunk.pass.left )
+					chunk.updates.push_back( ColumnUpdate{ cell, basic, nullptr } );
+				if( basic.type() != Symbol::External && target->constant() < 0.0 )
+					chunk.pass.infeasible.push_back( basic );
+			}
+		} );
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			Chunk& chunk( m_chunks[ i ] );
+			for( const auto& update : chunk.updates )
+			{
+				if( update.row )
+					columnFor( columns, update.cell )[ update.basic ] = update.row;
+				else
+					removeColumnEntry( columns, update.cell, update.basic );
+			}
+			mergePass( chunk.pass );
+		}
+	}
+
+	/* Optimize a component of the system for the given objective function.
 
 	This method performs iterations of Phase 2 of the simplex method
-	until the objective function reaches a minimum.
+	until the objective function reaches a minimum. The entering symbols
+	are chosen by the pivot rule, unless the last pivots did not improve
+	the objective, in which case the Bland rule is used to prevent the
+	method from cycling.
+
+	The pivots only involve the rows of the component, so components
+	can be optimized concurrently, each with its own pass.
 
 	Throws
 	------
@@ -559,26 +3949,73 @@ private:
 		The value of the objective function is unbounded.
 
 	*/
-	void optimize( const Row& objective )
+	void optimize( std::size_t component, Row& objective, Pass& pass )
 	{
+		const ColumnMap& columns( m_components[ component ].columns );
+		std::size_t degenerate = 0;
 		while( true )
 		{
-			Symbol entering( getEnteringSymbol( objective ) );
+			bool bland = degenerate > DegeneratePivotLimit;
+			Symbol entering( getEnteringSymbol( objective, columns, bland ) );
 			if( entering.type() == Symbol::Invalid )
 				return;
-			auto it = getLeavingRow( entering );
-			if( it == m_rows.end() )
-				throw InternalSolverError( "The objective is unbounded." );
-			// pivot the entering symbol into the basis
-			Symbol leaving( it->first );
-			Row* row = it->second;
-			m_rows.erase( it );
+			Symbol leaving( getLeavingRow( columns, entering, bland ) );
+			if( leaving.type() == Symbol::Invalid )
+			{
+				// The objectives are sums of restricted symbols and are
+				// bounded below. A symbol which no row bounds can only be
+				// left with a negative coefficient by round-off from the
+				// cancellations of earlier substitutions, which happens
+				// more easily when several constraints are removed before
+				// optimizing. Such a coefficient is dropped.
+				if( !isRoundOff( objective, entering ) )
+					throw InternalSolverError( "The objective is unbounded." );
+				objective.remove( entering );
+				continue;
+			}
+			// pivot the entering symbol into the basis, the ratio test may
+			// choose a row slightly below zero which is clamped to zero
+			double previous = objective.constant();
+			Row* row = unshareRow( eraseRow( leaving, pass ) );
+			if( row->constant() < 0.0 )
+				row->add( -row->constant() );
 			row->solveFor( leaving, entering );
-			substitute( entering, *row );
-			m_rows[ entering ] = row;
+			substitute( entering, *row, pass );
+			insertRow( entering, row, pass );
+			++pass.pivots;
+			if( nearZero( objective.constant() - previous ) )
+				++degenerate;
+			else
+				degenerate = 0;
 		}
 	}
 
+	/* Optimize the objectives of the components marked as dirty.
+
+	Each dirty component is optimized once, on the thread pool if the
+	solver has one. Once no component is dirty, the components are split
+	again if enough constraints were removed since they were last split.
+
+	*/
+	void optimizeDirty()
+	{
+		m_roots.clear();
+		for( std::size_t component : m_dirty )
+			m_roots.push_back( std::make_pair( findRoot( component ), Symbol() ) );
+		m_dirty.clear();
+		std::sort( m_roots.begin(), m_roots.end() );
+		m_roots.erase( std::unique( m_roots.begin(), m_roots.end() ), m_roots.end() );
+		for( const auto& root : m_roots )
+			objectiveFor( root.first );
+		runPasses( m_roots.size(), [this]( std::size_t i, Pass& pass )
+		{
+			std::size_t component = m_roots[ i ].first;
+			optimize( component, *m_components[ component ].objective, pass );
+		} );
+		if( m_removed > ( m_cns.size() - m_stale_cns ) / 2 + SplitThreshold )
+			splitComponents();
+	}
+
 	/* Optimize the system using the dual of the simplex method.
 
 	The current state of the system should be such that the objective
@@ -586,6 +4023,10 @@ private:
 	an iteration of the dual simplex method to make the solution both
 	optimal and feasible.
 
+	The infeasible rows are grouped by component, keeping their order,
+	and each group is handled by a pass of its own, on the thread pool
+	if the solver has one.
+
 	Throws
 	------
 	InternalSolverError
@@ -594,86 +4035,247 @@ private:
 	*/
 	void dualOptimize()
 	{
-		while( !m_infeasible_rows.empty() )
+		if( m_pass.infeasible.empty() )
+			return;
+		m_roots.clear();
+		for( const auto& symbol : m_pass.infeasible )
+		{
+			std::size_t component = findComponent( symbol );
+			if( component != NoIndex )
+				m_roots.push_back( std::make_pair( component, symbol ) );
+		}
+		m_pass.infeasible.clear();
+		std::stable_sort( m_roots.begin(), m_roots.end(), []( const std::pair<std::size_t, Symbol>& lhs,
+															  const std::pair<std::size_t, Symbol>& rhs )
+		{
+			return lhs.first < rhs.first;
+		} );
+		m_groups.clear();
+		for( std::size_t i = 0, n = m_roots.size(); i < n; ++i )
+		{
+			if( i == 0 || m_roots[ i ].first != m_roots[ i - 1 ].first )
+				m_groups.push_back( i );
+		}
+		m_groups.push_back( m_roots.size() );
+		// The checkpoints are not thread safe, so the components of the
+		// passes are saved beforehand.
+		for( std::size_t i = 0, n = m_groups.size() - 1; i < n; ++i )
+			saveComponent( m_roots[ m_groups[ i ] ].first );
+		runPasses( m_groups.size() - 1, [this]( std::size_t i, Pass& pass )
+		{
+			for( std::size_t j = m_groups[ i ]; j < m_groups[ i + 1 ]; ++j )
+				pass.infeasible.push_back( m_roots[ j ].second );
+			dualOptimize( pass );
+		} );
+	}
+
+	/* Perform the dual simplex method on the infeasible rows of a pass,
+	which all belong to a single component.
+
+	Like `optimize`, it uses the Bland rule after a run of pivots which
+	did not change the objective. Each pivot only involves the objective
+	of the component of the infeasible row.
+
+	*/
+	void dualOptimize( Pass& pass )
+	{
+		std::size_t degenerate = 0;
+		while( !pass.infeasible.empty() )
 		{
 
-			Symbol leaving( m_infeasible_rows.back() );
-			m_infeasible_rows.pop_back();
-			auto it = m_rows.find( leaving );
-			if( it != m_rows.end() && !nearZero( it->second->constant() ) &&
-				it->second->constant() < 0.0 )
+			Symbol leaving( pass.infeasible.back() );
+			pass.infeasible.pop_back();
+			Row* row = rowOf( leaving );
+			if( row && !nearZero( row->constant() ) && row->constant() < 0.0 )
 			{
-				Symbol entering( getDualEnteringSymbol( *it->second ) );
+				Row& objective( objectiveOf( leaving ) );
+				Symbol entering( getDualEnteringSymbol( *row, objective,
+														degenerate > DegeneratePivotLimit ) );
 				if( entering.type() == Symbol::Invalid )
 					throw InternalSolverError( "Dual optimize failed." );
 				// pivot the entering symbol into the basis
-				Row* row = it->second;
-				m_rows.erase( it );
+				double previous = objective.constant();
+				row = unshareRow( eraseRow( leaving, pass ) );
 				row->solveFor( leaving, entering );
-				substitute( entering, *row );
-				m_rows[ entering ] = row;
+				substitute( entering, *row, pass );
+				insertRow( entering, row, pass );
+				++pass.pivots;
+				if( nearZero( objective.constant() - previous ) )
+					++degenerate;
+				else
+					degenerate = 0;
 			}
 		}
 	}
 
-	/* Compute the entering variable for a pivot operation.
+	/* Run `task( i, pass )` for each i in [0, count).
 
-	This method will return first symbol in the objective function which
-	is non-dummy and has a coefficient less than zero. If no symbol meets
-	the criteria, it means the objective function is at a minimum, and an
-	invalid symbol is returned.
+	Without a thread pool, or for a single task, the tasks run in order
+	with the pass of the solver. Otherwise each task gets a pass of its
+	own and the tasks run on the pool. The passes are then merged into
+	the one of the solver in the order of the tasks, so the state of the
+	solver does not depend on the scheduling of the tasks.
 
 	*/
-	Symbol getEnteringSymbol( const Row& objective ) const
+	template<typename Task>
+	void runPasses( std::size_t count, const Task& task )
 	{
-		for (const auto &cellPair : objective.cells())
+		if( !m_pool || m_pool->size() < 2 || count < 2 )
 		{
-			if( cellPair.first.type() != Symbol::Dummy && cellPair.second < 0.0 )
-				return cellPair.first;
+			for( std::size_t i = 0; i < count; ++i )
+				task( i, m_pass );
+			return;
 		}
-		return Symbol();
+		PassList passes( resource() );
+		passes.reserve( count );
+		for( std::size_t i = 0; i < count; ++i )
+			passes.emplace_back( resource() );
+		try
+		{
+			m_pool->parallelFor( count, [&]( std::size_t i ) { task( i, passes[ i ] ); } );
+		}
+		catch( ... )
+		{
+			mergePasses( passes );
+			throw;
+		}
+		mergePasses( passes );
+	}
+
+	/* Merge the passes of parallel tasks into the pass of the solver.
+
+	*/
+	void mergePasses( PassList& passes )
+	{
+		for( auto& pass : passes )
+			mergePass( pass );
+	}
+
+	/* Move the infeasible rows, changed symbols and pivots of the pass of
+	a parallel task into the pass of the solver.
+
+	*/
+	void mergePass( Pass& pass )
+	{
+		m_pass.infeasible.insert( m_pass.infeasible.end(), pass.infeasible.begin(), pass.infeasible.end() );
+		m_pass.changed.insert( m_pass.changed.end(), pass.changed.begin(), pass.changed.end() );
+		m_pass.pivots += pass.pivots;
+		pass.infeasible.clear();
+		pass.changed.clear();
+		pass.pivots = 0;
+		if( m_pass.changed.size() > 2 * m_vars.size() + 64 )
+			pruneChanged( m_pass.changed );
+	}
+
+	/* Compute the entering variable for a pivot operation.
+
+	This method will return a symbol in the objective function which is
+	non-dummy and has a coefficient less than zero, chosen by the pivot
+	rule or by the Bland rule if requested. If no symbol meets the
+	criteria, it means the objective function is at a minimum, and an
+	invalid symbol is returned. The columns are those of the component
+	of the objective.
+
+	*/
+	Symbol getEnteringSymbol( const Row& objective, const ColumnMap& columns, bool bland ) const
+	{
+		auto columnNorm = [&columns]( const Symbol& symbol )
+		{
+			double norm = 0.0;
+			auto col_it = columns.find( symbol );
+			if( col_it != columns.end() )
+			{
+				for( const auto& rowPair : col_it->second )
+				{
+					double coeff = rowPair.second->coefficientFor( symbol );
+					norm += coeff * coeff;
+				}
+			}
+			return norm;
+		};
+		if( bland )
+			return BlandPivotRule::enteringSymbol( objective, columnNorm );
+		return PivotRule::enteringSymbol( objective, columnNorm );
+	}
+
+	/* Test whether the coefficient of a symbol in the objective is
+	negligible compared to the other coefficients of the objective.
+
+	The rows drop the cells which are near zero, so the coefficients of
+	the objective may be off by a small multiple of that tolerance on top
+	of the relative round-off.
+
+	*/
+	static bool isRoundOff( const Row& objective, const Symbol& symbol )
+	{
+		double largest = 1.0;
+		for( double coeff : objective.coefficients() )
+			largest = std::max( largest, std::fabs( coeff ) );
+		double tolerance = std::max( 1.0e-6, 1.0e-10 * largest );
+		return std::fabs( objective.coefficientFor( symbol ) ) < tolerance;
 	}
 
 	/* Compute the entering symbol for the dual optimize operation.
 
-	This method will return the symbol in the row which has a positive
+	This method will return a symbol in the row which has a positive
 	coefficient and yields the minimum ratio for its respective symbol
-	in the objective function. The provided row *must* be infeasible.
+	in the given objective, which is the one of the component of the
+	row. The provided row *must* be infeasible.
 	If no symbol is found which meats the criteria, an invalid symbol
 	is returned.
 
+	The symbol is chosen with the two passes of the Harris ratio test.
+	The first pass computes the largest ratio which keeps every
+	coefficient of the objective above -RatioTolerance, the second one
+	picks among the symbols within that ratio the one with the largest
+	coefficient in the row. If `bland` is true, the symbol with the
+	minimum ratio and the smallest id is returned instead.
+
 	*/
-	Symbol getDualEnteringSymbol( const Row& row ) const
+	Symbol getDualEnteringSymbol( const Row& row, const Row& objective, bool bland ) const
 	{
+		const Row::SymbolVector& symbols( row.symbols() );
+		const Row::CoefficientVector& coeffs( row.coefficients() );
+		double tolerance = bland ? 0.0 : RatioTolerance;
+		double bound = std::numeric_limits<double>::max();
+		for( std::size_t i = 0, n = symbols.size(); i < n; ++i )
+		{
+			if( coeffs[ i ] > 0.0 && symbols[ i ].type() != Symbol::Dummy )
+			{
+				double coeff = objective.coefficientFor( symbols[ i ] );
+				bound = std::min( bound, ( coeff + tolerance ) / coeffs[ i ] );
+			}
+		}
 		Symbol entering;
-		double ratio = std::numeric_limits<double>::max();
-		for (const auto &cellPair : row.cells())
+		double pivot = 0.0;
+		for( std::size_t i = 0, n = symbols.size(); i < n; ++i )
 		{
-			if( cellPair.second > 0.0 && cellPair.first.type() != Symbol::Dummy )
+			if( coeffs[ i ] > pivot && symbols[ i ].type() != Symbol::Dummy )
 			{
-				double coeff = m_objective->coefficientFor( cellPair.first );
-				double r = coeff / cellPair.second;
-				if( r < ratio )
+				double coeff = objective.coefficientFor( symbols[ i ] );
+				if( coeff / coeffs[ i ] <= bound )
 				{
-					ratio = r;
-					entering = cellPair.first;
+					entering = symbols[ i ];
+					if( bland )
+						break;
+					pivot = coeffs[ i ];
 				}
 			}
 		}
 		return entering;
 	}
 
-	/* Get the first Slack or Error symbol in the row.
+	/* Get the first Slack, Error or Bound symbol in the row.
 
 	If no such symbol is present, and Invalid symbol will be returned.
 
 	*/
 	Symbol anyPivotableSymbol( const Row& row ) const
 	{
-		for (const auto &cellPair : row.cells())
+		for (const auto &sym : row.symbols())
 		{
-			const Symbol& sym( cellPair.first );
-			if( sym.type() == Symbol::Slack || sym.type() == Symbol::Error )
+			if( sym.type() == Symbol::Slack || sym.type() == Symbol::Error ||
+				sym.type() == Symbol::Bound )
 				return sym;
 		}
 		return Symbol();
@@ -681,41 +4283,63 @@ private:
 
 	/* Compute the row which holds the exit symbol for a pivot.
 
-	This method will return an iterator to the row in the row map
-	which holds the exit symbol. If no appropriate exit symbol is
-	found, the end() iterator will be returned. This indicates that
-	the objective function is unbounded.
+	This method will return the basic symbol of the row, among the rows
+	of the given columns, which holds the exit symbol. If no appropriate
+	exit symbol is found, an invalid symbol will be returned. This
+	indicates that the objective function is unbounded.
+
+	The row is chosen with the two passes of the Harris ratio test. The
+	first pass computes the largest step which keeps every restricted
+	basic symbol above -RatioTolerance, the second one picks among the
+	rows within that step the one with the largest coefficient for the
+	entering symbol. This keeps the pivots stable and, in degenerate
+	systems where many rows have a zero constant, avoids pivoting on
+	tiny coefficients. If `bland` is true, the row with the minimum
+	ratio and the smallest basic symbol is returned instead.
 
 	*/
-	RowMap::iterator getLeavingRow( const Symbol& entering )
+	Symbol getLeavingRow( const ColumnMap& columns, const Symbol& entering, bool bland ) const
 	{
-		double ratio = std::numeric_limits<double>::max();
-		auto end = m_rows.end();
-		auto found = m_rows.end();
-		for( auto it = m_rows.begin(); it != end; ++it )
+		auto col_it = columns.find( entering );
+		if( col_it == columns.end() )
+			return Symbol();
+		double tolerance = bland ? 0.0 : RatioTolerance;
+		double bound = std::numeric_limits<double>::max();
+		for( const auto& rowPair : col_it->second )
 		{
-			if( it->first.type() != Symbol::External )
+			if( rowPair.first.type() != Symbol::External )
 			{
-				double temp = it->second->coefficientFor( entering );
-				if( temp < 0.0 )
+				double coeff = rowPair.second->coefficientFor( entering );
+				if( coeff < 0.0 )
+					bound = std::min( bound, ( rowPair.second->constant() + tolerance ) / -coeff );
+			}
+		}
+		const Symbol* found = 0;
+		double pivot = 0.0;
+		for( const auto& rowPair : col_it->second )
+		{
+			if( rowPair.first.type() != Symbol::External )
+			{
+				double coeff = rowPair.second->coefficientFor( entering );
+				if( coeff < 0.0 && rowPair.second->constant() / -coeff <= bound )
 				{
-					double temp_ratio = -it->second->constant() / temp;
-					if( temp_ratio < ratio )
+					bool better = bland ? !found || rowPair.first < *found : -coeff > pivot;
+					if( better )
 					{
-						ratio = temp_ratio;
-						found = it;
+						found = &rowPair.first;
+						pivot = -coeff;
 					}
 				}
 			}
 		}
-		return found;
+		return found ? *found : Symbol();
 	}
 
 	/* Compute the leaving row for a marker variable.
 
-	This method will return an iterator to the row in the row map
-	which holds the given marker variable. The row will be chosen
-	according to the following precedence:
+	This method will return the basic symbol of the row which holds
+	the given marker variable. The row will be chosen according to the
+	following precedence:
 
 	1) The row with a restricted basic varible and a negative coefficient
 	   for the marker with the smallest ratio of -constant / coefficient.
@@ -725,53 +4349,57 @@ private:
 
 	3) The last unrestricted row which contains the marker.
 
-	If the marker does not exist in any row, the row map end() iterator
-	will be returned. This indicates an internal solver error since
-	the marker *should* exist somewhere in the tableau.
+	If the marker does not exist in any row, an invalid symbol will be
+	returned. This indicates an internal solver error since the marker
+	*should* exist somewhere in the tableau.
 
 	*/
-	RowMap::iterator getMarkerLeavingRow( const Symbol& marker )
+	Symbol getMarkerLeavingRow( const Symbol& marker )
 	{
+		const RowMap* column = columnOf( marker );
+		if( !column )
+			return Symbol();
 		const double dmax = std::numeric_limits<double>::max();
 		double r1 = dmax;
 		double r2 = dmax;
-		auto end = m_rows.end();
-		auto first = end;
-		auto second = end;
-		auto third = end;
-		for( auto it = m_rows.begin(); it != end; ++it )
+		const Symbol* first = 0;
+		const Symbol* second = 0;
+		const Symbol* third = 0;
+		for( const auto& rowPair : *column )
 		{
-			double c = it->second->coefficientFor( marker );
+			double c = rowPair.second->coefficientFor( marker );
 			if( c == 0.0 )
 				continue;
-			if( it->first.type() == Symbol::External )
+			if( rowPair.first.type() == Symbol::External )
 			{
-				third = it;
+				third = &rowPair.first;
 			}
 			else if( c < 0.0 )
 			{
-				double r = -it->second->constant() / c;
+				double r = -rowPair.second->constant() / c;
 				if( r < r1 )
 				{
 					r1 = r;
-					first = it;
+					first = &rowPair.first;
 				}
 			}
 			else
 			{
-				double r = it->second->constant() / c;
+				double r = rowPair.second->constant() / c;
 				if( r < r2 )
 				{
 					r2 = r;
-					second = it;
+					second = &rowPair.first;
 				}
 			}
 		}
-		if( first != end )
-			return first;
-		if( second != end )
-			return second;
-		return third;
+		if( first )
+			return *first;
+		if( second )
+			return *second;
+		if( third )
+			return *third;
+		return Symbol();
 	}
 
 	/* Remove the effects of a constraint on the objective function.
@@ -790,11 +4418,243 @@ private:
 	*/
 	void removeMarkerEffects( const Symbol& marker, double strength )
 	{
-		auto row_it = m_rows.find( marker );
-		if( row_it != m_rows.end() )
-			m_objective->insert( *row_it->second, -strength );
+		Row& objective( objectiveOf( marker ) );
+		if( const Row* row = rowOf( marker ) )
+			objective.insert( *row, -strength );
 		else
-			m_objective->insert( marker, -strength );
+			objective.insert( marker, -strength );
+	}
+
+	/* Find the root of a component.
+
+	The path to the root is halved on the way, unless a constraint is
+	being tried, see `addTrialConstraint`, or the solver holds a
+	checkpoint, whose copies of the components keep the parents they
+	had before changing.
+
+	*/
+	std::size_t findRoot( std::size_t component )
+	{
+		while( m_components[ component ].parent != component )
+		{
+			std::size_t parent = m_components[ component ].parent;
+			if( !m_trial && m_checkpoints.empty() )
+				m_components[ component ].parent = m_components[ parent ].parent;
+			component = parent;
+		}
+		return component;
+	}
+
+	/* Find the root of the component of a symbol.
+
+	NoIndex is returned if the symbol is not part of a component.
+
+	*/
+	std::size_t findComponent( const Symbol& symbol )
+	{
+		auto it = m_symbol_components.find( symbol );
+		if( it == m_symbol_components.end() )
+			return NoIndex;
+		std::size_t root = findRoot( it->second );
+		if( !m_trial && m_checkpoints.empty() )
+			it->second = root;
+		return root;
+	}
+
+	/* Make a symbol part of a component.
+
+	*/
+	void setComponent( const Symbol& symbol, std::size_t component )
+	{
+		if( m_trial )
+		{
+			auto it = m_symbol_components.find( symbol );
+			m_trial_log.push_back( std::make_pair( it == m_symbol_components.end() ? NoIndex : it->second, symbol ) );
+		}
+		saveEntry( m_undo.symbol_components, m_symbol_components, symbol );
+		m_symbol_components[ symbol ] = component;
+	}
+
+	/* Create a new, empty, component.
+
+	*/
+	std::size_t newComponent()
+	{
+		std::size_t component = m_components.size();
+		m_components.push_back( Component{ component, RowPtr( nullptr, rowDeleter() ),
+										   RowMap( resource() ), ColumnMap( resource() ) } );
+		return component;
+	}
+
+	/* Merge two components, given by their roots.
+
+	The component with fewer rows and objective cells is absorbed by the
+	other, which receives its rows, columns and objective cells.
+
+	*/
+	std::size_t mergeComponents( std::size_t first, std::size_t second )
+	{
+		if( first == second )
+			return first;
+		saveComponent( first );
+		saveComponent( second );
+		Component* big = &m_components[ first ];
+		Component* small = &m_components[ second ];
+		if( componentSize( *big ) < componentSize( *small ) )
+			std::swap( big, small );
+		if( !big->objective )
+			big->objective = std::move( small->objective );
+		else if( small->objective )
+			objectiveFor( big->parent ).insert( *small->objective );
+		small->objective.reset();
+		for( const auto& rowPair : small->rows )
+			big->rows.insert( rowPair );
+		for( auto& colPair : small->columns )
+			columnFor( big->columns, colPair.first ).swap( colPair.second );
+		RowMap rows( resource() );
+		ColumnMap columns( resource() );
+		small->rows.swap( rows );
+		small->columns.swap( columns );
+		small->parent = big->parent;
+		return big->parent;
+	}
+
+	static std::size_t componentSize( const Component& component )
+	{
+		std::size_t size = component.rows.size();
+		return component.objective ? size + component.objective->symbols().size() : size;
+	}
+
+	/* Make a symbol part of a component, merging its own component with
+	the given one. A new component is created if neither exists.
+
+	Returns the root of the resulting component.
+
+	*/
+	std::size_t joinComponent( const Symbol& symbol, std::size_t component )
+	{
+		std::size_t other = findComponent( symbol );
+		if( other == NoIndex )
+		{
+			if( component == NoIndex )
+				component = newComponent();
+			setComponent( symbol, component );
+			return component;
+		}
+		if( component == NoIndex )
+			return other;
+		return mergeComponents( component, other );
+	}
+
+	/* Merge the components of the symbols of a row, and of a basic
+	symbol unless it is invalid, into a single component.
+
+	Returns the root of that component.
+
+	*/
+	std::size_t joinComponents( const Symbol& basic, const Row& row )
+	{
+		std::size_t component = NoIndex;
+		if( basic.type() != Symbol::Invalid )
+			component = joinComponent( basic, component );
+		for( const auto& symbol : row.symbols() )
+			component = joinComponent( symbol, component );
+		if( component == NoIndex )
+			component = newComponent();
+		return component;
+	}
+
+	/* Get the objective of a component, given by its root, copying it
+	first if it is shared.
+
+	*/
+	Row& objectiveFor( std::size_t component )
+	{
+		saveComponent( component );
+		RowPtr& objective( m_components[ component ].objective );
+		if( !objective )
+			objective = makeRow( resource() );
+		else if( isShared( *objective ) )
+			objective = makeRow( *objective );
+		return *objective;
+	}
+
+	/* Get the objective of the component of a symbol.
+
+	*/
+	Row& objectiveOf( const Symbol& symbol )
+	{
+		std::size_t component = findComponent( symbol );
+		if( component == NoIndex )
+		{
+			component = newComponent();
+			setComponent( symbol, component );
+		}
+		return objectiveFor( component );
+	}
+
+	/* Record that the objective of the component of a symbol may no
+	longer be optimal.
+
+	*/
+	void markDirty( const Symbol& symbol )
+	{
+		std::size_t component = findComponent( symbol );
+		if( component != NoIndex )
+			m_dirty.push_back( component );
+	}
+
+	/* Compute the components of the tableau from scratch.
+
+	Removing a constraint may disconnect its component, which is only
+	detected here. The components are rebuilt by joining the symbols of
+	every row, then the rows, columns and objectives are split along the
+	new components. Each new component is part of a single old one, and
+	receives its rows and columns in their order. The constant of the
+	objective only serves to detect the pivots which do not improve it,
+	so it is kept whole by the first objective. The map of the components
+	of the symbols is filled anew, which drops the symbols which left the
+	tableau, so its size follows the tableau rather than the number of
+	symbols given so far.
+
+	*/
+	void splitComponents()
+	{
+		for( std::size_t i = 0, n = m_components.size(); i < n; ++i )
+			saveComponent( i );
+		ComponentList components( resource() );
+		components.swap( m_components );
+		if( !m_checkpoints.empty() )
+		{
+			for( const auto& entry : m_symbol_components )
+				m_undo.symbol_components.push_back( MapUndo<SymbolComponentMap>{ entry.first, entry.second, true } );
+		}
+		m_symbol_components.clear();
+		for( const auto& component : components )
+		{
+			for( const auto& rowPair : component.rows )
+				joinComponents( rowPair.first, *rowPair.second );
+		}
+		RowPtr objective( makeRow( resource() ) );
+		for( auto& component : components )
+		{
+			for( const auto& rowPair : component.rows )
+				m_components[ findComponent( rowPair.first ) ].rows.insert( rowPair );
+			for( auto& colPair : component.columns )
+				columnFor( m_components[ findComponent( colPair.first ) ].columns, colPair.first ).swap( colPair.second );
+			if( component.objective )
+				objective->insert( *component.objective );
+		}
+		bool first = true;
+		for( const auto& cell : objective->cells() )
+		{
+			Row& part( objectiveOf( cell.first ) );
+			part.insert( cell.first, cell.second );
+			if( first )
+				part.add( objective->constant() );
+			first = false;
+		}
+		m_removed = 0;
 	}
 
 	/* Test whether a row is composed of all dummy variables.
@@ -802,24 +4662,67 @@ private:
 	*/
 	bool allDummies( const Row& row ) const
 	{
-		for (const auto &rowPair : row.cells())
+		for (const auto &symbol : row.symbols())
 		{
-			if( rowPair.first.type() != Symbol::Dummy )
+			if( symbol.type() != Symbol::Dummy )
 				return false;
 		}
 		return true;
 	}
 
+	MemoryResource* m_resource;
 	CnMap m_cns;
-	RowMap m_rows;
+	CnSlotList m_cn_slots;
+	IndexList m_free_slots;
+	VarRefList m_refs;
+	IndexList m_free_refs;
+	std::size_t m_stale_cns;
+	std::size_t m_cn_tick;
 	VarMap m_vars;
+	IndexMap m_var_indices;
+	VariableList m_var_list;
+	SymbolList m_var_symbols;
+	ValueList m_values;
+	ValueList m_var_offsets;
+	ValueList m_var_scales;
+	IndexList m_var_next;
+	IndexList m_var_refs;
 	EditMap m_edits;
-	std::vector<Symbol> m_infeasible_rows;
-	std::unique_ptr<Row> m_objective;
-	std::unique_ptr<Row> m_artificial;
+	BoundMap m_bounds;
+	Pass m_pass;
+	ComponentList m_components;
+	SymbolComponentMap m_symbol_components;
+	IndexList m_dirty;
+	RootList m_roots;
+	IndexList m_groups;
+	ChunkList m_chunks;
+	RowList m_column_rows;
+	RowPtr m_artificial;
+	ThreadPool* m_pool;
+	std::size_t m_substitute_threshold;
+	AffineEdits m_affine;
+	EditCellList m_edit_cells;
+	BasisList m_bases;
+	SymbolList m_reach;
+	SymbolList m_reach_scratch;
+	SymbolList m_moved;
+	std::size_t m_basis_capacity;
+	std::size_t m_basis_tick;
+	std::size_t m_basis_hits;
+	std::size_t m_basis_misses;
 	Symbol::Id m_id_tick;
+	std::size_t m_removed;
+	CheckpointList m_checkpoints;
+	IndexList m_component_saves;
+	UndoLog m_undo;
+	std::size_t m_checkpoint_tick;
+	RootList m_trial_log;
+	bool m_trial;
 };
 
+template<typename MapPolicy, typename PivotRule>
+constexpr std::size_t SolverImpl<MapPolicy, PivotRule>::NoIndex;
+
 } // namespace impl
 
 } // namespace kiwi
@@ -6,6 +6,7 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <functional>
 
 
 namespace kiwi
@@ -14,6 +15,18 @@ namespace kiwi
 namespace impl
 {
 
+/* A symbol of the tableau.
+
+The type is packed in the low bits of a single 64-bit word, below the id.
+Symbols are the keys of every row and map of the solver, so keeping them
+to 8 bytes (instead of an id and an enum padded to 16 bytes) shrinks all
+the tableau structures, and comparisons stay a single integer operation.
+Ordering the packed words orders the symbols by id, since ids are unique.
+
+A Bound symbol stands for a variable with a native bound: it is the
+restricted distance of the variable to its bound, see `setBounds`.
+
+*/
 class Symbol
 {
 
@@ -27,42 +40,63 @@ public:
 		External,
 		Slack,
 		Error,
-		Dummy
+		Dummy,
+		Bound
 	};
 
-	Symbol() : m_id( 0 ), m_type( Invalid ) {}
+	Symbol() : m_bits( Invalid ) {}
 
-	Symbol( Type type, Id id ) : m_id( id ), m_type( type ) {}
+	Symbol( Type type, Id id ) : m_bits( ( id << TypeBits ) | type ) {}
 
 	~Symbol() = default;
 
 	Id id() const
 	{
-		return m_id;
+		return m_bits >> TypeBits;
 	}
 
 	Type type() const
 	{
-		return m_type;
+		return static_cast<Type>( m_bits & TypeMask );
 	}
 
 private:
 
-	Id m_id;
-	Type m_type;
+	static const unsigned TypeBits = 3;
+
+	static const Id TypeMask = ( Id( 1 ) << TypeBits ) - 1;
+
+	Id m_bits;
 
 	friend bool operator<( const Symbol& lhs, const Symbol& rhs )
 	{
-		return lhs.m_id < rhs.m_id;
+		return lhs.m_bits < rhs.m_bits;
 	}
 
 	friend bool operator==( const Symbol& lhs, const Symbol& rhs )
 	{
-		return lhs.m_id == rhs.m_id;
+		return lhs.m_bits == rhs.m_bits;
 	}
 
 };
 
+static_assert( sizeof( Symbol ) == 8, "Symbol must fit in a single 64-bit word" );
+
 } // namespace impl
 
 } // namespace kiwi
+
+
+namespace std
+{
+
+template<>
+struct hash<kiwi::impl::Symbol>
+{
+	size_t operator()( const kiwi::impl::Symbol& symbol ) const noexcept
+	{
+		return hash<kiwi::impl::Symbol::Id>()( symbol.id() );
+	}
+};
+
+} // namespace std
@@ -0,0 +1,251 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+Implementation note
+===================
+A solver given a ThreadPool runs the passes of the simplex method over its
+independent components as the tasks of a `parallelFor`. The tasks are dealt
+round-robin to a queue per thread. Each thread pops the tasks of its own
+queue from the back, and once it is empty steals from the front of the
+others, so that a few large components do not leave the other threads
+idle. The thread calling `parallelFor` takes part as the first thread.
+
+A pool runs one `parallelFor` at a time and may be shared by solvers used
+from different threads, in which case their calls wait for each other. A
+`parallelFor` called from inside a task runs its tasks inline.
+
+*/
+
+namespace kiwi
+{
+
+class ThreadPool
+{
+
+public:
+    /* Create a pool of the given number of threads, counting the thread
+    calling `parallelFor`. The default is one per hardware thread.
+
+    */
+    explicit ThreadPool(std::size_t threads = defaultThreadCount()) : m_queues(threads < 1 ? 1 : threads),
+                                                                     m_task(nullptr),
+                                                                     m_remaining(0),
+                                                                     m_generation(0),
+                                                                     m_stop(false)
+    {
+        for (auto &queue : m_queues)
+            queue.reset(new Queue);
+        for (std::size_t i = 1; i < m_queues.size(); ++i)
+            m_threads.emplace_back(&ThreadPool::work, this, i);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &thread : m_threads)
+            thread.join();
+    }
+
+    /* Get the number of threads of the pool, counting the calling thread.
+
+    */
+    std::size_t size() const
+    {
+        return m_queues.size();
+    }
+
+    /* Call `task(i)` for each i in [0, count), in parallel.
+
+    Returns once every call returned. If calls throw, the first exception
+    caught is rethrown once all the calls are done.
+
+    */
+    template <typename Task>
+    void parallelFor(std::size_t count, const Task &task)
+    {
+        if (count == 0)
+            return;
+        if (count == 1 || m_threads.empty() || insideTask())
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                task(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> batch(m_batch);
+        Runner<Task> runner(task);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &runner;
+            m_remaining = count;
+            m_error = std::exception_ptr();
+        }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Queue &queue(*m_queues[i % m_queues.size()]);
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(i);
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        runTasks(0);
+
+        std::exception_ptr error;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait(lock, [this] { return m_remaining == 0; });
+            m_task = nullptr;
+            error = m_error;
+            m_error = std::exception_ptr();
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /* Get the number of hardware threads, or 1 if it is unknown.
+
+    */
+    static std::size_t defaultThreadCount()
+    {
+        std::size_t count = std::thread::hardware_concurrency();
+        return count < 1 ? 1 : count;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    struct RunnerBase
+    {
+        virtual ~RunnerBase() {}
+        virtual void run(std::size_t index) const = 0;
+    };
+
+    template <typename Task>
+    struct Runner : RunnerBase
+    {
+        explicit Runner(const Task &task) : task(task) {}
+        void run(std::size_t index) const override { task(index); }
+        const Task &task;
+    };
+
+    ThreadPool(const ThreadPool &);
+
+    ThreadPool &operator=(const ThreadPool &);
+
+    static bool &insideTask()
+    {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    void work(std::size_t self)
+    {
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+            lock.unlock();
+            runTasks(self);
+            lock.lock();
+        }
+    }
+
+    /* Take the next task for a thread: the last one of its own queue, or
+    the first one of another queue.
+
+    */
+    bool takeTask(std::size_t self, std::size_t &index)
+    {
+        for (std::size_t i = 0, n = m_queues.size(); i < n; ++i)
+        {
+            Queue &queue(*m_queues[(self + i) % n]);
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+                continue;
+            if (i == 0)
+            {
+                index = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            else
+            {
+                index = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void runTasks(std::size_t self)
+    {
+        std::size_t index;
+        insideTask() = true;
+        while (takeTask(self, index))
+        {
+            try
+            {
+                m_task->run(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+            }
+            if (--m_remaining == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.notify_all();
+            }
+        }
+        insideTask() = false;
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::mutex m_batch;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const RunnerBase *m_task;
+    std::atomic<std::size_t> m_remaining;
+    std::exception_ptr m_error;
+    std::size_t m_generation;
+    bool m_stop;
+};
+
+} // namespace kiwi
@@ -6,6 +6,7 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <functional>
 #include <memory>
 #include <string>
 #include "shareddata.h"
@@ -72,7 +73,7 @@ public:
     }
 
     // operator== is used for symbolics
-    bool equals(const Variable &other)
+    bool equals(const Variable &other) const
     {
         return m_data == other.m_data;
     }
@@ -110,6 +111,8 @@ private:
 
     SharedDataPtr<VariableData> m_data;
 
+    friend struct std::hash<Variable>;
+
     friend bool operator<(const Variable &lhs, const Variable &rhs)
     {
         return lhs.m_data < rhs.m_data;
@@ -117,3 +120,17 @@ private:
 };
 
 } // namespace kiwi
+
+namespace std
+{
+
+template <>
+struct hash<kiwi::Variable>
+{
+    size_t operator()(const kiwi::Variable &variable) const noexcept
+    {
+        return hash<const void *>()(variable.m_data.data());
+    }
+};
+
+} // namespace std
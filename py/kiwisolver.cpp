@@ -42,6 +42,10 @@ bool ready_types( HPyContext *ctx, HPy m )
     {
         return false;
     }
+    if( !Checkpoint::Ready( ctx, m ) )
+    {
+        return false;
+    }
     return true;
 }
 
@@ -115,6 +119,7 @@ static HPyGlobal *globals[] = {
     &kiwisolver::Expression::TypeObject,
     &kiwisolver::Constraint::TypeObject,
     &kiwisolver::Solver::TypeObject,
+    &kiwisolver::Checkpoint::TypeObject,
     NULL,
 };
 
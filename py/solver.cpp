@@ -6,6 +6,9 @@
 |
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
+#include <functional>
+#include <utility>
+#include <vector>
 #include <kiwi/kiwi.h>
 #include "types.h"
 #include "util.h"
@@ -29,20 +32,105 @@ Solver_new_impl( HPyContext *ctx, HPy type, const HPy *args, HPy_ssize_t nargs,
 	HPy pysolver = HPy_New( ctx, type, &self );
 	if( HPy_IsNull( pysolver ) )
 		return HPy_NULL;
+	self->value_count = 0;
+	self->exports = 0;
 	new( &self->solver ) kiwi::Solver();
+	HPy registry = HPyDict_New( ctx );
+	if( HPy_IsNull( registry ) )
+	{
+		HPy_Close( ctx, pysolver );
+		return HPy_NULL;
+	}
+	HPyField_Store( ctx, pysolver, &self->variables, registry );
+	HPy_Close( ctx, registry );
 	return pysolver;
 }
 
 
+HPyDef_SLOT(Solver_traverse, HPy_tp_traverse)
+static int
+Solver_traverse_impl( void* obj, HPyFunc_visitproc visit, void* arg )
+{
+    Solver* self = (Solver*) obj;
+	HPy_VISIT( &self->variables );
+	return 0;
+}
+
+
 HPyDef_SLOT(Solver_dealloc, HPy_tp_destroy)
 static void
 Solver_dealloc_impl( void *obj )
 {
     Solver* self = (Solver*)obj;
-	self->solver.~Solver();
+	self->solver.~BasicSolver();
 	// Py_TYPE( self )->tp_free( pyobject_cast( self ) );
 }
 
+/* Export the values of the variables through the buffer protocol.
+
+The buffer is a read-only one dimensional array of doubles, ordered as the
+list returned by `variables`. It reflects the values written by the last
+update of the variables. While a buffer is exported the number of variables
+cannot change, so the methods which may add or drop variables raise a
+BufferError.
+
+*/
+HPyDef_SLOT(Solver_getbuffer, HPy_bf_getbuffer)
+static int
+Solver_getbuffer_impl( HPyContext *ctx, HPy h_self, HPy_buffer* buffer, int flags )
+{
+	if( flags & HPyBUF_WRITABLE )
+	{
+		HPyErr_SetString( ctx, ctx->h_BufferError, "Solver values are read-only." );
+		return -1;
+	}
+	static double empty = 0.0;
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	kiwi::ArrayView<double> values( self->solver.values() );
+	self->value_count = static_cast<HPy_ssize_t>( values.size() );
+	buffer->buf = values.empty() ? &empty : const_cast<double*>( values.data() );
+	buffer->obj = HPy_Dup( ctx, h_self );
+	buffer->len = self->value_count * static_cast<HPy_ssize_t>( sizeof( double ) );
+	buffer->itemsize = sizeof( double );
+	buffer->readonly = 1;
+	buffer->ndim = 1;
+	buffer->format = ( flags & HPyBUF_FORMAT ) ? const_cast<char*>( "d" ) : NULL;
+	buffer->shape = ( flags & HPyBUF_ND ) == HPyBUF_ND ? &self->value_count : NULL;
+	buffer->strides = ( flags & HPyBUF_STRIDES ) == HPyBUF_STRIDES ? &buffer->itemsize : NULL;
+	buffer->suboffsets = NULL;
+	buffer->internal = NULL;
+	++self->exports;
+	return 0;
+}
+
+
+HPyDef_SLOT(Solver_releasebuffer, HPy_bf_releasebuffer)
+static void
+Solver_releasebuffer_impl( HPyContext *ctx, HPy h_self, HPy_buffer* buffer )
+{
+	--Solver_AsStruct( ctx, h_self )->exports;
+}
+
+
+/* Refuse an operation which may resize the values while they are exported.
+
+Removing a constraint drops the variables no other constraint refers to, so
+removals are refused as well as additions.
+
+*/
+static bool
+checkNotExported( HPyContext *ctx, Solver* self )
+{
+	if( self->exports > 0 )
+	{
+		HPyErr_SetString( ctx, ctx->h_BufferError,
+			"Cannot change the variables of the solver while its values are exported." );
+		return false;
+	}
+	return true;
+}
+
+
 static void
 setObjectFromGlobal( HPyContext *ctx , HPyGlobal ex_type , HPy obj )
 {
@@ -52,6 +140,226 @@ setObjectFromGlobal( HPyContext *ctx , HPyGlobal ex_type , HPy obj )
 }
 
 
+/* Raise the exception with a Python constraint for a bound of a variable.
+
+The kiwi constraint of the bound has a single term, for the variable.
+
+*/
+static void
+setBoundFromGlobal( HPyContext *ctx, HPyGlobal ex_type, HPy pyvar, const kiwi::Constraint& bound )
+{
+	const kiwi::Expression& expr( bound.expression() );
+	Term* term;
+	HPy pyterm = new_from_global( ctx, Term::TypeObject, &term );
+	if( HPy_IsNull( pyterm ) )
+		return;
+	HPyField_Store( ctx, pyterm, &term->variable, pyvar );
+	term->coefficient = expr.terms().front().coefficient();
+	HPy pyterms = HPyTuple_FromArray( ctx, &pyterm, 1 );
+	HPy_Close( ctx, pyterm );
+	if( HPy_IsNull( pyterms ) )
+		return;
+	Expression* expression;
+	HPy pyexpr = new_from_global( ctx, Expression::TypeObject, &expression );
+	if( HPy_IsNull( pyexpr ) )
+	{
+		HPy_Close( ctx, pyterms );
+		return;
+	}
+	HPyField_Store( ctx, pyexpr, &expression->terms, pyterms );
+	HPy_Close( ctx, pyterms );
+	expression->constant = expr.constant();
+	Constraint* cn;
+	HPy pycn = new_from_global( ctx, Constraint::TypeObject, &cn );
+	if( HPy_IsNull( pycn ) )
+	{
+		HPy_Close( ctx, pyexpr );
+		return;
+	}
+	HPyField_Store( ctx, pycn, &cn->expression, pyexpr );
+	HPy_Close( ctx, pyexpr );
+	new( &cn->constraint ) kiwi::Constraint( bound );
+	setObjectFromGlobal( ctx, ex_type, pycn );
+	HPy_Close( ctx, pycn );
+}
+
+
+/* Get the key of a variable in the registry of the solver.
+
+The solver only knows the kiwi variables. The registry maps the shared
+data of each of them, which identifies the variable, back to its Python
+object so that updateChangedVariables can return the Python objects.
+
+*/
+static HPy
+variableKey( HPyContext *ctx, const kiwi::Variable& variable )
+{
+	return HPyLong_FromSize_t( ctx, std::hash<kiwi::Variable>()( variable ) );
+}
+
+
+static bool
+registerVariable( HPyContext *ctx, HPy h_self, HPy pyvar )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy key = variableKey( ctx, Variable::AsStruct( ctx, pyvar )->variable );
+	if( HPy_IsNull( key ) )
+		return false;
+	HPy registry = HPyField_Load( ctx, h_self, self->variables );
+	int result = HPy_SetItem( ctx, registry, key, pyvar );
+	HPy_Close( ctx, registry );
+	HPy_Close( ctx, key );
+	return result == 0;
+}
+
+
+/* Build the list of the Python objects of some kiwi variables.
+
+*/
+static HPy
+variableList( HPyContext *ctx, HPy h_self, const kiwi::Variable* variables, std::size_t count )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy registry = HPyField_Load( ctx, h_self, self->variables );
+	HPyListBuilder list = HPyListBuilder_New( ctx, static_cast<HPy_ssize_t>( count ) );
+	for( std::size_t i = 0; i < count; ++i )
+	{
+		HPy key = variableKey( ctx, variables[ i ] );
+		HPy pyvar = HPy_IsNull( key ) ? HPy_NULL : HPy_GetItem( ctx, registry, key );
+		HPy_Close( ctx, key );
+		if( HPy_IsNull( pyvar ) )
+		{
+			HPyListBuilder_Cancel( ctx, list );
+			HPy_Close( ctx, registry );
+			return HPy_NULL;
+		}
+		HPyListBuilder_Set( ctx, list, static_cast<HPy_ssize_t>( i ), pyvar );
+		HPy_Close( ctx, pyvar );
+	}
+	HPy_Close( ctx, registry );
+	return HPyListBuilder_Build( ctx, list );
+}
+
+
+/* Rebuild the registry from the variables of the solver once enough of its
+entries are stale.
+
+The solver drops the variables which no constraint refers to anymore, but
+the registry keeps their Python objects alive. Rebuilding it when it holds
+more than twice the live variables keeps the cost amortized. The registry is
+kept whole while the solver holds a checkpoint, as rolling back brings back
+the variables dropped since.
+
+*/
+static bool
+pruneRegistry( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	if( self->solver.checkpointCount() > 0 )
+		return true;
+	kiwi::ArrayView<kiwi::Variable> variables( self->solver.variables() );
+	HPy registry = HPyField_Load( ctx, h_self, self->variables );
+	HPy_ssize_t size = HPy_Length( ctx, registry );
+	if( size < 0 || static_cast<std::size_t>( size ) <= 2 * variables.size() + 64 )
+	{
+		HPy_Close( ctx, registry );
+		return size >= 0;
+	}
+	HPy pruned = HPyDict_New( ctx );
+	bool ok = !HPy_IsNull( pruned );
+	for( std::size_t i = 0; ok && i < variables.size(); ++i )
+	{
+		HPy key = variableKey( ctx, variables[ i ] );
+		HPy pyvar = HPy_IsNull( key ) ? HPy_NULL : HPy_GetItem( ctx, registry, key );
+		ok = !HPy_IsNull( pyvar ) && HPy_SetItem( ctx, pruned, key, pyvar ) == 0;
+		HPy_Close( ctx, pyvar );
+		HPy_Close( ctx, key );
+	}
+	if( ok )
+		HPyField_Store( ctx, h_self, &self->variables, pruned );
+	HPy_Close( ctx, pruned );
+	HPy_Close( ctx, registry );
+	return ok;
+}
+
+
+/* Convert a sequence of Python variables into kiwi variables.
+
+*/
+static bool
+variableVector( HPyContext *ctx, HPy sequence, std::vector<kiwi::Variable>& variables )
+{
+	HPy_ssize_t end = HPy_Length( ctx, sequence );
+	if( end < 0 )
+		return false;
+	variables.reserve( end );
+	for( HPy_ssize_t i = 0; i < end; ++i )
+	{
+		HPy item = HPy_GetItem_i( ctx, sequence, i );
+		if( HPy_IsNull( item ) )
+			return false;
+		if( !Variable::TypeCheck( ctx, item ) ) {
+			HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`." );
+			HPy_Close( ctx, item );
+			return false;
+		}
+		variables.push_back( Variable::AsStruct( ctx, item )->variable );
+		HPy_Close( ctx, item );
+	}
+	return true;
+}
+
+
+/* Raise UnknownEditVariable with the Python variable of a sequence which
+is the given kiwi variable.
+
+*/
+static void
+setUnknownEditVariable( HPyContext *ctx, HPy sequence, const std::vector<kiwi::Variable>& variables,
+						const kiwi::UnknownEditVariable& e )
+{
+	HPy_ssize_t index = 0;
+	while( !variables[ index ].equals( e.variable() ) )
+		++index;
+	HPy pyvar = HPy_GetItem_i( ctx, sequence, index );
+	if( !HPy_IsNull( pyvar ) )
+	{
+		setObjectFromGlobal( ctx, UnknownEditVariable, pyvar );
+		HPy_Close( ctx, pyvar );
+	}
+}
+
+
+/* Register the variables of the terms of a constraint.
+
+*/
+static bool
+registerConstraintVariables( HPyContext *ctx, HPy h_self, HPy pycn )
+{
+	Constraint* cn = Constraint_AsStruct( ctx, pycn );
+	HPy h_expr = HPyField_Load( ctx, pycn, cn->expression );
+	HPy expr_terms = HPyField_Load( ctx, h_expr, Expression_AsStruct( ctx, h_expr )->terms );
+	HPy_Close( ctx, h_expr );
+	HPy_ssize_t size = HPy_Length( ctx, expr_terms );
+	bool success = size >= 0;
+	for( HPy_ssize_t i = 0; success && i < size; ++i )
+	{
+		HPy item = HPy_GetItem_i( ctx, expr_terms, i );
+		if( HPy_IsNull( item ) )
+		{
+			success = false;
+			break;
+		}
+		HPy var = HPyField_Load( ctx, item, Term::AsStruct( ctx, item )->variable );
+		success = registerVariable( ctx, h_self, var );
+		HPy_Close( ctx, var );
+		HPy_Close( ctx, item );
+	}
+	HPy_Close( ctx, expr_terms );
+	return success;
+}
+
+
 HPyDef_METH(Solver_addConstraint, "addConstraint", HPyFunc_O,
 	.doc = "Add a constraint to the solver.")
 static HPy
@@ -68,6 +376,8 @@ Solver_addConstraint_impl( HPyContext *ctx, HPy h_self, HPy other )
 			"Expected object of type `Constraint`.");
 		return HPy_NULL;
 	}
+	if( !checkNotExported( ctx, self ) || !registerConstraintVariables( ctx, h_self, other ) )
+		return HPy_NULL;
 	Constraint* cn = Constraint_AsStruct( ctx, other );
 	try
 	{
@@ -101,6 +411,8 @@ Solver_removeConstraint_impl( HPyContext *ctx, HPy h_self, HPy other )
 		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Constraint`." );
 		return HPy_NULL;
 	}
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
 	Constraint* cn = Constraint_AsStruct( ctx, other );
 	try
 	{
@@ -111,6 +423,175 @@ Solver_removeConstraint_impl( HPyContext *ctx, HPy h_self, HPy other )
 		setObjectFromGlobal( ctx, UnknownConstraint, other );
 		return HPy_NULL;
 	}
+	if( !pruneRegistry( ctx, h_self ) )
+		return HPy_NULL;
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+/* Get the string standing for the status of a try method.
+
+*/
+static HPy
+statusString( HPyContext *ctx, kiwi::Status status )
+{
+	switch( status )
+	{
+		case kiwi::STATUS_DUPLICATE_CONSTRAINT:
+			return HPyUnicode_FromString( ctx, "duplicate" );
+		case kiwi::STATUS_UNSATISFIABLE_CONSTRAINT:
+			return HPyUnicode_FromString( ctx, "unsatisfiable" );
+		case kiwi::STATUS_UNKNOWN_CONSTRAINT:
+		case kiwi::STATUS_UNKNOWN_EDIT_VARIABLE:
+			return HPyUnicode_FromString( ctx, "unknown" );
+		default:
+			return HPyUnicode_FromString( ctx, "ok" );
+	}
+}
+
+
+HPyDef_METH(Solver_tryAddConstraint, "tryAddConstraint", HPyFunc_O,
+	.doc = "Add a constraint to the solver, returning 'ok', 'duplicate' or 'unsatisfiable'.")
+static HPy
+Solver_tryAddConstraint_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	if( !Constraint::TypeCheck( ctx, other ) ) {
+		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Constraint`." );
+		return HPy_NULL;
+	}
+	if( !checkNotExported( ctx, self ) || !registerConstraintVariables( ctx, h_self, other ) )
+		return HPy_NULL;
+	Constraint* cn = Constraint_AsStruct( ctx, other );
+	return statusString( ctx, self->solver.tryAddConstraint( cn->constraint ) );
+}
+
+
+HPyDef_METH(Solver_tryRemoveConstraint, "tryRemoveConstraint", HPyFunc_O,
+	.doc = "Remove a constraint from the solver, returning 'ok' or 'unknown'.")
+static HPy
+Solver_tryRemoveConstraint_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	if( !Constraint::TypeCheck( ctx, other ) ) {
+		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Constraint`." );
+		return HPy_NULL;
+	}
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
+	Constraint* cn = Constraint_AsStruct( ctx, other );
+	kiwi::Status status = self->solver.tryRemoveConstraint( cn->constraint );
+	if( !pruneRegistry( ctx, h_self ) )
+		return HPy_NULL;
+	return statusString( ctx, status );
+}
+
+
+/* Convert a sequence of Constraint objects to kiwi constraints.
+
+*/
+static bool
+convertConstraints( HPyContext *ctx, HPy sequence, std::vector<kiwi::Constraint>& constraints )
+{
+	HPy_ssize_t end = HPy_Length( ctx, sequence );
+	if( end < 0 )
+		return false;
+	constraints.reserve( end );
+	for( HPy_ssize_t i = 0; i < end; ++i )
+	{
+		HPy item = HPy_GetItem_i( ctx, sequence, i );
+		if( HPy_IsNull( item ) )
+			return false;
+		if( !Constraint::TypeCheck( ctx, item ) ) {
+			HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Constraint`." );
+			HPy_Close( ctx, item );
+			return false;
+		}
+		constraints.push_back( Constraint_AsStruct( ctx, item )->constraint );
+		HPy_Close( ctx, item );
+	}
+	return true;
+}
+
+
+/* Raise the given exception for the item of the sequence holding a constraint.
+
+*/
+static void
+setConstraintFromGlobal( HPyContext *ctx, HPyGlobal ex_type, HPy sequence,
+	const std::vector<kiwi::Constraint>& constraints, const kiwi::Constraint& constraint )
+{
+	HPy_ssize_t index = 0;
+	HPy_ssize_t end = static_cast<HPy_ssize_t>( constraints.size() );
+	while( index < end && !( constraints[ index ] == constraint ) )
+		++index;
+	HPy item = HPy_GetItem_i( ctx, sequence, index );
+	if( HPy_IsNull( item ) )
+		return;
+	setObjectFromGlobal( ctx, ex_type, item );
+	HPy_Close( ctx, item );
+}
+
+
+HPyDef_METH(Solver_addConstraints, "addConstraints", HPyFunc_O,
+	.doc = "Add a sequence of constraints to the solver and optimize once.")
+static HPy
+Solver_addConstraints_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
+	std::vector<kiwi::Constraint> constraints;
+	if( !convertConstraints( ctx, other, constraints ) )
+		return HPy_NULL;
+	for( HPy_ssize_t i = 0, end = static_cast<HPy_ssize_t>( constraints.size() ); i < end; ++i )
+	{
+		HPy item = HPy_GetItem_i( ctx, other, i );
+		bool registered = !HPy_IsNull( item ) && registerConstraintVariables( ctx, h_self, item );
+		HPy_Close( ctx, item );
+		if( !registered )
+			return HPy_NULL;
+	}
+	try
+	{
+		self->solver.addConstraints( constraints );
+	}
+	catch( const kiwi::DuplicateConstraint& e )
+	{
+		setConstraintFromGlobal( ctx, DuplicateConstraint, other, constraints, e.constraint() );
+		return HPy_NULL;
+	}
+	catch( const kiwi::UnsatisfiableConstraint& e )
+	{
+		setConstraintFromGlobal( ctx, UnsatisfiableConstraint, other, constraints, e.constraint() );
+		return HPy_NULL;
+	}
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+HPyDef_METH(Solver_removeConstraints, "removeConstraints", HPyFunc_O,
+	.doc = "Remove a sequence of constraints from the solver and optimize once.")
+static HPy
+Solver_removeConstraints_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
+	std::vector<kiwi::Constraint> constraints;
+	if( !convertConstraints( ctx, other, constraints ) )
+		return HPy_NULL;
+	try
+	{
+		self->solver.removeConstraints( constraints );
+	}
+	catch( const kiwi::UnknownConstraint& e )
+	{
+		setConstraintFromGlobal( ctx, UnknownConstraint, other, constraints, e.constraint() );
+		return HPy_NULL;
+	}
+	if( !pruneRegistry( ctx, h_self ) )
+		return HPy_NULL;
 	return HPy_Dup( ctx, ctx->h_None );
 }
 
@@ -152,9 +633,13 @@ Solver_addEditVariable_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_
 		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`.");
 		return HPy_NULL;
 	}
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
 	double strength;
 	if( !convert_to_strength( ctx, pystrength, strength ) )
 		return HPy_NULL;
+	if( !registerVariable( ctx, h_self, pyvar ) )
+		return HPy_NULL;
 	Variable* var = Variable::AsStruct( ctx, pyvar );
 	try
 	{
@@ -190,6 +675,8 @@ Solver_removeEditVariable_impl( HPyContext *ctx, HPy h_self, HPy other )
 		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`." );
 		return HPy_NULL;
 	}
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
 	Variable* var = Variable::AsStruct( ctx, other );
 	try
 	{
@@ -200,6 +687,28 @@ Solver_removeEditVariable_impl( HPyContext *ctx, HPy h_self, HPy other )
 		setObjectFromGlobal( ctx, UnknownEditVariable, other );
 		return HPy_NULL;
 	}
+	if( !pruneRegistry( ctx, h_self ) )
+		return HPy_NULL;
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+HPyDef_METH(Solver_removeVariable, "removeVariable", HPyFunc_O,
+	.doc = "Remove a variable from the solver along with its constraints, edit and bounds.")
+static HPy
+Solver_removeVariable_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	if( !Variable::TypeCheck( ctx, other ) ) {
+		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`." );
+		return HPy_NULL;
+	}
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
+	Variable* var = Variable::AsStruct( ctx, other );
+	self->solver.removeVariable( var->variable );
+	if( !pruneRegistry( ctx, h_self ) )
+		return HPy_NULL;
 	return HPy_Dup( ctx, ctx->h_None );
 }
 
@@ -258,6 +767,373 @@ Solver_suggestValue_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_t n
 }
 
 
+HPyDef_METH(Solver_trySuggestValue, "trySuggestValue", HPyFunc_VARARGS,
+	.doc = "Suggest a value for an edit variable, returning 'ok' or 'unknown'.")
+static HPy
+Solver_trySuggestValue_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_t nargs )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy pyvar;
+	HPy pyvalue;
+	if( !HPyArg_Parse(ctx, NULL, args, nargs, "OO", &pyvar, &pyvalue ) )
+		return HPy_NULL;
+	if( !Variable::TypeCheck( ctx, pyvar ) ) {
+		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`." );
+		return HPy_NULL;
+	}
+	double value;
+	if( !convert_to_double( ctx, pyvalue, value ) )
+		return HPy_NULL;
+	Variable* var = Variable::AsStruct( ctx, pyvar );
+	return statusString( ctx, self->solver.trySuggestValue( var->variable, value ) );
+}
+
+
+/* Convert the arguments of suggestValues to pairs of variable and value.
+
+The suggestions are either a sequence of (variable, value) pairs, or a
+sequence of variables and a sequence of values of the same length.
+
+*/
+static bool
+convertSuggestions( HPyContext *ctx, HPy pyvars, HPy pyvalues,
+	std::vector<std::pair<kiwi::Variable, double>>& suggestions )
+{
+	HPy_ssize_t end = HPy_Length( ctx, pyvars );
+	if( end < 0 )
+		return false;
+	if( !HPy_IsNull( pyvalues ) )
+	{
+		HPy_ssize_t count = HPy_Length( ctx, pyvalues );
+		if( count < 0 )
+			return false;
+		if( count != end ) {
+			HPyErr_SetString( ctx, ctx->h_ValueError, "Expected as many values as variables." );
+			return false;
+		}
+	}
+	suggestions.reserve( end );
+	for( HPy_ssize_t i = 0; i < end; ++i )
+	{
+		HPy pyvar;
+		HPy pyvalue;
+		if( HPy_IsNull( pyvalues ) )
+		{
+			HPy pair = HPy_GetItem_i( ctx, pyvars, i );
+			if( HPy_IsNull( pair ) )
+				return false;
+			if( HPy_Length( ctx, pair ) != 2 ) {
+				HPyErr_SetString( ctx, ctx->h_TypeError, "Expected a sequence of (Variable, value) pairs." );
+				HPy_Close( ctx, pair );
+				return false;
+			}
+			pyvar = HPy_GetItem_i( ctx, pair, 0 );
+			pyvalue = HPy_GetItem_i( ctx, pair, 1 );
+			HPy_Close( ctx, pair );
+		}
+		else
+		{
+			pyvar = HPy_GetItem_i( ctx, pyvars, i );
+			pyvalue = HPy_GetItem_i( ctx, pyvalues, i );
+		}
+		bool valid = false;
+		double value;
+		if( HPy_IsNull( pyvar ) || HPy_IsNull( pyvalue ) )
+			valid = false;
+		else if( !Variable::TypeCheck( ctx, pyvar ) )
+			HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`." );
+		else if( convert_to_double( ctx, pyvalue, value ) )
+		{
+			suggestions.push_back( std::make_pair( Variable::AsStruct( ctx, pyvar )->variable, value ) );
+			valid = true;
+		}
+		HPy_Close( ctx, pyvar );
+		HPy_Close( ctx, pyvalue );
+		if( !valid )
+			return false;
+	}
+	return true;
+}
+
+
+HPyDef_METH(Solver_suggestValues, "suggestValues", HPyFunc_VARARGS,
+	.doc = "Suggest desired values for several edit variables at once.\n\n"
+	       "Accepts a sequence of (variable, value) pairs, or a sequence of "
+	       "variables and a sequence of values such as an array.")
+static HPy
+Solver_suggestValues_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_t nargs )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy pyvars;
+	HPy pyvalues = HPy_NULL;
+	if( !HPyArg_Parse(ctx, NULL, args, nargs, "O|O", &pyvars, &pyvalues ) )
+		return HPy_NULL;
+	std::vector<std::pair<kiwi::Variable, double>> suggestions;
+	if( !convertSuggestions( ctx, pyvars, pyvalues, suggestions ) )
+		return HPy_NULL;
+	try
+	{
+		self->solver.suggestValues( suggestions );
+	}
+	catch( const kiwi::UnknownEditVariable& e )
+	{
+		HPy_ssize_t index = 0;
+		while( !suggestions[ index ].first.equals( e.variable() ) )
+			++index;
+		HPy pyvar = HPy_GetItem_i( ctx, pyvars, index );
+		if( !HPy_IsNull( pyvar ) && HPy_IsNull( pyvalues ) )
+		{
+			HPy pair = pyvar;
+			pyvar = HPy_GetItem_i( ctx, pair, 0 );
+			HPy_Close( ctx, pair );
+		}
+		if( !HPy_IsNull( pyvar ) )
+		{
+			setObjectFromGlobal( ctx, UnknownEditVariable, pyvar );
+			HPy_Close( ctx, pyvar );
+		}
+		return HPy_NULL;
+	}
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+HPyDef_METH(Solver_setAffineEdits, "setAffineEdits", HPyFunc_O,
+	.doc = "Answer the suggestions of a sequence of edit variables without pivoting\n\n"
+	       "While they keep the basis of the solver feasible, the suggestions are "
+	       "answered from its sensitivity to the edit variables. An empty sequence "
+	       "answers every suggestion normally again.")
+static HPy
+Solver_setAffineEdits_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	std::vector<kiwi::Variable> variables;
+	if( !variableVector( ctx, other, variables ) )
+		return HPy_NULL;
+	try
+	{
+		self->solver.setAffineEdits( variables );
+	}
+	catch( const kiwi::UnknownEditVariable& e )
+	{
+		setUnknownEditVariable( ctx, other, variables, e );
+		return HPy_NULL;
+	}
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+HPyDef_METH(Solver_affineEdits, "affineEdits", HPyFunc_NOARGS,
+	.doc = "Get the edit variables whose suggestions are answered without pivoting.")
+static HPy
+Solver_affineEdits_impl( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	kiwi::ArrayView<kiwi::Variable> variables( self->solver.affineEdits() );
+	return variableList( ctx, h_self, variables.data(), variables.size() );
+}
+
+
+HPyDef_METH(Solver_setBasisCacheSize, "setBasisCacheSize", HPyFunc_O,
+	.doc = "Set the number of bases of the affine edits kept in a cache\n\n"
+	       "A suggestion of the affine edits leaving the feasible region of the "
+	       "basis is answered from a cached basis feasible for it, if any, "
+	       "instead of pivoting. A size of 0 disables the cache.")
+static HPy
+Solver_setBasisCacheSize_impl( HPyContext *ctx, HPy h_self, HPy other )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	size_t size = HPyLong_AsSize_t( ctx, other );
+	if( size == static_cast<size_t>( -1 ) && HPyErr_Occurred( ctx ) )
+		return HPy_NULL;
+	self->solver.setBasisCacheSize( size );
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+static bool
+setStat( HPyContext *ctx, HPy dict, const char* key, std::size_t value )
+{
+	HPy pyvalue = HPyLong_FromSize_t( ctx, value );
+	if( HPy_IsNull( pyvalue ) )
+		return false;
+	int result = HPy_SetItem_s( ctx, dict, key, pyvalue );
+	HPy_Close( ctx, pyvalue );
+	return result == 0;
+}
+
+
+HPyDef_METH(Solver_basisCacheStats, "basisCacheStats", HPyFunc_NOARGS,
+	.doc = "Get the hits, misses, entries and memory use of the cache of bases as a dict.")
+static HPy
+Solver_basisCacheStats_impl( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	kiwi::BasisCacheStats stats( self->solver.basisCacheStats() );
+	HPy dict = HPyDict_New( ctx );
+	if( HPy_IsNull( dict ) )
+		return HPy_NULL;
+	if( !setStat( ctx, dict, "hits", stats.hits ) ||
+		!setStat( ctx, dict, "misses", stats.misses ) ||
+		!setStat( ctx, dict, "entries", stats.entries ) ||
+		!setStat( ctx, dict, "memory", stats.memory ) )
+	{
+		HPy_Close( ctx, dict );
+		return HPy_NULL;
+	}
+	return dict;
+}
+
+
+/* Read a sequence of rows of numbers into a dense row-major matrix.
+
+*/
+static bool
+valueMatrix( HPyContext *ctx, HPy rows, std::size_t columns, std::vector<double>& values )
+{
+	HPy_ssize_t count = HPy_Length( ctx, rows );
+	if( count < 0 )
+		return false;
+	values.reserve( count * columns );
+	for( HPy_ssize_t i = 0; i < count; ++i )
+	{
+		HPy row = HPy_GetItem_i( ctx, rows, i );
+		if( HPy_IsNull( row ) )
+			return false;
+		HPy_ssize_t size = HPy_Length( ctx, row );
+		if( size >= 0 && static_cast<std::size_t>( size ) != columns )
+			HPyErr_SetString( ctx, ctx->h_ValueError, "Expected one value per edit variable in each scenario." );
+		for( HPy_ssize_t j = 0; !HPyErr_Occurred( ctx ) && j < size; ++j )
+		{
+			HPy item = HPy_GetItem_i( ctx, row, j );
+			if( HPy_IsNull( item ) )
+				break;
+			values.push_back( HPyFloat_AsDouble( ctx, item ) );
+			HPy_Close( ctx, item );
+		}
+		HPy_Close( ctx, row );
+		if( HPyErr_Occurred( ctx ) )
+			return false;
+	}
+	return true;
+}
+
+
+/* Wrap a dense row-major matrix into a read-only two dimensional
+memoryview of doubles, or a one dimensional one if it is empty, as
+memoryview cannot have zeros in its shape.
+
+*/
+static HPy
+matrixView( HPyContext *ctx, const std::vector<double>& values, std::size_t rows, std::size_t columns )
+{
+	HPy bytes = HPyBytes_FromStringAndSize(
+		ctx, reinterpret_cast<const char*>( values.data() ), values.size() * sizeof( double ) );
+	if( HPy_IsNull( bytes ) )
+		return HPy_NULL;
+	HPy view = HPy_NULL;
+	HPy builtins = HPyImport_ImportModule( ctx, "builtins" );
+	HPy memoryview = HPy_IsNull( builtins ) ? HPy_NULL : HPy_GetAttr_s( ctx, builtins, "memoryview" );
+	HPy bytesargs = HPy_IsNull( memoryview ) ? HPy_NULL : HPyTuple_Pack( ctx, 1, bytes );
+	HPy bytesview = HPy_IsNull( bytesargs ) ? HPy_NULL : HPy_CallTupleDict( ctx, memoryview, bytesargs, HPy_NULL );
+	HPy cast = HPy_IsNull( bytesview ) ? HPy_NULL : HPy_GetAttr_s( ctx, bytesview, "cast" );
+	if( !HPy_IsNull( cast ) )
+	{
+		HPy format = HPyUnicode_FromString( ctx, "d" );
+		HPy row_count = HPyLong_FromSize_t( ctx, rows );
+		HPy column_count = HPyLong_FromSize_t( ctx, columns );
+		HPy shape = HPyTuple_Pack( ctx, 2, row_count, column_count );
+		HPy args = values.empty() ? HPyTuple_Pack( ctx, 1, format ) : HPyTuple_Pack( ctx, 2, format, shape );
+		view = HPy_CallTupleDict( ctx, cast, args, HPy_NULL );
+		HPy_Close( ctx, args );
+		HPy_Close( ctx, shape );
+		HPy_Close( ctx, column_count );
+		HPy_Close( ctx, row_count );
+		HPy_Close( ctx, format );
+		HPy_Close( ctx, cast );
+	}
+	HPy_Close( ctx, bytesview );
+	HPy_Close( ctx, bytesargs );
+	HPy_Close( ctx, memoryview );
+	HPy_Close( ctx, builtins );
+	HPy_Close( ctx, bytes );
+	return view;
+}
+
+
+HPyDef_METH(Solver_sweep, "sweep", HPyFunc_VARARGS,
+	.doc = "Solve the solver for many scenarios of suggested values at once\n\n"
+	       "The values are a sequence of scenarios, each a sequence of one value "
+	       "per edit variable. The result is a two dimensional memoryview of "
+	       "doubles, with one row per scenario and one column per variable, in "
+	       "the order of `variables`, which numpy can wrap without copying. "
+	       "The solver itself is left unchanged.")
+static HPy
+Solver_sweep_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_t nargs )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy pyvars;
+	HPy pyvalues;
+	if( !HPyArg_Parse( ctx, NULL, args, nargs, "OO", &pyvars, &pyvalues ) )
+		return HPy_NULL;
+	std::vector<kiwi::Variable> variables;
+	if( !variableVector( ctx, pyvars, variables ) )
+		return HPy_NULL;
+	std::vector<double> values;
+	if( !valueMatrix( ctx, pyvalues, variables.size(), values ) )
+		return HPy_NULL;
+	std::size_t scenarios = variables.empty() ? HPy_Length( ctx, pyvalues ) : values.size() / variables.size();
+	std::vector<double> results;
+	try
+	{
+		results = self->solver.sweep( variables, values.data(), scenarios );
+	}
+	catch( const kiwi::UnknownEditVariable& e )
+	{
+		setUnknownEditVariable( ctx, pyvars, variables, e );
+		return HPy_NULL;
+	}
+	return matrixView( ctx, results, scenarios, self->solver.variables().size() );
+}
+
+
+HPyDef_METH(Solver_setBounds, "setBounds", HPyFunc_VARARGS,
+	.doc = "Set the bounds of a variable, infinite bounds leaving it free.")
+static HPy
+Solver_setBounds_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_t nargs )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy pyvar;
+	HPy pylower;
+	HPy pyupper;
+	if( !HPyArg_Parse(ctx, NULL, args, nargs, "OOO", &pyvar, &pylower, &pyupper ) )
+		return HPy_NULL;
+	if( !Variable::TypeCheck( ctx, pyvar ) ) {
+		HPyErr_SetString( ctx, ctx->h_TypeError, "Expected object of type `Variable`." );
+		return HPy_NULL;
+	}
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
+	double lower;
+	double upper;
+	if( !convert_to_double( ctx, pylower, lower ) || !convert_to_double( ctx, pyupper, upper ) )
+		return HPy_NULL;
+	if( !registerVariable( ctx, h_self, pyvar ) )
+		return HPy_NULL;
+	Variable* var = Variable::AsStruct( ctx, pyvar );
+	try
+	{
+		self->solver.setBounds( var->variable, lower, upper );
+	}
+	catch( const kiwi::UnsatisfiableConstraint& e )
+	{
+		setBoundFromGlobal( ctx, UnsatisfiableConstraint, pyvar, e.constraint() );
+		return HPy_NULL;
+	}
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
 HPyDef_METH(Solver_updateVariables, "updateVariables", HPyFunc_NOARGS,
 	.doc = "Update the values of the solver variables.")
 static HPy
@@ -269,17 +1145,101 @@ Solver_updateVariables_impl( HPyContext *ctx, HPy h_self )
 }
 
 
+HPyDef_METH(Solver_updateChangedVariables, "updateChangedVariables", HPyFunc_NOARGS,
+	.doc = "Update the values of the variables which changed and return them in a list.")
+static HPy
+Solver_updateChangedVariables_impl( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	std::vector<kiwi::Variable> changed( self->solver.updateChangedVariables() );
+	return variableList( ctx, h_self, changed.data(), changed.size() );
+}
+
+
+HPyDef_METH(Solver_variables, "variables", HPyFunc_NOARGS,
+	.doc = "Get the variables of the solver, in the order of the values buffer.")
+static HPy
+Solver_variables_impl( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	kiwi::ArrayView<kiwi::Variable> variables( self->solver.variables() );
+	return variableList( ctx, h_self, variables.data(), variables.size() );
+}
+
+
 HPyDef_METH(Solver_reset, "reset", HPyFunc_NOARGS,
 	.doc = "Reset the solver to the initial empty starting condition.")
 static HPy
 Solver_reset_impl( HPyContext *ctx, HPy h_self )
 {
     Solver* self = Solver_AsStruct( ctx, h_self );
+	if( !checkNotExported( ctx, self ) )
+		return HPy_NULL;
+	HPy registry = HPyDict_New( ctx );
+	if( HPy_IsNull( registry ) )
+		return HPy_NULL;
+	HPyField_Store( ctx, h_self, &self->variables, registry );
+	HPy_Close( ctx, registry );
 	self->solver.reset();
 	return HPy_Dup( ctx, ctx->h_None );
 }
 
 
+HPyDef_METH(Solver_copy, "__copy__", HPyFunc_NOARGS,
+	.doc = "Create a copy of the solver sharing the rows of its tableau until they change.\n\n"
+	       "The copy refers to the same variables, whose values are written by "
+	       "whichever solver updates them.")
+static HPy
+Solver_copy_impl( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy type = HPy_Type( ctx, h_self );
+	Solver* copy;
+	HPy pycopy = HPy_New( ctx, type, &copy );
+	HPy_Close( ctx, type );
+	if( HPy_IsNull( pycopy ) )
+		return HPy_NULL;
+	copy->value_count = 0;
+	copy->exports = 0;
+	new( &copy->solver ) kiwi::Solver( self->solver.clone() );
+	// The copy knows the same variables, so it starts from a copy of the
+	// registry of the solver.
+	HPy registry = HPyField_Load( ctx, h_self, self->variables );
+	HPy method = HPy_GetAttr_s( ctx, registry, "copy" );
+	HPy copied = HPy_IsNull( method ) ? HPy_NULL : HPy_CallTupleDict( ctx, method, HPy_NULL, HPy_NULL );
+	HPy_Close( ctx, method );
+	HPy_Close( ctx, registry );
+	if( HPy_IsNull( copied ) )
+	{
+		HPy_Close( ctx, pycopy );
+		return HPy_NULL;
+	}
+	HPyField_Store( ctx, pycopy, &copy->variables, copied );
+	HPy_Close( ctx, copied );
+	return pycopy;
+}
+
+
+HPyDef_METH(Solver_checkpoint, "checkpoint", HPyFunc_NOARGS,
+	.doc = "Record the state of the solver and return a Checkpoint to restore it.\n\n"
+	       "Used as a context manager, the checkpoint rolls back the changes made "
+	       "in its block if the block raises, and commits them otherwise.")
+static HPy
+Solver_checkpoint_impl( HPyContext *ctx, HPy h_self )
+{
+    Solver* self = Solver_AsStruct( ctx, h_self );
+	HPy type = HPyGlobal_Load( ctx, Checkpoint::TypeObject );
+	Checkpoint* checkpoint;
+	HPy pycheckpoint = HPy_New( ctx, type, &checkpoint );
+	HPy_Close( ctx, type );
+	if( HPy_IsNull( pycheckpoint ) )
+		return HPy_NULL;
+	checkpoint->token = self->solver.checkpoint();
+	HPyField_Store( ctx, pycheckpoint, &checkpoint->solver, h_self );
+	return pycheckpoint;
+}
+
+
 /* 
  Simple port of PyObject_Print. 
  Checks have been removed as Solver isn't checking the return of PyObject_Print
@@ -353,21 +1313,170 @@ static HPyDef* Solver_defines[] = {
 	// slots
 	&Solver_dealloc,
 	&Solver_new,
+	&Solver_traverse,
+	&Solver_getbuffer,
+	&Solver_releasebuffer,
 
 	// methods
 	&Solver_addConstraint,
 	&Solver_removeConstraint,
+	&Solver_addConstraints,
+	&Solver_removeConstraints,
 	&Solver_hasConstraint,
+	&Solver_tryAddConstraint,
+	&Solver_tryRemoveConstraint,
 	&Solver_addEditVariable,
 	&Solver_removeEditVariable,
 	&Solver_hasEditVariable,
+	&Solver_removeVariable,
 	&Solver_suggestValue,
+	&Solver_suggestValues,
+	&Solver_trySuggestValue,
+	&Solver_setAffineEdits,
+	&Solver_affineEdits,
+	&Solver_setBasisCacheSize,
+	&Solver_sweep,
+	&Solver_basisCacheStats,
+	&Solver_setBounds,
 	&Solver_updateVariables,
+	&Solver_updateChangedVariables,
+	&Solver_variables,
 	&Solver_reset,
+	&Solver_copy,
+	&Solver_checkpoint,
 	&Solver_dump,
 	&Solver_dumps,
 	NULL
 };
+
+
+HPyDef_SLOT(Checkpoint_traverse, HPy_tp_traverse)
+static int
+Checkpoint_traverse_impl( void* obj, HPyFunc_visitproc visit, void* arg )
+{
+	Checkpoint* self = (Checkpoint*) obj;
+	HPy_VISIT( &self->solver );
+	return 0;
+}
+
+
+/* Roll back or commit the changes made since a checkpoint.
+
+*/
+static HPy
+releaseCheckpoint( HPyContext *ctx, HPy h_self, bool rollback )
+{
+	Checkpoint* self = Checkpoint_AsStruct( ctx, h_self );
+	HPy pysolver = HPyField_Load( ctx, h_self, self->solver );
+	Solver* solver = Solver_AsStruct( ctx, pysolver );
+	// Rolling back drops the variables added since the checkpoint.
+	if( rollback && !checkNotExported( ctx, solver ) )
+	{
+		HPy_Close( ctx, pysolver );
+		return HPy_NULL;
+	}
+	try
+	{
+		if( rollback )
+			solver->solver.rollback( self->token );
+		else
+			solver->solver.commit( self->token );
+	}
+	catch( const kiwi::UnknownCheckpoint& )
+	{
+		HPy_Close( ctx, pysolver );
+		HPyErr_SetString( ctx, ctx->h_ValueError, "The checkpoint is not held by the solver." );
+		return HPy_NULL;
+	}
+	bool pruned = pruneRegistry( ctx, pysolver );
+	HPy_Close( ctx, pysolver );
+	if( !pruned )
+		return HPy_NULL;
+	return HPy_Dup( ctx, ctx->h_None );
+}
+
+
+HPyDef_METH(Checkpoint_rollback, "rollback", HPyFunc_NOARGS,
+	.doc = "Restore the state of the solver recorded by the checkpoint.\n\n"
+	       "The checkpoint and the ones taken after it are released.")
+static HPy
+Checkpoint_rollback_impl( HPyContext *ctx, HPy h_self )
+{
+	return releaseCheckpoint( ctx, h_self, true );
+}
+
+
+HPyDef_METH(Checkpoint_commit, "commit", HPyFunc_NOARGS,
+	.doc = "Keep the changes made since the checkpoint.\n\n"
+	       "The checkpoint and the ones taken after it are released.")
+static HPy
+Checkpoint_commit_impl( HPyContext *ctx, HPy h_self )
+{
+	return releaseCheckpoint( ctx, h_self, false );
+}
+
+
+HPyDef_METH(Checkpoint_held, "held", HPyFunc_NOARGS,
+	.doc = "Test whether the solver still holds the checkpoint.")
+static HPy
+Checkpoint_held_impl( HPyContext *ctx, HPy h_self )
+{
+	Checkpoint* self = Checkpoint_AsStruct( ctx, h_self );
+	HPy pysolver = HPyField_Load( ctx, h_self, self->solver );
+	bool held = Solver_AsStruct( ctx, pysolver )->solver.hasCheckpoint( self->token );
+	HPy_Close( ctx, pysolver );
+	return HPy_Dup( ctx, held ? ctx->h_True : ctx->h_False );
+}
+
+
+HPyDef_METH(Checkpoint_enter, "__enter__", HPyFunc_NOARGS)
+static HPy
+Checkpoint_enter_impl( HPyContext *ctx, HPy h_self )
+{
+	return HPy_Dup( ctx, h_self );
+}
+
+
+/* Leave the block of the checkpoint.
+
+The changes are rolled back if the block raised and committed otherwise,
+unless the block already released the checkpoint.
+
+*/
+HPyDef_METH(Checkpoint_exit, "__exit__", HPyFunc_VARARGS)
+static HPy
+Checkpoint_exit_impl( HPyContext *ctx, HPy h_self, const HPy *args, size_t nargs )
+{
+	HPy exc_type, exc_value, traceback;
+	if( !HPyArg_Parse( ctx, NULL, args, nargs, "OOO", &exc_type, &exc_value, &traceback ) )
+		return HPy_NULL;
+	Checkpoint* self = Checkpoint_AsStruct( ctx, h_self );
+	HPy pysolver = HPyField_Load( ctx, h_self, self->solver );
+	bool held = Solver_AsStruct( ctx, pysolver )->solver.hasCheckpoint( self->token );
+	HPy_Close( ctx, pysolver );
+	if( held )
+	{
+		HPy result = releaseCheckpoint( ctx, h_self, !HPy_Is( ctx, exc_type, ctx->h_None ) );
+		if( HPy_IsNull( result ) )
+			return HPy_NULL;
+		HPy_Close( ctx, result );
+	}
+	return HPy_Dup( ctx, ctx->h_False );
+}
+
+
+static HPyDef* Checkpoint_defines[] = {
+	// slots
+	&Checkpoint_traverse,
+
+	// methods
+	&Checkpoint_rollback,
+	&Checkpoint_commit,
+	&Checkpoint_held,
+	&Checkpoint_enter,
+	&Checkpoint_exit,
+	NULL
+};
 } // namespace
 
 
@@ -379,7 +1488,7 @@ HPyType_Spec Solver::TypeObject_Spec = {
 	.name = "kiwisolver.Solver",
 	.basicsize = sizeof( Solver ),
 	.itemsize = 0,
-	.flags = HPy_TPFLAGS_DEFAULT | HPy_TPFLAGS_BASETYPE,
+	.flags = HPy_TPFLAGS_DEFAULT | HPy_TPFLAGS_HAVE_GC | HPy_TPFLAGS_BASETYPE,
     .defines = Solver_defines
 };
 
@@ -390,6 +1499,24 @@ bool Solver::Ready( HPyContext *ctx, HPy m )
 }
 
 
+HPyGlobal Checkpoint::TypeObject;
+
+
+HPyType_Spec Checkpoint::TypeObject_Spec = {
+	.name = "kiwisolver.Checkpoint",
+	.basicsize = sizeof( Checkpoint ),
+	.itemsize = 0,
+	.flags = HPy_TPFLAGS_DEFAULT | HPy_TPFLAGS_HAVE_GC,
+    .defines = Checkpoint_defines
+};
+
+
+bool Checkpoint::Ready( HPyContext *ctx, HPy m )
+{
+	return add_type( ctx , m , &TypeObject , "Checkpoint" , &TypeObject_Spec );
+}
+
+
 HPyGlobal DuplicateConstraint;
 
 HPyGlobal UnsatisfiableConstraint;
@@ -5,6 +5,8 @@
 #
 # The full license is in the file LICENSE, distributed with this software.
 #------------------------------------------------------------------------------
+import copy
+
 import pytest
 
 from kiwisolver import (Solver, Variable,
@@ -92,6 +94,421 @@ def test_suggesting_values_for_edit_variables():
     assert v2.value() <= -1
 
 
+def test_suggesting_several_values():
+    """Test suggesting values for several edit variables at once.
+
+    """
+    import array
+
+    s = Solver()
+    width = Variable('width')
+    height = Variable('height')
+    area = Variable('area')
+    s.addEditVariable(width, 'strong')
+    s.addEditVariable(height, 'strong')
+    s.addConstraint(area == width + height)
+
+    s.suggestValues([(width, 10), (height, 20.5)])
+    s.updateVariables()
+    assert (width.value(), height.value(), area.value()) == (10, 20.5, 30.5)
+
+    s.suggestValues((width, height), array.array('d', [1.5, 2]))
+    s.updateVariables()
+    assert (width.value(), height.value(), area.value()) == (1.5, 2, 3.5)
+
+    with pytest.raises(TypeError):
+        s.suggestValues([(width, 1, 2)])
+    with pytest.raises(TypeError):
+        s.suggestValues([(width, 'a')])
+    with pytest.raises(TypeError):
+        s.suggestValues([1], [1])
+    with pytest.raises(ValueError):
+        s.suggestValues([width, height], [1])
+    with pytest.raises(UnknownEditVariable) as e:
+        s.suggestValues([(width, 3), (area, 4)])
+    assert e.value.args[0] is area
+    s.updateVariables()
+    assert width.value() == 3
+
+
+def test_updating_changed_variables():
+    """Test updating only the variables whose value changed.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    right = Variable('right')
+    s.addEditVariable(width, 'strong')
+    s.addConstraints([left == 10, right == left + width])
+
+    s.suggestValue(width, 100)
+    assert sorted(v.name() for v in s.updateChangedVariables()) == \
+        ['left', 'right', 'width']
+    assert (left.value(), right.value()) == (10, 110)
+    assert s.updateChangedVariables() == []
+
+    s.suggestValue(width, 50)
+    assert sorted(v.name() for v in s.updateChangedVariables()) == \
+        ['right', 'width']
+    assert right.value() == 60
+
+
+def test_answering_suggestions_from_sensitivity():
+    """Test answering the suggestions of edit variables without pivoting.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    right = Variable('right')
+    middle = Variable('middle')
+    s.addEditVariable(width, 'strong')
+    s.addConstraints([left == 10, right == left + width, right <= 200,
+                      middle == (left + right) / 2])
+    s.setAffineEdits([width])
+    assert [v.name() for v in s.affineEdits()] == ['width']
+
+    s.suggestValue(width, 100)
+    s.updateVariables()
+    assert (right.value(), middle.value()) == (110, 60)
+
+    s.suggestValue(width, 50)
+    assert sorted(v.name() for v in s.updateChangedVariables()) == \
+        ['middle', 'right', 'width']
+    assert (right.value(), middle.value()) == (60, 35)
+
+    # Out of the region where the basis stays feasible.
+    s.suggestValue(width, 300)
+    s.updateVariables()
+    assert (width.value(), right.value()) == (190, 200)
+
+    s.suggestValues([(width, 20)])
+    s.addConstraint(Variable('top') == 0)
+    s.updateVariables()
+    assert (width.value(), middle.value()) == (20, 20)
+
+    with pytest.raises(TypeError):
+        s.setAffineEdits([1])
+    with pytest.raises(UnknownEditVariable) as e:
+        s.setAffineEdits([width, left])
+    assert e.value.args[0] is left
+    s.setAffineEdits([])
+    assert s.affineEdits() == []
+
+
+def test_caching_bases():
+    """Test answering suggestions from the cached bases of the affine edits.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    right = Variable('right')
+    item = Variable('item')
+    s.addEditVariable(width, 'strong')
+    s.addConstraints([left == 10, right == left + width, right <= 200,
+                      item >= 30, (item == width / 2) | 'weak'])
+    s.setAffineEdits([width])
+    s.setBasisCacheSize(8)
+
+    for _ in range(3):
+        for value, expected in ((20, (20, 30)), (100, (100, 50)),
+                                (300, (190, 95))):
+            s.suggestValue(width, value)
+            s.updateVariables()
+            assert (width.value(), item.value()) == expected
+
+    stats = s.basisCacheStats()
+    assert stats['hits'] > 0
+    assert stats['entries'] <= 8
+    assert stats['memory'] > 0
+
+    s.addConstraint(item <= 80)
+    assert s.basisCacheStats()['entries'] == 0
+    s.suggestValue(width, 300)
+    s.updateVariables()
+    assert item.value() == 80
+
+    with pytest.raises(TypeError):
+        s.setBasisCacheSize('8')
+
+
+def test_sweeping_scenarios():
+    """Test solving many scenarios of suggested values at once.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    height = Variable('height')
+    area = Variable('area')
+    s.addEditVariable(width, 'strong')
+    s.addEditVariable(height, 'strong')
+    s.addConstraints([width <= 300, area == width + 2 * height])
+    s.suggestValues([(width, 10), (height, 20)])
+    s.updateVariables()
+    before = list(memoryview(s))
+
+    results = s.sweep([width, height], [[100, 1], [400, 2], [0, 0]])
+    assert results.shape == (3, len(s.variables()))
+    index = next(i for i, v in enumerate(s.variables()) if v is area)
+    assert [row[index] for row in results.tolist()] == [102, 304, 0]
+    assert list(memoryview(s)) == before
+    assert len(s.sweep([width], [])) == 0
+
+    with pytest.raises(ValueError):
+        s.sweep([width, height], [[100]])
+    with pytest.raises(UnknownEditVariable):
+        s.sweep([area], [[1]])
+
+
+def test_cloning_solver():
+    """Test exploring changes on a copy of a solver.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    s.addEditVariable(width, 'strong')
+    s.addConstraints([left >= 10, left + 50 <= width, (left == 0) | 'weak'])
+    s.suggestValue(width, 200)
+
+    c = copy.copy(s)
+    assert type(c) is Solver
+    c.suggestValue(width, 40)
+    extra = left >= 20
+    c.addConstraint(extra)
+    c.updateVariables()
+    assert (width.value(), left.value()) == (70, 20)
+    assert c.variables()[0] is s.variables()[0]
+
+    assert not s.hasConstraint(extra)
+    s.updateVariables()
+    assert (width.value(), left.value()) == (200, 10)
+
+
+def test_rolling_back_changes():
+    """Test undoing and keeping changes with checkpoints.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    s.addEditVariable(width, 'strong')
+    s.addConstraints([left >= 10, left + 50 <= width, (left == 0) | 'weak'])
+    s.suggestValue(width, 200)
+    s.updateVariables()
+
+    extra = left >= 20
+    with pytest.raises(RuntimeError):
+        with s.checkpoint():
+            s.addConstraint(extra)
+            s.suggestValue(width, 40)
+            s.updateVariables()
+            assert (width.value(), left.value()) == (70, 20)
+            raise RuntimeError
+    assert not s.hasConstraint(extra)
+    assert sorted(v.name() for v in s.updateChangedVariables()) == \
+        ['left', 'width']
+    assert (width.value(), left.value()) == (200, 10)
+
+    with s.checkpoint() as outer:
+        s.addConstraint(extra)
+        inner = s.checkpoint()
+        s.removeConstraint(extra)
+        outer.rollback()
+        assert not inner.held() and not outer.held()
+        with pytest.raises(ValueError):
+            inner.rollback()
+    assert not s.hasConstraint(extra)
+
+    with s.checkpoint():
+        s.addConstraint(extra)
+    assert s.hasConstraint(extra)
+    s.updateVariables()
+    assert left.value() == 20
+
+    checkpoint = s.checkpoint()
+    view = memoryview(s)
+    with pytest.raises(BufferError):
+        checkpoint.rollback()
+    view.release()
+    checkpoint.rollback()
+
+
+def test_exporting_values():
+    """Test accessing the values of the variables through the buffer protocol.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    right = Variable('right')
+    s.addEditVariable(width, 'strong')
+    s.addConstraints([left == 10, right == left + width])
+    s.suggestValue(width, 100)
+    s.updateVariables()
+
+    names = [v.name() for v in s.variables()]
+    assert sorted(names) == ['left', 'right', 'width']
+    view = memoryview(s)
+    assert view.readonly and view.format == 'd'
+    assert dict(zip(names, view.tolist())) == \
+        {'width': 100, 'left': 10, 'right': 110}
+
+    s.suggestValue(width, 50)
+    s.updateVariables()
+    assert view[names.index('right')] == 60
+
+    with pytest.raises(BufferError):
+        s.addConstraint(Variable('top') == 0)
+    view.release()
+    s.addConstraint(Variable('top') == 0)
+    assert len(memoryview(s)) == 4
+
+
+def test_setting_bounds():
+    """Test bounding variables, and moving and removing the bounds.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    s.setBounds(width, 10, 50)
+    s.setBounds(left, 5, float('inf'))
+    s.addConstraint((width == 100) | 'weak')
+    s.addConstraint((left == 0) | 'weak')
+    s.updateVariables()
+    assert width.value() == 50
+    assert left.value() == 5
+
+    s.setBounds(width, 20, 80)
+    s.setBounds(left, 7, float('inf'))
+    s.updateVariables()
+    assert width.value() == 80
+    assert left.value() == 7
+
+    s.setBounds(width, -float('inf'), float('inf'))
+    s.updateVariables()
+    assert width.value() == 100
+
+    with pytest.raises(UnsatisfiableConstraint) as e:
+        s.setBounds(width, 10, 0)
+    cn = e.value.args[0]
+    assert cn.op() == '>='
+    assert cn.expression().constant() == -10
+    (term,) = cn.expression().terms()
+    assert term.variable() is width and term.coefficient() == 1
+    s.addConstraint(left <= 20)
+    with pytest.raises(UnsatisfiableConstraint) as e:
+        s.setBounds(left, 30, 40)
+    cn = e.value.args[0]
+    assert (cn.op(), cn.expression().constant()) == ('>=', -30)
+    assert cn.expression().terms()[0].variable() is left
+
+
+def test_aliasing_variables():
+    """Test variables tied by required equalities, and removing the ties.
+
+    """
+    s = Solver()
+    left = Variable('left')
+    contents_left = Variable('contents_left')
+    inner = Variable('inner')
+    s.addConstraint(left >= 5)
+    tie = contents_left == left + 10
+    s.addConstraint(tie)
+    s.addConstraint(inner == 2 * contents_left)
+    s.addConstraint((left == 20) | 'weak')
+    s.updateVariables()
+    assert left.value() == 20
+    assert contents_left.value() == 30
+    assert inner.value() == 60
+
+    s.addConstraint(contents_left <= 25)
+    assert set(v.name() for v in s.updateChangedVariables()) == {
+        'left', 'contents_left', 'inner'
+    }
+    assert left.value() == 15
+    assert inner.value() == 50
+
+    s.removeConstraint(tie)
+    s.addConstraint((contents_left == 0) | 'medium')
+    s.updateVariables()
+    assert left.value() == 20
+    assert contents_left.value() == 0
+    assert inner.value() == 0
+
+
+def test_removing_variables():
+    """Test dropping the variables no constraint refers to, and removing
+    variables along with their constraints.
+
+    """
+    s = Solver()
+    width = Variable('width')
+    left = Variable('left')
+    right = Variable('right')
+    s.addEditVariable(width, 'strong')
+    s.setBounds(width, 0, 500)
+    c1 = left == 10
+    c2 = right == left + width
+    s.addConstraints([c1, c2])
+    assert len(s.variables()) == 3
+
+    s.removeConstraint(c2)
+    assert sorted(v.name() for v in s.variables()) == ['left', 'width']
+
+    s.addConstraint(c2)
+    view = memoryview(s)
+    with pytest.raises(BufferError):
+        s.removeVariable(width)
+    with pytest.raises(BufferError):
+        s.removeConstraint(c1)
+    view.release()
+
+    s.removeVariable(width)
+    assert not s.hasEditVariable(width)
+    assert not s.hasConstraint(c2)
+    assert s.hasConstraint(c1)
+    assert [v.name() for v in s.variables()] == ['left']
+    s.updateVariables()
+    assert list(memoryview(s)) == [10]
+
+    # Removing a variable unknown to the solver does nothing.
+    s.removeVariable(width)
+    s.removeVariable(Variable('top'))
+    assert len(s.variables()) == 1
+
+
+def test_rolling_back_removed_variables():
+    """Test that rolling back brings back the variables dropped since the
+    checkpoint.
+
+    """
+    s = Solver()
+    items = [Variable('item%d' % i) for i in range(100)]
+    cns = [item == i for i, item in enumerate(items)]
+    s.addConstraints(cns)
+    s.updateChangedVariables()
+
+    with s.checkpoint() as checkpoint:
+        s.removeConstraints(cns)
+        assert s.variables() == []
+        checkpoint.rollback()
+
+    restored = s.variables()
+    assert len(restored) == 100
+    assert all(any(v is item for item in items) for v in restored)
+    s.removeConstraint(cns[0])
+    s.addConstraint(items[0] == 50)
+    assert s.updateChangedVariables() == [items[0]]
+    assert items[0].value() == 50
+
+    s.removeConstraints(cns[1:])
+    assert s.variables() == [items[0]]
+
+
 def test_managing_constraints():
     """Test adding/removing constraints.
 
@@ -131,6 +548,94 @@ def test_managing_constraints():
     assert not s.hasConstraint(c2)
 
 
+def test_managing_constraints_in_batch():
+    """Test adding/removing sequences of constraints.
+
+    """
+    s = Solver()
+    v = Variable('foo')
+    v2 = Variable('bar')
+    c1 = v >= 1
+    c2 = v2 == 2 * v
+    c3 = v <= 0
+
+    with pytest.raises(TypeError):
+        s.addConstraints([c1, object()])
+    with pytest.raises(TypeError):
+        s.removeConstraints(object())
+    assert not s.hasConstraint(c1)
+
+    s.addConstraints((c1, c2))
+    assert s.hasConstraint(c1) and s.hasConstraint(c2)
+    s.updateVariables()
+    assert v.value() == 1
+    assert v2.value() == 2
+
+    with pytest.raises(DuplicateConstraint) as e:
+        s.addConstraints([c3 | 'weak', c1])
+    assert e.value.args[0] is c1
+    with pytest.raises(UnsatisfiableConstraint) as e:
+        s.addConstraints([c3])
+    assert e.value.args[0] is c3
+    with pytest.raises(UnknownConstraint) as e:
+        s.removeConstraints([c2, c3])
+    assert e.value.args[0] is c3
+    assert not s.hasConstraint(c2)
+
+    s.removeConstraints([c1])
+    assert not s.hasConstraint(c1)
+
+
+def test_trying_changes():
+    """Test the try methods, which return a status instead of raising.
+
+    """
+    s = Solver()
+    x = Variable('x')
+    y = Variable('y')
+    w = Variable('w')
+    c1 = x + y >= 10
+    c2 = x + y <= 5
+    c3 = x + y == 12
+    c4 = x - y == 4
+    c5 = x + y == 14
+
+    with pytest.raises(TypeError):
+        s.tryAddConstraint(object())
+    with pytest.raises(TypeError):
+        s.tryRemoveConstraint(object())
+    with pytest.raises(TypeError):
+        s.trySuggestValue(object(), 1)
+
+    assert s.tryAddConstraint(c1) == 'ok'
+    assert s.tryAddConstraint(c1) == 'duplicate'
+
+    # A constraint which cannot be added leaves the solver unchanged.
+    dump = s.dumps()
+    assert s.tryAddConstraint(c2) == 'unsatisfiable'
+    assert not s.hasConstraint(c2)
+    assert s.dumps() == dump
+
+    assert s.tryAddConstraint(c3) == 'ok'
+    assert s.tryAddConstraint(c4) == 'ok'
+    dump = s.dumps()
+    assert s.tryAddConstraint(c5) == 'unsatisfiable'
+    assert s.dumps() == dump
+    s.updateVariables()
+    assert (x.value(), y.value()) == (8, 4)
+
+    assert s.tryRemoveConstraint(c2) == 'unknown'
+    assert s.tryRemoveConstraint(c4) == 'ok'
+    assert not s.hasConstraint(c4)
+
+    assert s.trySuggestValue(w, 10) == 'unknown'
+    s.addEditVariable(w, 'strong')
+    s.addConstraint(w == 2 * x)
+    assert s.trySuggestValue(w, 10) == 'ok'
+    s.updateVariables()
+    assert (w.value(), x.value(), y.value()) == (10, 5, 7)
+
+
 def test_solving_under_constrained_system():
     """Test solving an under constrained system.
 
@@ -270,3 +775,28 @@ def test_handling_infeasible_constraints():
     assert xl.value() + xr.value() == 2*xm.value()
     assert xl.value() == 80
     assert xr.value() == 100
+
+
+def test_recovering_from_unsatisfiable_constraint():
+    """Test that a constraint which cannot be satisfied leaves the other
+    constraints satisfied.
+
+    """
+    x = Variable('x')
+    y = Variable('y')
+    s = Solver()
+    s.addConstraint(y == 2 - 3*x)
+    s.addConstraint(x >= 10)
+    s.addConstraint((x == 0) | 'weak')
+    with pytest.raises(UnsatisfiableConstraint):
+        s.addConstraint(y >= -14)
+    s.updateVariables()
+    assert x.value() == pytest.approx(10)
+    assert y.value() == pytest.approx(-28)
+
+    with pytest.raises(UnsatisfiableConstraint):
+        s.setBounds(y, -14, 0)
+    s.addEditVariable(x, 'strong')
+    s.suggestValue(x, 20)
+    s.updateVariables()
+    assert x.value() == pytest.approx(20)
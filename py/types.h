@@ -146,6 +146,9 @@ HPyType_HELPERS(Constraint)
 
 struct Solver
 {
+	HPyField variables;
+	HPy_ssize_t value_count;
+	int exports;
 	kiwi::Solver solver;
 
     static HPyType_Spec TypeObject_Spec;
@@ -165,6 +168,20 @@ struct Solver
 
 HPyType_HELPERS(Solver)
 
+struct Checkpoint
+{
+	HPyField solver;
+	std::size_t token;
+
+    static HPyType_Spec TypeObject_Spec;
+
+    static HPyGlobal TypeObject;
+
+	static bool Ready( HPyContext *ctx, HPy m );
+};
+
+HPyType_HELPERS(Checkpoint)
+
 bool init_exceptions( HPyContext *ctx, HPy mod );
 
 